@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include "AllocationCounter.h"
+
+#ifdef CATS_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+    // Number of calls to the global operator new made by each thread since it started
+    thread_local long allocation_count = 0;
+
+    /**
+     * Counts and performs a heap allocation
+     * @param size number of bytes to allocate
+     * @return pointer to the allocated memory, nullptr if the allocation failed
+     */
+    void* countedAllocate(std::size_t size) {
+        allocation_count++;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+}
+
+void* operator new(std::size_t size) {
+    void* ptr = countedAllocate(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    void* ptr = countedAllocate(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+/**
+ * Checks whether the allocation counting hook is compiled into the program
+ * @return true if allocations are being counted, false otherwise
+ */
+bool AllocationCounter::isEnabled() {
+#ifdef CATS_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Gets the number of heap allocations made by the calling thread through the global operator new so far
+ * @return number of allocations, always zero if the counting hook is not compiled in
+ */
+long AllocationCounter::getCount() {
+#ifdef CATS_COUNT_ALLOCATIONS
+    return allocation_count;
+#else
+    return 0;
+#endif
+}
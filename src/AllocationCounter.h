@@ -0,0 +1,20 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_ALLOCATIONCOUNTER_H
+#define CA_TRAFFIC_SIMULATION_ALLOCATIONCOUNTER_H
+
+/**
+ * Counter of the heap allocations made by each thread through the global operator new. The counting hook is only
+ * compiled in when the program is built with CATS_COUNT_ALLOCATIONS defined, otherwise the counter always reads zero
+ * and costs nothing. Threads that work for a process thread, the task workers and the probe writer, hand their counts
+ * over to it, see Simulation::count_allocations.
+ */
+namespace AllocationCounter {
+    bool isEnabled();
+    long getCount();
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_ALLOCATIONCOUNTER_H
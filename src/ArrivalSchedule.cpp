@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "ArrivalSchedule.h"
+#include "Random.h"
+
+/**
+ * Constructor for the ArrivalSchedule, with a constant demand and no arrivals generated yet
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param interarrival_time_cdf CDF of the Vehicle interarrival times at the base demand
+ */
+ArrivalSchedule::ArrivalSchedule(const Inputs& inputs, CDF* interarrival_time_cdf) {
+    this->interarrival_time_cdf = interarrival_time_cdf;
+    this->step_size = inputs.step_size;
+    this->peak_rate = 1.0;
+
+    // Allocate the rings of all the Lanes, with the first candidate arrival of each Lane in the first step
+    this->arrivals.assign((size_t) inputs.num_lanes * ARRIVAL_RING_SIZE, 0);
+    this->heads.assign(inputs.num_lanes, 0);
+    this->counts.assign(inputs.num_lanes, 0);
+    this->next_candidates.assign(inputs.num_lanes, 0.0);
+    this->batches.assign(inputs.num_lanes, 0);
+}
+
+/**
+ * Reads the demand profile from a comma delimited text file where each line holds the first step of a period and the
+ * demand during the period relative to the interarrival CDF, which holds until the next period. The demand before
+ * the first period is 1. Empty lines and lines starting with '#' are skipped. Nothing is read if the demand profile
+ * is disabled in the inputs.
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param file_name path and name of the file to read
+ * @return 0 if successful, nonzero otherwise
+ */
+int ArrivalSchedule::read_profile(const Inputs& inputs, std::string file_name) {
+    if (inputs.use_demand_profile == 0) {
+        return 0;
+    }
+
+    // Open the file containing the demand profile
+    std::ifstream file(file_name);
+
+    // Check if the demand profile file was loaded properly
+    if (!file) {
+        std::cout << "error: failure to open " << file_name << " file!" << std::endl;
+        return 1;
+    }
+
+    // Read each line into a period of the profile
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        int first_step;
+        double rate;
+        char comma;
+        std::istringstream fields(line);
+        fields >> first_step >> comma >> rate;
+        if (!fields || rate < 0.0 || (!this->profile_steps.empty() && first_step <= this->profile_steps.back())) {
+            std::cout << "error: invalid period on line " << line_number << " of " << file_name << "!" << std::endl;
+            return 1;
+        }
+        this->profile_steps.push_back(first_step);
+        this->profile_rates.push_back(rate);
+    }
+
+    // Close the file
+    file.close();
+
+    // Candidates are generated at the peak demand, including the demand before the first period if there is one
+    this->peak_rate = 0.0;
+    if (this->profile_steps.empty() || this->profile_steps.front() > 0) {
+        this->peak_rate = 1.0;
+    }
+    for (double rate : this->profile_rates) {
+        this->peak_rate = std::max(this->peak_rate, rate);
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Gets the demand of the period that contains a step
+ * @param step the step
+ * @return the demand relative to the interarrival CDF
+ */
+double ArrivalSchedule::getRate(int step) {
+    auto period = std::upper_bound(this->profile_steps.begin(), this->profile_steps.end(), step);
+    if (period == this->profile_steps.begin()) {
+        return 1.0;
+    }
+    return this->profile_rates[period - this->profile_steps.begin() - 1];
+}
+
+/**
+ * Generates the next batch of arrivals of a Lane until its ring is full. Candidate arrivals are drawn from the
+ * interarrival CDF with the times divided by the peak demand, and each is kept with the probability of the demand at
+ * its step relative to the peak, which is exact thinning for exponential interarrival times. The number of candidates
+ * per batch is bounded, so a period without demand is crossed over a few batches.
+ * @param lane the number of the Lane
+ */
+void ArrivalSchedule::refill(int lane) {
+    if (this->peak_rate <= 0.0) {
+        return;
+    }
+
+    // Each batch of the Lane draws from its own random stream
+    Random::beginStream(lane, this->batches[lane]++, Random::STREAM_ARRIVALS);
+    int32_t* ring = &this->arrivals[(size_t) lane * ARRIVAL_RING_SIZE];
+    for (int c = 0; c < 4 * ARRIVAL_RING_SIZE && this->counts[lane] < ARRIVAL_RING_SIZE; c++) {
+        const double candidate = this->next_candidates[lane];
+        const int steps = (int) (this->interarrival_time_cdf->query() / this->step_size) + 1;
+        this->next_candidates[lane] += steps / this->peak_rate;
+
+        const int step = (int) std::ceil(candidate);
+        if (Random::uniform() * this->peak_rate < this->getRate(step)) {
+            ring[(this->heads[lane] + this->counts[lane]) % ARRIVAL_RING_SIZE] = step;
+            this->counts[lane]++;
+        }
+    }
+}
+
+/**
+ * Checks if the oldest arrival of a Lane is due, generating the next batch first if the ring is less than half full
+ * @param lane the number of the Lane
+ * @param step the current step
+ * @return whether or not a Vehicle is waiting to enter the Lane
+ */
+bool ArrivalSchedule::hasDueArrival(int lane, int step) {
+    if (this->counts[lane] < ARRIVAL_RING_SIZE / 2) {
+        this->refill(lane);
+    }
+    return this->counts[lane] > 0 && this->arrivals[(size_t) lane * ARRIVAL_RING_SIZE + this->heads[lane]] <= step;
+}
+
+/**
+ * Removes the oldest arrival of a Lane once its Vehicle has entered the Lane
+ * @param lane the number of the Lane
+ */
+void ArrivalSchedule::popArrival(int lane) {
+    this->heads[lane] = (this->heads[lane] + 1) % ARRIVAL_RING_SIZE;
+    this->counts[lane]--;
+}
+
+/**
+ * Adds the storage of the arrivals that are scheduled or waiting to enter the Lanes to a MemoryReport
+ * @param report the MemoryReport
+ */
+void ArrivalSchedule::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_VEHICLES, this->arrivals);
+    report->addVector(MEMORY_VEHICLES, this->heads);
+    report->addVector(MEMORY_VEHICLES, this->counts);
+    report->addVector(MEMORY_VEHICLES, this->next_candidates);
+    report->addVector(MEMORY_VEHICLES, this->batches);
+    report->addVector(MEMORY_VEHICLES, this->profile_steps);
+    report->addVector(MEMORY_VEHICLES, this->profile_rates);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_ARRIVALSCHEDULE_H
+#define CA_TRAFFIC_SIMULATION_ARRIVALSCHEDULE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Inputs.h"
+#include "CDF.h"
+#include "MemoryReport.h"
+
+// Number of arrivals held in the ring of each Lane
+const int ARRIVAL_RING_SIZE = 256;
+
+/**
+ * Class for the schedule of the Vehicles arriving at the start of each Lane. The arrivals are generated ahead of time
+ * in batches, from the interarrival CDF sped up to the peak of the demand profile and thinned to the demand of the
+ * step of each arrival, and kept in a ring per Lane. Arrivals that are due while the first site of their Lane is
+ * blocked stay in the ring, which is the entry queue of the Lane, so spawning only compares the step of the oldest
+ * arrival with the current step.
+ */
+class ArrivalSchedule {
+private:
+    CDF* interarrival_time_cdf;
+    double step_size;
+    std::vector<int> profile_steps;
+    std::vector<double> profile_rates;
+    double peak_rate;
+    std::vector<int32_t> arrivals;
+    std::vector<int> heads;
+    std::vector<int> counts;
+    std::vector<double> next_candidates;
+    std::vector<int> batches;
+    double getRate(int step);
+    void refill(int lane);
+public:
+    ArrivalSchedule(const Inputs& inputs, CDF* interarrival_time_cdf);
+    int read_profile(const Inputs& inputs, std::string file_name);
+    bool hasDueArrival(int lane, int step);
+    void popArrival(int lane);
+    void addMemory(MemoryReport* report) const;
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_ARRIVALSCHEDULE_H
@@ -3,6 +3,7 @@
  */
 
 #include "CDF.h"
+#include "Random.h"
 
 #include <fstream>
 #include <string>
@@ -44,7 +45,7 @@ int CDF::read_cdf(std::string file_name) {
  * @return sampled point from the distribution
  */
 double CDF::query() {
-    double u = ((double) std::rand()) / ((double) RAND_MAX);
+    double u = Random::uniform();
     for (int i = 0; i < (int) this->cdf.size(); i++) {
         if (this->cdf[i] >= u) {
             return this->x[i];
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Calibration.h"
+#include "Random.h"
+#include "Simulation.h"
+#include "Statistic.h"
+#include "ThreadTransport.h"
+
+// Objective of a candidate whose run failed or left too few trips to compare
+const double CALIBRATION_FAILED = 1.0e30;
+
+// Coefficients of the reflection, expansion, contraction and shrink steps of the Nelder-Mead method
+const double CALIBRATION_REFLECT = 1.0;
+const double CALIBRATION_EXPAND = 2.0;
+const double CALIBRATION_CONTRACT = 0.5;
+const double CALIBRATION_SHRINK = 0.5;
+
+// Bounds of the parameters, and the offsets of the other vertices of the initial simplex from the inputs
+const CalibrationPoint CALIBRATION_LOWER = {0.0, 1.0, 0.0, 0.0};
+const CalibrationPoint CALIBRATION_UPPER = {1.0, SCENARIO_MAX_SPEED, 1.0, 255.0};
+const CalibrationPoint CALIBRATION_STEP = {0.1, 1.0, 0.1, 1.0};
+
+// Names of the parameters and the lines of the input file that hold them
+const char* const CALIBRATION_NAMES[CALIBRATION_NUM_PARAMETERS] = {"Slow down probability", "Maximum speed",
+                                                                   "Lane change probability", "Look other backward"};
+const int CALIBRATION_LINES[CALIBRATION_NUM_PARAMETERS] = {7, 3, 8, 6};
+
+/**
+ * Constructor for the Calibration
+ * @param transport the Transport to the other processes
+ * @param inputs instance of the Inputs class with the inputs that the calibration starts from
+ * @param seed the seed of the run, the same on all the processes
+ */
+Calibration::Calibration(Transport* transport, const Inputs& inputs, uint64_t seed) {
+    this->transport = transport;
+    this->inputs = inputs;
+    this->seed = seed;
+    this->num_evaluations = 0;
+    this->num_batches = 0;
+}
+
+/**
+ * Reads the target travel times on rank 0 and broadcasts their quantiles to all the processes. Each line of the file
+ * is a travel time in seconds, and lines starting with '#' are comments.
+ * @param file_name the name of the file with the target travel times
+ * @param rank the rank of the process
+ * @return 0 if successful, nonzero otherwise
+ */
+int Calibration::read_target(std::string file_name, int rank) {
+    int status = 0;
+    this->target_quantiles.resize(CALIBRATION_NUM_QUANTILES);
+    if (rank == 0) {
+        Statistic target;
+        std::ifstream file(file_name);
+        if (!file) {
+            std::cout << "error: failure to open " << file_name << " file!" << std::endl;
+            status = 1;
+        }
+
+        // Read each line into a sample of the target distribution
+        std::string line;
+        int line_number = 0;
+        while (status == 0 && std::getline(file, line)) {
+            line_number++;
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            double travel_time;
+            std::istringstream fields(line);
+            fields >> travel_time;
+            if (!fields || travel_time < 0.0) {
+                std::cout << "error: invalid travel time on line " << line_number << " of " << file_name << "!"
+                          << std::endl;
+                status = 1;
+            }
+            target.addValue(travel_time);
+        }
+        if (status == 0 && target.getNumSamples() < 2) {
+            std::cout << "error: " << file_name << " must hold at least two travel times!" << std::endl;
+            status = 1;
+        }
+        if (status == 0) {
+            target.getQuantiles(CALIBRATION_NUM_QUANTILES, this->target_quantiles.data());
+        }
+    }
+
+    // Broadcast the status and the quantiles to all processes
+    this->transport->broadcast(&status, sizeof(int), 0);
+    if (status != 0) {
+        return status;
+    }
+    this->transport->broadcast(this->target_quantiles.data(), CALIBRATION_NUM_QUANTILES * sizeof(double), 0);
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Simulates the warm-up period with the inputs of the input file on all the processes, and gathers the Vehicles on
+ * the road at its end on every process, which every run of the calibration starts from
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return 0 if successful, nonzero otherwise
+ */
+int Calibration::run_warmup(int rank, int size) {
+    if (this->inputs.warmup_time <= 0) {
+        return 0;
+    }
+
+    // Simulate the warm-up period without any of the outputs of a run
+    Inputs warmup_inputs = this->getCandidateInputs(CalibrationPoint{this->inputs.prob_slow_down,
+                                                                     (double) this->inputs.max_speed,
+                                                                     this->inputs.prob_change,
+                                                                     (double) this->inputs.look_other_backward});
+    warmup_inputs.max_time = this->inputs.warmup_time;
+    Random::seed(this->seed, rank);
+    Simulation* simulation_ptr = new Simulation(this->transport, warmup_inputs, rank, size);
+    simulation_ptr->setQuiet(true);
+    int status = simulation_ptr->run_simulation(rank, size);
+    std::vector<ScenarioVehicle> segment_vehicles;
+    simulation_ptr->get_vehicles(&segment_vehicles);
+    delete simulation_ptr;
+    if (status != 0) {
+        return status;
+    }
+
+    // Gather the Vehicles of all the segments, each process broadcasting its own in turn
+    std::vector<int64_t> local_counts(size, 0);
+    std::vector<int64_t> counts(size);
+    local_counts[rank] = segment_vehicles.size();
+    this->transport->allReduce(local_counts.data(), counts.data(), size, REDUCE_SUM);
+    int64_t offset = 0;
+    int64_t own_offset = 0;
+    for (int r = 0; r < size; r++) {
+        own_offset = (r == rank) ? offset : own_offset;
+        offset += counts[r];
+    }
+    this->warm_vehicles.resize(offset);
+    std::copy(segment_vehicles.begin(), segment_vehicles.end(), this->warm_vehicles.begin() + own_offset);
+    offset = 0;
+    for (int r = 0; r < size; r++) {
+        if (counts[r] > 0) {
+            this->transport->broadcast(this->warm_vehicles.data() + offset, counts[r] * sizeof(ScenarioVehicle), r);
+        }
+        offset += counts[r];
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Builds the inputs of a run of a candidate, which measures the travel times over the steps after the warm-up
+ * period of the input file and writes none of the outputs of a simulation
+ * @param point the parameters of the candidate
+ * @return the inputs of the run
+ */
+Inputs Calibration::getCandidateInputs(const CalibrationPoint& point) {
+    Inputs candidate_inputs = this->inputs;
+    candidate_inputs.prob_slow_down = point[0];
+    candidate_inputs.max_speed = (int) std::lround(point[1]);
+    candidate_inputs.prob_change = point[2];
+    candidate_inputs.look_other_backward = (int) std::lround(point[3]);
+    candidate_inputs.max_time = this->inputs.max_time - this->inputs.warmup_time;
+    candidate_inputs.warmup_time = 0;
+    candidate_inputs.observables_interval = 0;
+    candidate_inputs.telemetry_interval = 0;
+    candidate_inputs.write_trip_log = 0;
+    candidate_inputs.target_precision = 0.0;
+    candidate_inputs.paired_replications = 0;
+    candidate_inputs.raster_width = 0;
+    candidate_inputs.raster_height = 0;
+    candidate_inputs.probe_fraction = 0.0;
+    candidate_inputs.calibration_iterations = 0;
+    candidate_inputs.perf_counters = 0;
+    return candidate_inputs;
+}
+
+/**
+ * Moves a point into the bounds of the parameters
+ * @param point the point
+ * @return the nearest point within the bounds
+ */
+CalibrationPoint Calibration::clamp(const CalibrationPoint& point) {
+    CalibrationPoint clamped;
+    for (int i = 0; i < CALIBRATION_NUM_PARAMETERS; i++) {
+        clamped[i] = std::min(std::max(point[i], CALIBRATION_LOWER[i]), CALIBRATION_UPPER[i]);
+    }
+    return clamped;
+}
+
+/**
+ * Runs a candidate on the whole road in the calling process alone, starting from the state at the end of the warm-up
+ * @param point the parameters of the candidate
+ * @return the mean absolute difference between the quantiles of the travel times of the run and of the target
+ */
+double Calibration::evaluate(const CalibrationPoint& point) {
+    const Inputs candidate_inputs = this->getCandidateInputs(point);
+    double objective = CALIBRATION_FAILED;
+    ThreadTransport::run(1, std::vector<int>(), [&](Transport* solo_transport) {
+        // All the candidates run with the same seed
+        Random::seed(Random::mix(this->seed + Random::GOLDEN_GAMMA), 0);
+        Simulation simulation(solo_transport, candidate_inputs, 0, 1);
+        simulation.setQuiet(true);
+        simulation.warm_start(this->warm_vehicles);
+        int status = simulation.run_simulation(0, 1);
+
+        // Compare the quantiles of the travel times with those of the target
+        Statistic* travel_time = simulation.getTravelTime();
+        if (status == 0 && travel_time->getNumSamples() >= 2) {
+            double quantiles[CALIBRATION_NUM_QUANTILES];
+            travel_time->getQuantiles(CALIBRATION_NUM_QUANTILES, quantiles);
+            objective = 0.0;
+            for (int k = 0; k < CALIBRATION_NUM_QUANTILES; k++) {
+                objective += std::fabs(quantiles[k] - this->target_quantiles[k]);
+            }
+            objective /= CALIBRATION_NUM_QUANTILES;
+        }
+        return status;
+    });
+    return objective;
+}
+
+/**
+ * Evaluates a batch of candidates at the same time, dealing them out to the processes in a round robin, collective
+ * over all the processes
+ * @param points the parameters of the candidates
+ * @param objectives pointer to the list to hold the objectives of the candidates, the same on every process
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+void Calibration::evaluateBatch(const std::vector<CalibrationPoint>& points, std::vector<double>* objectives, int rank,
+                                int size) {
+    std::vector<double> local_objectives(points.size(), 0.0);
+    for (int k = rank; k < (int) points.size(); k += size) {
+        local_objectives[k] = this->evaluate(points[k]);
+    }
+    objectives->resize(points.size());
+    this->transport->allReduce(local_objectives.data(), objectives->data(), points.size(), REDUCE_SUM);
+    this->num_evaluations += points.size();
+    this->num_batches++;
+}
+
+/**
+ * Runs the calibration and reports the calibrated parameters on rank 0
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return 0 if successful, nonzero otherwise
+ */
+int Calibration::run(int rank, int size) {
+    if (this->inputs.engine != ENGINE_VEHICLES) {
+        if (rank == 0) {
+            std::cout << "error: calibrations need the Vehicle engine!" << std::endl;
+        }
+        return 1;
+    }
+    if (this->inputs.max_time <= this->inputs.warmup_time) {
+        if (rank == 0) {
+            std::cout << "error: calibrations need a maximum time beyond the warm-up period!" << std::endl;
+        }
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    // Read the target and simulate the warm-up period that the runs start from
+    int status = this->read_target("cats-calibration-target.txt", rank);
+    if (status != 0) {
+        return status;
+    }
+    status = this->run_warmup(rank, size);
+    if (status != 0) {
+        return status;
+    }
+
+    // The initial simplex is the point of the input file and a step away from it along each parameter, towards the
+    // inside of the bounds
+    const int n = CALIBRATION_NUM_PARAMETERS;
+    std::vector<CalibrationPoint> simplex(n + 1);
+    simplex[0] = CalibrationPoint{this->inputs.prob_slow_down, (double) this->inputs.max_speed,
+                                  this->inputs.prob_change, (double) this->inputs.look_other_backward};
+    simplex[0] = this->clamp(simplex[0]);
+    for (int i = 0; i < n; i++) {
+        simplex[i + 1] = simplex[0];
+        const bool fits = simplex[0][i] + CALIBRATION_STEP[i] <= CALIBRATION_UPPER[i];
+        simplex[i + 1][i] += fits ? CALIBRATION_STEP[i] : -CALIBRATION_STEP[i];
+    }
+    std::vector<double> values;
+    this->evaluateBatch(simplex, &values, rank, size);
+
+    std::vector<CalibrationPoint> candidates(4);
+    std::vector<double> candidate_values;
+    int iteration;
+    for (iteration = 0; iteration < this->inputs.calibration_iterations; iteration++) {
+        // Order the vertices from the best to the worst
+        std::vector<int> order(n + 1);
+        for (int i = 0; i <= n; i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return values[a] < values[b]; });
+        std::vector<CalibrationPoint> sorted_simplex(n + 1);
+        std::vector<double> sorted_values(n + 1);
+        for (int i = 0; i <= n; i++) {
+            sorted_simplex[i] = simplex[order[i]];
+            sorted_values[i] = values[order[i]];
+        }
+        simplex = sorted_simplex;
+        values = sorted_values;
+
+        if (rank == 0) {
+            std::cout << "Iteration " << iteration + 1 << ": distance " << values[0] << " [s] at slow down "
+                      << simplex[0][0] << ", max speed " << std::lround(simplex[0][1]) << ", lane change "
+                      << simplex[0][2] << ", look back " << std::lround(simplex[0][3]) << std::endl;
+        }
+
+        // Stop once the vertices are all equally good
+        if (values[n] - values[0] <= 1.0e-9 * (1.0 + std::fabs(values[0]))) {
+            break;
+        }
+
+        // Evaluate the reflection, the expansion and both contractions of the worst vertex through the centroid of
+        // the others at the same time, as any of them can be the next vertex
+        CalibrationPoint centroid;
+        centroid.fill(0.0);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                centroid[j] += simplex[i][j] / n;
+            }
+        }
+        for (int j = 0; j < n; j++) {
+            const double direction = centroid[j] - simplex[n][j];
+            candidates[0][j] = centroid[j] + CALIBRATION_REFLECT * direction;
+            candidates[1][j] = centroid[j] + CALIBRATION_EXPAND * direction;
+            candidates[2][j] = centroid[j] + CALIBRATION_CONTRACT * CALIBRATION_REFLECT * direction;
+            candidates[3][j] = centroid[j] - CALIBRATION_CONTRACT * direction;
+        }
+        for (CalibrationPoint& candidate : candidates) {
+            candidate = this->clamp(candidate);
+        }
+        this->evaluateBatch(candidates, &candidate_values, rank, size);
+
+        // Take the step of the Nelder-Mead method
+        const double reflected = candidate_values[0];
+        bool shrink = false;
+        if (reflected < values[0]) {
+            const int accepted = (candidate_values[1] < reflected) ? 1 : 0;
+            simplex[n] = candidates[accepted];
+            values[n] = candidate_values[accepted];
+        } else if (reflected < values[n - 1]) {
+            simplex[n] = candidates[0];
+            values[n] = reflected;
+        } else if (reflected < values[n]) {
+            shrink = candidate_values[2] > reflected;
+            if (!shrink) {
+                simplex[n] = candidates[2];
+                values[n] = candidate_values[2];
+            }
+        } else {
+            shrink = candidate_values[3] >= values[n];
+            if (!shrink) {
+                simplex[n] = candidates[3];
+                values[n] = candidate_values[3];
+            }
+        }
+
+        // Shrink the simplex towards the best vertex, evaluating the moved vertices at the same time
+        if (shrink) {
+            std::vector<CalibrationPoint> shrunk(simplex.begin() + 1, simplex.end());
+            for (CalibrationPoint& vertex : shrunk) {
+                for (int j = 0; j < n; j++) {
+                    vertex[j] = simplex[0][j] + CALIBRATION_SHRINK * (vertex[j] - simplex[0][j]);
+                }
+            }
+            std::vector<double> shrunk_values;
+            this->evaluateBatch(shrunk, &shrunk_values, rank, size);
+            for (int i = 0; i < n; i++) {
+                simplex[i + 1] = shrunk[i];
+                values[i + 1] = shrunk_values[i];
+            }
+        }
+    }
+
+    // Find the best vertex
+    const int best = std::min_element(values.begin(), values.end()) - values.begin();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double time_elapsed = (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000000.0;
+
+    if (rank == 0) {
+        std::cout << "--- Calibration ---" << std::endl;
+        std::cout << "Runs: " << this->num_evaluations << " in " << this->num_batches << " batches on " << size
+                  << " processes, " << iteration << " iterations, " << time_elapsed << " [s]" << std::endl;
+        std::cout << "Warm start: " << this->warm_vehicles.size() << " Vehicles after " << this->inputs.warmup_time
+                  << " steps" << std::endl;
+        if (values[best] >= CALIBRATION_FAILED) {
+            std::cout << "error: no candidate left enough trips to compare with the target!" << std::endl;
+        }
+        std::cout << "Distance to the target travel times (mean over " << CALIBRATION_NUM_QUANTILES
+                  << " quantiles): " << values[best] << " [s]" << std::endl;
+        for (int i = 0; i < CALIBRATION_NUM_PARAMETERS; i++) {
+            std::cout << CALIBRATION_NAMES[i] << " (input line " << CALIBRATION_LINES[i] << "): ";
+            if (i == 1 || i == 3) {
+                std::cout << std::lround(simplex[best][i]) << std::endl;
+            } else {
+                std::cout << simplex[best][i] << std::endl;
+            }
+        }
+    }
+
+    // Return with the outcome, which every process agrees on
+    return (values[best] >= CALIBRATION_FAILED) ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_CALIBRATION_H
+#define CA_TRAFFIC_SIMULATION_CALIBRATION_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Inputs.h"
+#include "Scenario.h"
+#include "Transport.h"
+
+// Number of parameters that a calibration fits: the slow down probability, the maximum speed, the lane change
+// probability and the distance a Vehicle looks back in the other Lane
+const int CALIBRATION_NUM_PARAMETERS = 4;
+
+// Number of quantiles of the travel times that are compared with the target
+const int CALIBRATION_NUM_QUANTILES = 99;
+
+// Point in the space of the calibrated parameters
+typedef std::array<double, CALIBRATION_NUM_PARAMETERS> CalibrationPoint;
+
+/**
+ * Class for the calibration of the parameters of the Vehicles against a measured distribution of travel times. The
+ * Nelder-Mead simplex method minimizes the mean absolute difference between the quantiles of the simulated and the
+ * target travel times. The candidates that an iteration may need (reflection, expansion and both contractions) are
+ * evaluated at once, each on a rank of its own that simulates the whole road alone, so an iteration takes as long as
+ * a single run when there are at least four ranks. Every run starts from the state of the road at the end of the
+ * warm-up period, simulated once with the inputs of the input file, and all runs use the same seed, so that the
+ * differences between the candidates are not drowned in the noise of the runs.
+ */
+class Calibration {
+private:
+    Transport* transport;
+    Inputs inputs;
+    uint64_t seed;
+    std::vector<double> target_quantiles;
+    std::vector<ScenarioVehicle> warm_vehicles;
+    int num_evaluations;
+    int num_batches;
+    int read_target(std::string file_name, int rank);
+    int run_warmup(int rank, int size);
+    Inputs getCandidateInputs(const CalibrationPoint& point);
+    CalibrationPoint clamp(const CalibrationPoint& point);
+    double evaluate(const CalibrationPoint& point);
+    void evaluateBatch(const std::vector<CalibrationPoint>& points, std::vector<double>* objectives, int rank,
+                       int size);
+public:
+    Calibration(Transport* transport, const Inputs& inputs, uint64_t seed);
+    int run(int rank, int size);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_CALIBRATION_H
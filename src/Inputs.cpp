@@ -8,6 +8,7 @@
 #include <sstream>
 
 #include "Inputs.h"
+#include "Scenario.h"
 
 /**
  * Helper function to parse a line in the input file and return the parameter value of the line
@@ -18,6 +19,20 @@ std::string parseLine(std::string line) {
     return line.substr(0, line.find(' '));
 }
 
+/**
+ * Helper function to parse an optional line in the input file, which may be left out of the end of the file
+ * @param input_lines the lines of the input file
+ * @param n index of the line to parse
+ * @param default_value the parameter to use if the line is not in the input file
+ * @return the parameter on the line, or the default value if there is no such line
+ */
+std::string parseOptionalLine(const std::vector<std::string>& input_lines, int n, std::string default_value) {
+    if (n >= (int) input_lines.size() || parseLine(input_lines[n]).empty()) {
+        return default_value;
+    }
+    return parseLine(input_lines[n]);
+}
+
 /**
  * Loads the inputs options from a text file into the class variables
  * @return 0 if successful, nonzero otherwise
@@ -55,9 +70,85 @@ int Inputs::loadFromFile() {
     this->step_size           = std::stod(parseLine(input_lines[n++]));
     this->warmup_time         = std::stoi(parseLine(input_lines[n++]));
 
+    // Parse the optional lines at the end of the input file, which fall back to their defaults when left out
+    this->observables_interval = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->telemetry_interval   = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->write_trip_log       = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->rule_set             = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->prob_slow_down_stopped = std::stod(parseOptionalLine(input_lines, n++, "0.0"));
+    this->engine               = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->num_replicas         = std::stoi(parseOptionalLine(input_lines, n++, "64"));
+    this->target_precision     = std::stod(parseOptionalLine(input_lines, n++, "0.0"));
+    this->paired_replications  = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->paired_line          = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->paired_value         = std::stod(parseOptionalLine(input_lines, n++, "0.0"));
+    this->use_scenario         = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->use_demand_profile   = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->halo_steps           = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->num_workers          = std::stoi(parseOptionalLine(input_lines, n++, "1"));
+    this->raster_width         = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->raster_height        = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->probe_fraction       = std::stod(parseOptionalLine(input_lines, n++, "0.0"));
+    this->calibration_iterations = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+    this->perf_counters        = std::stoi(parseOptionalLine(input_lines, n++, "0"));
+
     // Close the input file
     input_file.close();
 
+    // Check that the maximum speed fits in the bytes that hold the speed limits of the sites in every engine
+    if (this->checkMaxSpeed() != 0) {
+        return 1;
+    }
+
     // Return with zero errors
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * Sets the input option on a line of the input file to a value, as if the line held that value
+ * @param line number of the line in the input file, starting from 1
+ * @param value the value of the input option, truncated for integer options
+ * @return 0 if successful, nonzero if the line does not hold an input option that can be varied
+ */
+int Inputs::setLineValue(int line, double value) {
+    switch (line) {
+        case 1: this->num_lanes = (int) value; break;
+        case 2: this->length = (int) value; break;
+        case 3:
+            this->max_speed = (int) value;
+            if (this->checkMaxSpeed() != 0) {
+                return 1;
+            }
+            break;
+        case 4: this->look_forward = (int) value; break;
+        case 5: this->look_other_forward = (int) value; break;
+        case 6: this->look_other_backward = (int) value; break;
+        case 7: this->prob_slow_down = value; break;
+        case 8: this->prob_change = value; break;
+        case 9: this->max_time = (int) value; break;
+        case 10: this->step_size = value; break;
+        case 11: this->warmup_time = (int) value; break;
+        case 15: this->rule_set = (int) value; break;
+        case 16: this->prob_slow_down_stopped = value; break;
+        default:
+            std::cout << "error: input line " << line << " cannot be varied in a paired comparison!" << std::endl;
+            return 1;
+    }
+
+    // Return with zero errors
+    return 0;
+}
+
+/**
+ * Checks that the maximum speed fits in the bytes that hold the speed limits of the sites in every engine
+ * @return 0 if the maximum speed is between 1 and SCENARIO_MAX_SPEED, nonzero otherwise
+ */
+int Inputs::checkMaxSpeed() const {
+    if (this->max_speed < 1 || this->max_speed > SCENARIO_MAX_SPEED) {
+        std::cout << "error: the maximum speed must be between 1 and " << SCENARIO_MAX_SPEED << "!" << std::endl;
+        return 1;
+    }
+
+    // Return with zero errors
+    return 0;
+}
@@ -7,6 +7,11 @@
 
 #include <iostream>
 
+// Engines that can run the simulation
+const int ENGINE_VEHICLES = 0;
+const int ENGINE_REPLICAS = 1;
+const int ENGINE_LATTICE = 2;
+
 /**
  * Class for the input options of a simulation that acts as a structure to organize the inputs in one place.
  * Has methods to load all the inputs from a file from an input text file.
@@ -25,7 +30,29 @@ public:
     int max_time;
     double step_size;
     int warmup_time;
+    int observables_interval;
+    int telemetry_interval;
+    int write_trip_log;
+    int rule_set;
+    double prob_slow_down_stopped;
+    int engine;
+    int num_replicas;
+    double target_precision;
+    int paired_replications;
+    int paired_line;
+    double paired_value;
+    int use_scenario;
+    int use_demand_profile;
+    int halo_steps;
+    int num_workers;
+    int raster_width;
+    int raster_height;
+    double probe_fraction;
+    int calibration_iterations;
+    int perf_counters;
     int loadFromFile();
+    int setLineValue(int line, double value);
+    int checkMaxSpeed() const;
 };
 
 
@@ -2,6 +2,7 @@
  * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
  */
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
@@ -10,36 +11,61 @@
 #include <iostream>
 #include "Lane.h"
 
-#include <mpi.h>
-
 #include "Vehicle.h"
 #include "Inputs.h"
+#include "ProbeLog.h"
+#include "Random.h"
 
 /**
  * Constructor for the Lane class
  * @param inputs instance of the Inputs class with simulation inputs
+ * @param scenario the Scenario with the speed limits, closed sites and initial Vehicles of the road
+ * @param occupancy the tiled occupancy of the Road, with room for the sites of every Lane
  * @param lane_num the number of lane in the road, starting with zero as the first lane
  */
-Lane::Lane(Inputs inputs, int lane_num, int start_site, int end_site, int rank) {
+Lane::Lane(const Inputs& inputs, const Scenario& scenario, uint8_t* occupancy, int lane_num, int start_site,
+           int end_site, int rank) {
 #ifdef DEBUG
     if (rank == 0) {
         std::cout << "creating lane " << lane_num << "...";
     }
 #endif
-    // Allocate memory for the vehicle pointers list
-    this->sites.reserve(end_site - start_site + 1);
-    this->sites.resize(end_site - start_site + 1);
+    // Allocate memory for the vehicle pointers list, with every site initially empty
+    this->sites.assign(end_site - start_site + 1, nullptr);
 
-    // Set the lane number for the lane
+    // Set the lane number for the lane and locate its sites in the tiles of the occupancy
     this->lane_num = lane_num;
+    this->occupancy = occupancy;
+    this->tile_stride = inputs.num_lanes * LANE_TILE_SITES;
+    this->tile_offset = lane_num * LANE_TILE_SITES;
+
+    // Expand the zones of the Scenario into the speed limit and closure of every site
+    this->speed_limits.resize(this->sites.size());
+    std::vector<uint8_t> closed(this->sites.size());
+    scenario.fillLane(inputs, lane_num, start_site, this->sites.size(), this->speed_limits.data(), closed.data());
+    for (int i = 0; i < (int) this->sites.size(); i++) {
+        this->occupancy[this->getTileIndex(i)] = (closed[i] != 0) ? LANE_SITE_CLOSED : 0;
+    }
+
+    // Place the Vehicles that are on the segment at the start of the run, with negative ids that no spawn can take
+    if (scenario.hasInitialVehicles()) {
+        std::vector<uint8_t> speeds(this->sites.size());
+        scenario.fillInitialSpeeds(inputs, lane_num, start_site, this->sites.size(), speeds.data());
+        for (int i = 0; i < (int) this->sites.size(); i++) {
+            if (speeds[i] != SCENARIO_NO_VEHICLE && closed[i] == 0) {
+                const int64_t id = -1 - ((int64_t) lane_num * inputs.length + start_site + i);
+                this->addVehicle(i, new Vehicle(this, id, i, inputs));
+                this->sites[i]->setSpeed(std::min((int) speeds[i], this->getSpeedLimit(i)));
+                this->sites[i]->setProbe(ProbeLog::isSampled(this->sites[i]->getId(), inputs.probe_fraction));
+            }
+        }
+    }
 #ifdef DEBUG
     if (rank == 0) {
         std::cout << "done, lane " << lane_num << " created with length " << inputs.length << std::endl;
     }
 #endif
 
-    this->steps_to_spawn = 0;
-
     this->gap_prev_process = 0;
     this->gap_next_process = 0;
 }
@@ -60,13 +86,50 @@ int Lane::getLaneNumber() {
     return this->lane_num;
 }
 
+/**
+ * Gets the index of a site of the Lane in the tiled occupancy of the Road
+ * @param site the site of the Lane
+ * @return the index of the flags of the site in the occupancy
+ */
+int Lane::getTileIndex(int site) {
+    const unsigned int unsigned_site = site;
+    return (unsigned_site / LANE_TILE_SITES) * this->tile_stride + this->tile_offset + unsigned_site % LANE_TILE_SITES;
+}
+
 /**
  * Checks if the Lane has a Vehicle in a specific site
  * @param site the site in which to check for a Vehicle
  * @return whether or not the Lane has a Vehicle in the site
  */
 bool Lane::hasVehicleInSite(int site) {
-    return !(this->sites[site].empty());
+    return (this->occupancy[this->getTileIndex(site)] & LANE_SITE_OCCUPIED) != 0;
+}
+
+/**
+ * Checks if a site of the Lane is taken by a Vehicle or closed, either of which stops the Vehicles behind it
+ * @param site the site in which to check for an obstacle
+ * @return whether or not the site is blocked
+ */
+bool Lane::isSiteBlocked(int site) {
+    return this->occupancy[this->getTileIndex(site)] != 0;
+}
+
+/**
+ * Getter method for the speed limit of a site of the Lane
+ * @param site the site to get the speed limit of
+ * @return the highest speed of a Vehicle in the site
+ */
+int Lane::getSpeedLimit(int site) {
+    return this->speed_limits[site];
+}
+
+/**
+ * Getter method for the Vehicle in a specific site of the Lane
+ * @param site the site to get the Vehicle from
+ * @return pointer to the Vehicle in the site, nullptr if the site is empty
+ */
+Vehicle* Lane::getVehicleInSite(int site) {
+    return this->sites[site];
 }
 
 /**
@@ -77,7 +140,8 @@ bool Lane::hasVehicleInSite(int site) {
  */
 int Lane::addVehicle(int site, Vehicle* vehicle_ptr) {
     // Place the Vehicle in the site
-    this->sites[site].push_back(vehicle_ptr);
+    this->sites[site] = vehicle_ptr;
+    this->occupancy[this->getTileIndex(site)] |= LANE_SITE_OCCUPIED;
 
     // Return with zero errors
     return 0;
@@ -90,43 +154,43 @@ int Lane::addVehicle(int site, Vehicle* vehicle_ptr) {
  */
 int Lane::removeVehicle(int site) {
     // Remove the Vehicle from the site
-    this->sites[site].pop_front();
+    this->sites[site] = nullptr;
+    this->occupancy[this->getTileIndex(site)] &= ~LANE_SITE_OCCUPIED;
 
     // Return with zero errors
     return 0;
 }
 
 /**
- * Attempts to spawn a Vehicle that has entered the Lane at the first site. Uses a CDF to sample to determine whether
- * or not a Vehicle was spawned.
+ * Attempts to spawn a Vehicle that has arrived at the first site of the Lane. The Vehicle waits in the entry queue of
+ * the ArrivalSchedule while the first site is blocked.
  * @param inputs instance of the Inputs class with the simulation inputs
  * @param vehicles pointer to list of Vehicles to add the spawned Vehicles to
- * @param next_id_ptr pointer to the id number of the next spawned Vehicle
- * @param interarrival_time_cdf CDF of the Vehicle interarrival times
- * @return
+ * @param step the current step, which with the Lane number gives the id of the spawned Vehicle
+ * @param arrivals the ArrivalSchedule of the Vehicles arriving at the Lanes
+ * @return 0 if successful, nonzero otherwise
  */
-int Lane::attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr, CDF* interarrival_time_cdf) {
-    if (this->steps_to_spawn == 0) {
-        if (!this->hasVehicleInSite(0)) {
-            // Spawn Vehicle
+int Lane::attemptSpawn(const Inputs& inputs, std::vector<Vehicle*>* vehicles, int step, ArrivalSchedule* arrivals) {
+    if (arrivals->hasDueArrival(this->lane_num, step) && !this->isSiteBlocked(0)) {
+        arrivals->popArrival(this->lane_num);
+
+        // Spawn Vehicle, with an id that is unique because a Lane spawns at most one Vehicle per step
+        int64_t id = (int64_t) step * inputs.num_lanes + this->lane_num;
 #ifdef DEBUG
-            std::cout << "creating vehicle " << (*next_id_ptr) << " in lane " << this->lane_num << " at site " << 0
-                      << std::endl;
+        std::cout << "creating vehicle " << id << " in lane " << this->lane_num << " at site " << 0 << std::endl;
 #endif
-            this->sites[0].push_front(new Vehicle(this, *next_id_ptr, 0, inputs));
-            (*next_id_ptr)++;
-            vehicles->push_back(this->sites[0].front());
+        this->addVehicle(0, new Vehicle(this, id, 0, inputs));
+        vehicles->push_back(this->sites[0]);
 
-            // Randomly choose the Vehicles initial speed to be zero bases in slow down probability
-            if (((double) std::rand()) / ((double) RAND_MAX) < inputs.prob_slow_down) {
-                vehicles->back()->setSpeed(0);
-            }
+        // Sample the Vehicle as a probe by the hash of its id
+        vehicles->back()->setProbe(ProbeLog::isSampled(id, inputs.probe_fraction));
 
-            // "Schedule" next Vehicle spawn
-            this->steps_to_spawn = (int) (interarrival_time_cdf->query() / inputs.step_size);
+        // Randomly choose the Vehicles initial speed to be zero bases in slow down probability, with the random
+        // stream of the spawns of this Lane in this step
+        Random::beginStream(this->lane_num, step, Random::STREAM_SPAWN);
+        if (Random::uniform() < inputs.prob_slow_down) {
+            vehicles->back()->setSpeed(0);
         }
-    } else {
-        this->steps_to_spawn--;
     }
 
     // Return with no error
@@ -140,10 +204,12 @@ int Lane::attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next
 void Lane::printLane(int rank, int size) {
     std::ostringstream lane_string_stream;
     for (int i = 0; i < (int) this->sites.size(); i++) {
-        if (this->sites[i].empty()) {
+        if ((this->occupancy[this->getTileIndex(i)] & LANE_SITE_CLOSED) != 0) {
+            lane_string_stream << "[XXX]";
+        } else if (this->sites[i] == nullptr) {
             lane_string_stream << "[   ]";
         } else {
-            lane_string_stream << "[" << std::setw(3) << this->sites[i].front()->getId() << "]";
+            lane_string_stream << "[" << std::setw(3) << this->sites[i]->getId() << "]";
         }
     }
     std::cout << "Rank: " << rank  << " (lane " << lane_num <<") " << lane_string_stream.str() << std::endl;
@@ -155,7 +221,7 @@ int Lane::getGapFromStart() {
 
 
     for (size_t i = 0; i < this->sites.size(); i++) {
-        if (!this->sites[i].empty()) {
+        if (this->isSiteBlocked(i)) {
             local_gap_start = i;
             break;
         }
@@ -168,8 +234,8 @@ int Lane::getGapFromEnd() {
     size_t local_gap_end = this->sites.size();
 
 
-    for (size_t i = this->sites.size() - 1; i >= 0; i--) {
-        if (!this->sites[i].empty()) {
+    for (int i = (int) this->sites.size() - 1; i >= 0; i--) {
+        if (this->isSiteBlocked(i)) {
             local_gap_end = this->sites.size() - 1 - i;
             break;
         }
@@ -192,4 +258,14 @@ void Lane::setGapPrevProcess(int gap) {
 
 void Lane::setGapNextProcess(int gap) {
     this->gap_next_process = gap;
-}
\ No newline at end of file
+}
+
+/**
+ * Adds the storage of the sites and speed limits of the Lane to a MemoryReport
+ * @param report the MemoryReport
+ */
+void Lane::addMemory(MemoryReport* report) const {
+    report->add(MEMORY_SITES, sizeof(Lane));
+    report->addVector(MEMORY_SITES, this->sites);
+    report->addVector(MEMORY_SITES, this->speed_limits);
+}
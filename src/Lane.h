@@ -5,42 +5,66 @@
 #ifndef CA_TRAFFIC_SIMULATION_LANE_H
 #define CA_TRAFFIC_SIMULATION_LANE_H
 
+#include <cstdint>
 #include <vector>
-#include <deque>
 
 #include "Inputs.h"
-#include "CDF.h"
+#include "ArrivalSchedule.h"
+#include "Scenario.h"
+#include "MemoryReport.h"
 
 // Forward Declarations
 class Vehicle;
 
+// Number of consecutive sites of a Lane that are stored together in a tile of the occupancy of the Road
+const int LANE_TILE_SITES = 16;
+
+// Flags of a site in the occupancy of the Road
+const uint8_t LANE_SITE_OCCUPIED = 1;
+const uint8_t LANE_SITE_CLOSED = 2;
+
 /**
  * Class for a lane in the road of the simulation. Each lane contains the "sites" for the vehicles and allows access
- * to all the information about the vehicles on the road through its methods.
+ * to all the information about the vehicles on the road through its methods. A site holds at most one Vehicle, so
+ * the sites are stored as a flat array of Vehicle pointers with nullptr marking an empty site. The gap scans only
+ * need to know whether a site is taken or closed, which is kept as a byte of flags per site in the occupancy of the
+ * Road. The occupancy is tiled so that the flags of the same LANE_TILE_SITES sites of every Lane are next to each
+ * other, and a scan of the neighbouring Lanes reads the cache lines that the scan of its own Lane brought in. The
+ * speed limit of each site is kept in a flat array alongside, filled from the Scenario, that the update rules look up
+ * for every Vehicle whether or not the road has any zones.
  */
 class Lane {
 private:
-    std::vector<std::deque<Vehicle*>> sites;
+    std::vector<Vehicle*> sites;
+    std::vector<uint8_t> speed_limits;
+    uint8_t* occupancy;
+    int tile_stride;
+    int tile_offset;
     int lane_num;
-    int steps_to_spawn;
     int gap_from_start;
     int gap_from_end;
     int gap_prev_process;
     int gap_next_process;
+    int getTileIndex(int site);
 public:
-    Lane(Inputs inputs, int lane_num, int start_site, int end_site, int rank);
+    Lane(const Inputs& inputs, const Scenario& scenario, uint8_t* occupancy, int lane_num, int start_site, int end_site,
+         int rank);
     int getSize();
     int getLaneNumber();
     bool hasVehicleInSite(int site);
+    bool isSiteBlocked(int site);
+    int getSpeedLimit(int site);
     int addVehicle(int site, Vehicle* vehicle_ptr);
+    Vehicle* getVehicleInSite(int site);
     int removeVehicle(int site);
-    int attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr, CDF* interarrival_time_cdf);
+    int attemptSpawn(const Inputs& inputs, std::vector<Vehicle*>* vehicles, int step, ArrivalSchedule* arrivals);
     int getGapFromStart();
     int getGapFromEnd();
     int getGapPrevProcess();
     int getGapNextProcess();
     void setGapPrevProcess(int gap);
     void setGapNextProcess(int gap);
+    void addMemory(MemoryReport* report) const;
 #ifdef DEBUG
     void printLane(int rank, int size);
 #endif
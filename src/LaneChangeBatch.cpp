@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include "LaneChangeBatch.h"
+#include "Vehicle.h"
+
+/**
+ * Sizes the arrays of the batch for the largest number of Vehicles that a segment can hold, so that the batch does
+ * not allocate during the steps
+ * @param max_vehicles the number of sites of the segment in all its Lanes
+ */
+void LaneChangeBatch::resize(int max_vehicles) {
+    this->gap_forward.resize(max_vehicles);
+    this->look_forward.resize(max_vehicles);
+    this->gap_other_forward.resize(max_vehicles);
+    this->look_other_forward.resize(max_vehicles);
+    this->gap_other_backward.resize(max_vehicles);
+    this->look_other_backward.resize(max_vehicles);
+    this->mask.resize(max_vehicles);
+    this->candidates.resize(max_vehicles);
+}
+
+/**
+ * Gathers the gaps and look distances of the Vehicles into the arrays of the batch
+ * @param vehicles the Vehicles of the segment
+ */
+void LaneChangeBatch::gather(const std::vector<Vehicle*>& vehicles) {
+    const int count = vehicles.size();
+    for (int n = 0; n < count; n++) {
+        vehicles[n]->storeLaneChangeInputs(n, this->gap_forward.data(), this->look_forward.data(),
+                                           this->gap_other_forward.data(), this->look_other_forward.data(),
+                                           this->gap_other_backward.data(), this->look_other_backward.data());
+    }
+}
+
+/**
+ * Gets the indices of the candidates found by the last selection
+ * @return pointer to the indices of the candidates in the vector of Vehicles
+ */
+const int* LaneChangeBatch::getCandidates() const {
+    return this->candidates.data();
+}
+
+/**
+ * Adds the storage of the gathered gaps, the mask and the candidates to a MemoryReport
+ * @param report the MemoryReport
+ */
+void LaneChangeBatch::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_VEHICLES, this->gap_forward);
+    report->addVector(MEMORY_VEHICLES, this->look_forward);
+    report->addVector(MEMORY_VEHICLES, this->gap_other_forward);
+    report->addVector(MEMORY_VEHICLES, this->look_other_forward);
+    report->addVector(MEMORY_VEHICLES, this->gap_other_backward);
+    report->addVector(MEMORY_VEHICLES, this->look_other_backward);
+    report->addVector(MEMORY_VEHICLES, this->mask);
+    report->addVector(MEMORY_VEHICLES, this->candidates);
+}
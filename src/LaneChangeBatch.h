@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_LANECHANGEBATCH_H
+#define CA_TRAFFIC_SIMULATION_LANECHANGEBATCH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "MemoryReport.h"
+
+class Vehicle;
+
+/**
+ * Class for the lane change decisions of all the Vehicles of a segment in one batch. The gaps and look distances of
+ * the Vehicles are gathered into contiguous arrays, the gap tests of the lane change rule are evaluated over the
+ * arrays without branches into a mask that the compiler vectorizes, and the mask is compacted into the list of
+ * candidates. Only the candidates draw the random number of the rule, from the keyed stream of the Vehicle, so the
+ * decisions are the same as when every Vehicle evaluates the whole rule on its own.
+ */
+class LaneChangeBatch {
+private:
+    std::vector<int> gap_forward;
+    std::vector<int> look_forward;
+    std::vector<int> gap_other_forward;
+    std::vector<int> look_other_forward;
+    std::vector<int> gap_other_backward;
+    std::vector<int> look_other_backward;
+    std::vector<uint8_t> mask;
+    std::vector<int> candidates;
+    void gather(const std::vector<Vehicle*>& vehicles);
+public:
+    void resize(int max_vehicles);
+    template <class RuleSet>
+    int selectCandidates(const std::vector<Vehicle*>& vehicles);
+    const int* getCandidates() const;
+    void addMemory(MemoryReport* report) const;
+};
+
+/**
+ * Selects the Vehicles whose gaps allow a lane change under the lane change rule of the rule set
+ * @tparam RuleSet the rule set of the cellular automaton
+ * @param vehicles the Vehicles of the segment, with their gaps up to date
+ * @return the number of candidates, whose indices in the vector of Vehicles are given by getCandidates
+ */
+template <class RuleSet>
+int LaneChangeBatch::selectCandidates(const std::vector<Vehicle*>& vehicles) {
+    this->gather(vehicles);
+    const int count = vehicles.size();
+
+    // Evaluate the gap tests of every Vehicle into the mask
+    const int* gap_forward = this->gap_forward.data();
+    const int* look_forward = this->look_forward.data();
+    const int* gap_other_forward = this->gap_other_forward.data();
+    const int* look_other_forward = this->look_other_forward.data();
+    const int* gap_other_backward = this->gap_other_backward.data();
+    const int* look_other_backward = this->look_other_backward.data();
+    uint8_t* mask = this->mask.data();
+    for (int n = 0; n < count; n++) {
+        mask[n] = RuleSet::wantsLaneChange(gap_forward[n], look_forward[n], gap_other_forward[n],
+                                           look_other_forward[n], gap_other_backward[n], look_other_backward[n]);
+    }
+
+    // Compact the mask into the list of candidates, writing every index and advancing past the selected ones
+    int* candidates = this->candidates.data();
+    int num_candidates = 0;
+    for (int n = 0; n < count; n++) {
+        candidates[num_candidates] = n;
+        num_candidates += mask[n];
+    }
+    return num_candidates;
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_LANECHANGEBATCH_H
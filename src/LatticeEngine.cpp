@@ -0,0 +1,772 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "LatticeEngine.h"
+#include "Random.h"
+#include "RuleSets.h"
+#include "Scenario.h"
+
+// Flag of an occupied site, the low bits of the site hold the speed of the Vehicle
+const uint8_t SITE_OCCUPIED = 0x80;
+const uint8_t SITE_SPEED_MASK = 0x7F;
+
+// Marker of a closed site, which is not empty but holds no Vehicle
+const uint8_t SITE_CLOSED = 0x7F;
+
+/**
+ * Record of a Vehicle that moves to the segment of the next process
+ */
+struct MigratingVehicle {
+    int32_t lane;
+    int32_t position;
+    int32_t speed;
+    int32_t padding;
+    LatticeVehicle vehicle;
+};
+
+namespace {
+    /**
+     * Checks whether eight consecutive sites are all empty
+     * @param sites pointer to the first of the sites
+     * @return true if none of the sites are occupied or closed
+     */
+    inline bool blockIsEmpty(const uint8_t* sites) {
+        uint64_t block;
+        std::memcpy(&block, sites, sizeof(block));
+        return block == 0;
+    }
+
+    /**
+     * Counts the Vehicles in a range of sites
+     * @param sites pointer to the sites of the Lane
+     * @param first the first site of the range
+     * @param count the number of sites in the range
+     * @return the number of occupied sites in the range
+     */
+    inline int countOccupied(const uint8_t* sites, int first, int count) {
+        int num_occupied = 0;
+        for (int i = first; i < first + count; i++) {
+            num_occupied += sites[i] >> 7;
+        }
+        return num_occupied;
+    }
+
+    /**
+     * Finds the gap to the first occupied site ahead, looking no further than a maximum distance
+     * @param sites pointer to the sites of the Lane
+     * @param site the site to measure from
+     * @param first_distance distance of the first site to look at, 0 to include the site itself
+     * @param max_gap the largest gap of interest, returned if no occupied site is found
+     * @return number of empty sites between the site and the first occupied site, at most max_gap
+     */
+    inline int gapAhead(const uint8_t* sites, int site, int first_distance, int max_gap) {
+        for (int j = first_distance; j <= max_gap; j++) {
+            if (sites[site + j] != 0) {
+                return j - 1;
+            }
+        }
+        return max_gap;
+    }
+
+    /**
+     * Finds the gap to the first occupied site behind, including the site itself, looking no further than a maximum
+     * distance
+     * @param sites pointer to the sites of the Lane
+     * @param site the site to measure from
+     * @param max_gap the largest gap of interest, returned if no occupied site is found
+     * @return number of empty sites between the site and the first occupied site behind, at most max_gap
+     */
+    inline int gapBehind(const uint8_t* sites, int site, int max_gap) {
+        for (int j = 0; j <= max_gap; j++) {
+            if (sites[site - j] != 0) {
+                return j - 1;
+            }
+        }
+        return max_gap;
+    }
+}
+
+/**
+ * Constructor for the LatticeEngine
+ * @param transport the Transport to the other processes
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+LatticeEngine::LatticeEngine(Transport* transport, const Inputs& inputs, int rank, int size) {
+    this->transport = transport;
+    if (inputs.max_speed > SITE_SPEED_MASK) {
+        if (rank == 0) {
+            std::cout << "error: the lattice engine supports speeds up to " << (int) SITE_SPEED_MASK << "!"
+                      << std::endl;
+        }
+        throw std::exception();
+    }
+    if (inputs.probe_fraction > 0.0) {
+        if (rank == 0) {
+            std::cout << "error: the lattice engine does not support probe Vehicles!" << std::endl;
+        }
+        throw std::exception();
+    }
+
+    this->inputs = inputs;
+    this->num_lanes = inputs.num_lanes;
+    this->length = inputs.length / size;
+    this->time = 0;
+
+    // The lane change looks up to max_speed + 2 sites ahead and look_other_backward + 1 sites behind. With deep
+    // halos, a step changes a site from the sites up to one lane change and one move away, so the ghost sites that
+    // are updated locally lose that many sites of accuracy at each end in each step between the exchanges.
+    this->halo_steps = inputs.halo_steps;
+    this->compute_back = this->halo_steps * (inputs.max_speed + inputs.look_other_backward + 1);
+    this->compute_front = this->halo_steps * (2 * inputs.max_speed + 2);
+    if (size > 1 && this->length < std::max(this->compute_back, this->compute_front)) {
+        if (rank == 0) {
+            std::cout << "error: the segments are shorter than the deep halos of "
+                      << std::max(this->compute_back, this->compute_front) << " sites!" << std::endl;
+        }
+        throw std::exception();
+    }
+    this->first_site = (rank > 0) ? -this->compute_back : 0;
+    this->end_site = (rank < size - 1) ? this->length + this->compute_front : this->length;
+    this->ghost_back = this->compute_back + inputs.look_other_backward + 1;
+    this->ghost_front = this->compute_front + inputs.max_speed + 2;
+    this->lane_stride = this->ghost_back + this->length + this->ghost_front;
+
+    // Allocate the double buffered lattice, with every site and ghost site initially empty
+    this->sites.assign((size_t) this->num_lanes * this->lane_stride, 0);
+    this->next_sites.assign((size_t) this->num_lanes * this->lane_stride, 0);
+    this->vehicles.resize(this->num_lanes);
+    this->next_vehicles.resize(this->num_lanes);
+    this->lane_cursors.assign(this->num_lanes, 0);
+
+    // Reserve the messages of the Vehicles that cross the boundary of the segment, at most max_speed per Lane in a step
+    this->send_buffer.reserve((size_t) this->num_lanes * inputs.max_speed * sizeof(MigratingVehicle));
+    this->recv_buffer.reserve(this->send_buffer.capacity());
+
+    // Expand the zones of the Scenario into the speed limits and the closed sites of the segment and its ghost sites,
+    // and mark the closed sites on the road in both lattice buffers, which keep them because every pass copies them
+    // into the new lattice
+    Scenario scenario;
+    if (scenario.read_scenario(inputs, "cats-scenario.txt") != 0 ||
+        scenario.map_scenario(inputs, "cats-scenario.bin") != 0) {
+        throw std::exception();
+    }
+    if (scenario.hasInitialVehicles()) {
+        if (rank == 0) {
+            std::cout << "error: the lattice engine does not support Vehicles in the scenario!" << std::endl;
+        }
+        throw std::exception();
+    }
+    this->closed_sites.assign((size_t) this->num_lanes * this->lane_stride, 0);
+    this->speed_limits.resize((size_t) this->num_lanes * this->lane_stride);
+    const int road_start = -rank * this->length;
+    const int road_end = (size - rank) * this->length;
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        uint8_t* closed = this->laneSites(this->closed_sites, lane);
+        scenario.fillLane(inputs, lane, rank * this->length - this->ghost_back, this->lane_stride,
+                          this->laneSites(this->speed_limits, lane) - this->ghost_back, closed - this->ghost_back);
+        for (int i = -this->ghost_back; i < this->length + this->ghost_front; i++) {
+            closed[i] *= (i >= road_start && i < road_end) ? SITE_CLOSED : 0;
+        }
+    }
+    this->sites = this->closed_sites;
+    this->next_sites = this->closed_sites;
+
+    // Allocate the buffers for the ghost sites of all the Lanes, with deep halos also for the number and trip data of
+    // the Vehicles in the ghost sites, so that each exchange is a single message of a fixed size in each direction
+    if (this->halo_steps > 0) {
+        const size_t per_site = 1 + sizeof(LatticeVehicle);
+        this->halo_send_back.resize(this->num_lanes * (sizeof(int32_t) + per_site * this->compute_back));
+        this->halo_recv_back.resize(this->halo_send_back.size());
+        this->halo_send_front.resize(this->num_lanes * (sizeof(int32_t) + per_site * this->compute_front));
+        this->halo_recv_front.resize(this->halo_send_front.size());
+    } else {
+        this->halo_send_back.resize((size_t) this->num_lanes * this->ghost_back);
+        this->halo_recv_back.resize((size_t) this->num_lanes * this->ghost_back);
+        this->halo_send_front.resize((size_t) this->num_lanes * this->ghost_front);
+        this->halo_recv_front.resize((size_t) this->num_lanes * this->ghost_front);
+    }
+
+    this->interarrival_time_cdf = new CDF();
+    if (this->interarrival_time_cdf->read_cdf("interarrival-cdf.dat") != 0) {
+        throw std::exception();
+    }
+    this->arrivals = new ArrivalSchedule(inputs, this->interarrival_time_cdf);
+    if (this->arrivals->read_profile(inputs, "cats-demand.txt") != 0) {
+        throw std::exception();
+    }
+
+    this->travel_time = new Statistic();
+    this->observables = new Observables(transport, inputs, rank);
+    this->telemetry = new Telemetry(transport, inputs, rank, size);
+    this->counters = new PerfCounters(inputs, 1, rank);
+    this->trip_log = new TripLog(transport, inputs);
+    this->raster = new SpaceTimeRaster(transport, inputs, rank, size);
+    this->run_length = new RunLength(transport, inputs, rank, size);
+
+    // Print the reports of the run unless it is told otherwise
+    this->quiet = false;
+}
+
+/**
+ * Destructor for the LatticeEngine
+ */
+LatticeEngine::~LatticeEngine() {
+    delete this->arrivals;
+    delete this->interarrival_time_cdf;
+    delete this->travel_time;
+    delete this->observables;
+    delete this->telemetry;
+    delete this->counters;
+    delete this->trip_log;
+    delete this->raster;
+    delete this->run_length;
+}
+
+/**
+ * Gets the first site of a Lane in a lattice buffer, the ghost sites are at negative indices and after the last site
+ * @param buffer the lattice buffer
+ * @param lane the number of the Lane
+ * @return pointer to the first site of the Lane
+ */
+uint8_t* LatticeEngine::laneSites(std::vector<uint8_t>& buffer, int lane) {
+    return buffer.data() + (size_t) lane * this->lane_stride + this->ghost_back;
+}
+
+/**
+ * Fills the ghost sites of the current lattice with the first sites of the next process and the last sites of the
+ * previous process. The ghost sites at the ends of the road stay empty.
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+void LatticeEngine::exchangeHalos(int rank, int size) {
+    const int prev_rank = (rank > 0) ? rank - 1 : TRANSPORT_NO_RANK;
+    const int next_rank = (rank < size - 1) ? rank + 1 : TRANSPORT_NO_RANK;
+    const int front = std::min(this->ghost_front, this->length);
+    const int back = std::min(this->ghost_back, this->length);
+
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        uint8_t* lane_sites = this->laneSites(this->sites, lane);
+        std::memcpy(&this->halo_send_front[(size_t) lane * this->ghost_front], lane_sites, front);
+        std::memcpy(&this->halo_send_back[(size_t) lane * this->ghost_back], lane_sites + this->length - back, back);
+    }
+
+    this->transport->sendRecv(this->halo_send_front.data(), this->halo_send_front.size(), prev_rank,
+                              this->halo_recv_front.data(), this->halo_recv_front.size(), next_rank, 0);
+    this->transport->sendRecv(this->halo_send_back.data(), this->halo_send_back.size(), next_rank,
+                              this->halo_recv_back.data(), this->halo_recv_back.size(), prev_rank, 1);
+
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        uint8_t* lane_sites = this->laneSites(this->sites, lane);
+        if (next_rank != TRANSPORT_NO_RANK) {
+            std::memcpy(lane_sites + this->length, &this->halo_recv_front[(size_t) lane * this->ghost_front], front);
+        }
+        if (prev_rank != TRANSPORT_NO_RANK) {
+            std::memcpy(lane_sites - back, &this->halo_recv_back[(size_t) lane * this->ghost_back], back);
+        }
+    }
+}
+
+/**
+ * Packs a range of sites of the segment into a deep halo message, with the number of Vehicles in the range of each
+ * Lane, the sites of each Lane and then the trip data of the Vehicles of each Lane
+ * @param first the first site of the range
+ * @param count the number of sites in the range
+ * @param buffer the buffer of the message
+ */
+void LatticeEngine::packRegion(int first, int count, std::vector<uint8_t>& buffer) {
+    uint8_t* counts = buffer.data();
+    uint8_t* region_sites = counts + this->num_lanes * sizeof(int32_t);
+    uint8_t* region_vehicles = region_sites + (size_t) this->num_lanes * count;
+
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        const uint8_t* lane_sites = this->laneSites(this->sites, lane);
+        const int32_t num_ahead = countOccupied(lane_sites, first + count, this->end_site - first - count);
+        const int32_t num_region = countOccupied(lane_sites, first, count);
+        std::memcpy(counts + lane * sizeof(int32_t), &num_region, sizeof(int32_t));
+        std::memcpy(region_sites + (size_t) lane * count, lane_sites + first, count);
+        std::memcpy(region_vehicles, this->vehicles[lane].data() + num_ahead, num_region * sizeof(LatticeVehicle));
+        region_vehicles += num_region * sizeof(LatticeVehicle);
+    }
+}
+
+/**
+ * Replaces the ghost regions of the segment with the sites and Vehicles of the neighboring processes at the same
+ * step, which are exact, while the ghost sites updated locally since the last exchange are only exact far enough
+ * from the ends of the ghost regions
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+void LatticeEngine::exchangeDeepHalos(int rank, int size) {
+    const int prev_rank = (rank > 0) ? rank - 1 : TRANSPORT_NO_RANK;
+    const int next_rank = (rank < size - 1) ? rank + 1 : TRANSPORT_NO_RANK;
+
+    // The first sites of the segment are the front ghost sites of the previous process, and the last sites are the
+    // back ghost sites of the next process
+    if (prev_rank != TRANSPORT_NO_RANK) {
+        this->packRegion(0, this->compute_front, this->halo_send_front);
+    }
+    if (next_rank != TRANSPORT_NO_RANK) {
+        this->packRegion(this->length - this->compute_back, this->compute_back, this->halo_send_back);
+    }
+
+    this->transport->sendRecv(this->halo_send_front.data(), this->halo_send_front.size(), prev_rank,
+                              this->halo_recv_front.data(), this->halo_recv_front.size(), next_rank, 0);
+    this->transport->sendRecv(this->halo_send_back.data(), this->halo_send_back.size(), next_rank,
+                              this->halo_recv_back.data(), this->halo_recv_back.size(), prev_rank, 1);
+
+    // Rebuild the side table of each Lane from the Vehicles of the front ghost region, the Vehicles of the segment and
+    // the Vehicles of the back ghost region, and copy in the ghost sites
+    const uint8_t* front_vehicles = this->halo_recv_front.data() + this->num_lanes * sizeof(int32_t) +
+                                    (size_t) this->num_lanes * this->compute_front;
+    const uint8_t* back_vehicles = this->halo_recv_back.data() + this->num_lanes * sizeof(int32_t) +
+                                   (size_t) this->num_lanes * this->compute_back;
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        uint8_t* lane_sites = this->laneSites(this->sites, lane);
+        const std::vector<LatticeVehicle>& lane_vehicles = this->vehicles[lane];
+        std::vector<LatticeVehicle>& new_lane_vehicles = this->next_vehicles[lane];
+        const int num_front = countOccupied(lane_sites, this->length, this->end_site - this->length);
+        const int num_back = countOccupied(lane_sites, this->first_site, -this->first_site);
+        new_lane_vehicles.clear();
+
+        if (next_rank != TRANSPORT_NO_RANK) {
+            int32_t num_region;
+            std::memcpy(&num_region, this->halo_recv_front.data() + lane * sizeof(int32_t), sizeof(int32_t));
+            const LatticeVehicle* region = reinterpret_cast<const LatticeVehicle*>(front_vehicles);
+            new_lane_vehicles.insert(new_lane_vehicles.end(), region, region + num_region);
+            front_vehicles += num_region * sizeof(LatticeVehicle);
+            std::memcpy(lane_sites + this->length,
+                        this->halo_recv_front.data() + this->num_lanes * sizeof(int32_t) +
+                        (size_t) lane * this->compute_front, this->compute_front);
+        }
+        new_lane_vehicles.insert(new_lane_vehicles.end(), lane_vehicles.begin() + num_front,
+                                 lane_vehicles.end() - num_back);
+        if (prev_rank != TRANSPORT_NO_RANK) {
+            int32_t num_region;
+            std::memcpy(&num_region, this->halo_recv_back.data() + lane * sizeof(int32_t), sizeof(int32_t));
+            const LatticeVehicle* region = reinterpret_cast<const LatticeVehicle*>(back_vehicles);
+            new_lane_vehicles.insert(new_lane_vehicles.end(), region, region + num_region);
+            back_vehicles += num_region * sizeof(LatticeVehicle);
+            std::memcpy(lane_sites - this->compute_back,
+                        this->halo_recv_back.data() + this->num_lanes * sizeof(int32_t) +
+                        (size_t) lane * this->compute_back, this->compute_back);
+        }
+    }
+    this->vehicles.swap(this->next_vehicles);
+}
+
+/**
+ * Counts the Vehicles in the segment, leaving out the Vehicles in the ghost sites that belong to the neighboring
+ * processes
+ * @return the number of Vehicles in the segment
+ */
+int LatticeEngine::countOwnedVehicles() {
+    int num_vehicles = 0;
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        const uint8_t* lane_sites = this->laneSites(this->sites, lane);
+        num_vehicles += this->vehicles[lane].size();
+        num_vehicles -= countOccupied(lane_sites, this->length, this->end_site - this->length);
+        num_vehicles -= countOccupied(lane_sites, this->first_site, -this->first_site);
+    }
+    return num_vehicles;
+}
+
+/**
+ * Performs the lane changes of all the Vehicles in one streaming pass over the lattice, using the same gaps as
+ * Vehicle::updateGaps and the lane change rule of the rule set
+ * @tparam RuleSet the rule set of the cellular automaton
+ */
+template <class RuleSet>
+void LatticeEngine::performLaneSwitches() {
+    if (this->num_lanes < 2) {
+        return;
+    }
+
+    const int look_back = this->inputs.look_other_backward;
+    std::vector<int>& cursors = this->lane_cursors;
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        this->next_vehicles[lane].clear();
+        cursors[lane] = 0;
+    }
+
+    for (int i = this->end_site - 1; i >= this->first_site;) {
+        // Skip blocks of sites that are empty in every Lane
+        if (i - 7 >= this->first_site) {
+            bool all_empty = true;
+            for (int lane = 0; lane < this->num_lanes && all_empty; lane++) {
+                all_empty = blockIsEmpty(this->laneSites(this->sites, lane) + i - 7);
+            }
+            if (all_empty) {
+                for (int lane = 0; lane < this->num_lanes; lane++) {
+                    std::memset(this->laneSites(this->next_sites, lane) + i - 7, 0, 8);
+                }
+                i -= 8;
+                continue;
+            }
+        }
+
+        for (int lane = 0; lane < this->num_lanes; lane++) {
+            this->laneSites(this->next_sites, lane)[i] = this->laneSites(this->closed_sites, lane)[i];
+        }
+        for (int lane = 0; lane < this->num_lanes; lane++) {
+            const uint8_t* lane_sites = this->laneSites(this->sites, lane);
+            const uint8_t site = lane_sites[i];
+            if ((site & SITE_OCCUPIED) == 0) {
+                continue;
+            }
+            LatticeVehicle vehicle = this->vehicles[lane][cursors[lane]++];
+            const int speed = site & SITE_SPEED_MASK;
+
+            // Measure the gaps up to the distances that the lane change rule compares them with, in the Lane to the
+            // left if the Vehicle has room to move there and otherwise in the Lane to the right, like
+            // Vehicle::updateGaps
+            int other_lane = (lane + 1 < this->num_lanes) ? lane + 1 : lane - 1;
+            const uint8_t* other_sites = this->laneSites(this->sites, other_lane);
+            int gap_other_forward = gapAhead(other_sites, i, 0, speed + 2);
+            int gap_other_backward = gapBehind(other_sites, i, look_back + 1);
+            if (other_lane > lane && lane > 0 && (gap_other_forward <= speed + 1 || gap_other_backward <= look_back)) {
+                other_lane = lane - 1;
+                other_sites = this->laneSites(this->sites, other_lane);
+                gap_other_forward = gapAhead(other_sites, i, 0, speed + 2);
+                gap_other_backward = gapBehind(other_sites, i, look_back + 1);
+            }
+            uint8_t* next_other_sites = this->laneSites(this->next_sites, other_lane);
+            const int gap_forward = gapAhead(lane_sites, i, 1, speed + 1);
+
+            Random::beginStream(vehicle.id, vehicle.time_on_road, Random::STREAM_LANE_CHANGE);
+            if (next_other_sites[i] == 0 &&
+                RuleSet::changesLane(gap_forward, speed + 1, gap_other_forward, speed + 1, gap_other_backward,
+                                     look_back, this->inputs.prob_change)) {
+                vehicle.lane_changes++;
+                next_other_sites[i] = site;
+                this->next_vehicles[other_lane].push_back(vehicle);
+            } else {
+                this->laneSites(this->next_sites, lane)[i] = site;
+                this->next_vehicles[lane].push_back(vehicle);
+            }
+        }
+        i--;
+    }
+
+    this->sites.swap(this->next_sites);
+    this->vehicles.swap(this->next_vehicles);
+}
+
+/**
+ * Moves all the Vehicles in one streaming pass over each Lane with the speed update rules of the rule set. Vehicles
+ * that leave the segment are packed for the next process or removed from the road, and with deep halos Vehicles that
+ * leave the front ghost region are dropped since the next process owns them.
+ * @tparam RuleSet the rule set of the cellular automaton
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return sum of the speeds of the Vehicles of the segment that moved
+ */
+template <class RuleSet>
+long LatticeEngine::performLaneMoves(int rank, int size) {
+    const int max_speed = this->inputs.max_speed;
+    const bool render = this->raster->isEnabled();
+    long speed_sum = 0;
+    this->send_buffer.clear();
+
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        const uint8_t* lane_sites = this->laneSites(this->sites, lane);
+        uint8_t* next_lane_sites = this->laneSites(this->next_sites, lane);
+        const uint8_t* closed = this->laneSites(this->closed_sites, lane);
+        const uint8_t* lane_speed_limits = this->laneSites(this->speed_limits, lane);
+        const std::vector<LatticeVehicle>& lane_vehicles = this->vehicles[lane];
+        std::vector<LatticeVehicle>& next_lane_vehicles = this->next_vehicles[lane];
+        next_lane_vehicles.clear();
+        int cursor = 0;
+
+        for (int i = this->end_site - 1; i >= this->first_site;) {
+            // Skip blocks of empty sites
+            if (i - 7 >= this->first_site && blockIsEmpty(lane_sites + i - 7)) {
+                std::memset(next_lane_sites + i - 7, 0, 8);
+                i -= 8;
+                continue;
+            }
+
+            next_lane_sites[i] = closed[i];
+            const uint8_t site = lane_sites[i];
+            if ((site & SITE_OCCUPIED) == 0) {
+                i--;
+                continue;
+            }
+            LatticeVehicle vehicle = lane_vehicles[cursor++];
+
+            // Update the speed with the gap ahead, which only matters up to the maximum speed, and the speed limit of
+            // the site
+            const int gap_forward = gapAhead(lane_sites, i, 1, max_speed);
+            vehicle.time_on_road++;
+            Random::beginStream(vehicle.id, vehicle.time_on_road, Random::STREAM_SPEED);
+            const int speed = RuleSet::updateSpeed(site & SITE_SPEED_MASK, lane_speed_limits[i], gap_forward,
+                                                   this->inputs.prob_slow_down, this->inputs.prob_slow_down_stopped);
+            vehicle.distance += speed;
+            speed_sum += ((unsigned) i < (unsigned) this->length) ? speed : 0;
+
+            const int new_position = i + speed;
+            if (new_position < this->end_site) {
+                next_lane_sites[new_position] = SITE_OCCUPIED | speed;
+                next_lane_vehicles.push_back(vehicle);
+
+                // Add the Vehicles of the segment that stay on it to the space-time raster, like the Vehicle engine
+                if (render && (unsigned) i < (unsigned) this->length && new_position < this->length) {
+                    this->raster->addVehicle(new_position, speed);
+                }
+            } else if (rank < size - 1 && this->halo_steps == 0) {
+                // Pack the Vehicle for the next process, with its position relative to the start of the next segment
+                MigratingVehicle migrating;
+                migrating.lane = lane;
+                migrating.position = new_position - this->length;
+                migrating.speed = speed;
+                migrating.padding = 0;
+                migrating.vehicle = vehicle;
+                const char* bytes = reinterpret_cast<const char*>(&migrating);
+                this->send_buffer.insert(this->send_buffer.end(), bytes, bytes + sizeof(MigratingVehicle));
+            } else if (rank == size - 1) {
+                // Update travel time statistic if beyond warm-up period, and record the trip
+                if (this->time + 1 > this->inputs.warmup_time) {
+                    this->travel_time->addValue(this->inputs.step_size * vehicle.time_on_road);
+                }
+                this->trip_log->addTrip(vehicle.id, this->time + 1, vehicle.time_on_road, vehicle.lane_changes, lane,
+                                        vehicle.distance);
+                this->run_length->addTrip(this->inputs.step_size * vehicle.time_on_road);
+            }
+            i--;
+        }
+    }
+
+    this->sites.swap(this->next_sites);
+    this->vehicles.swap(this->next_vehicles);
+
+    return speed_sum;
+}
+
+/**
+ * Sends the Vehicles that left the segment to the next process and places the Vehicles received from the previous
+ * process, which land behind all the Vehicles of the segment
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+void LatticeEngine::communicateVehicles(int rank, int size) {
+    int send_rank = (rank < size - 1) ? rank + 1 : TRANSPORT_NO_RANK;
+    int recv_rank = (rank > 0) ? rank - 1 : TRANSPORT_NO_RANK;
+
+    int send_size = this->send_buffer.size();
+    int recv_size = 0;
+    this->transport->sendRecv(&send_size, sizeof(int), send_rank, &recv_size, sizeof(int), recv_rank, 0);
+
+    this->recv_buffer.resize(recv_size);
+    this->transport->sendRecv(this->send_buffer.data(), send_size, send_rank, this->recv_buffer.data(), recv_size,
+                              recv_rank, 0);
+
+    for (int offset = 0; offset + (int) sizeof(MigratingVehicle) <= recv_size; offset += sizeof(MigratingVehicle)) {
+        MigratingVehicle migrating;
+        std::memcpy(&migrating, &this->recv_buffer[offset], sizeof(MigratingVehicle));
+
+        // A Vehicle that does not fit on the segment is a bug of the sender, so debug builds stop on it and the other
+        // builds count it for the report of the run
+        const bool fits = migrating.lane >= 0 && migrating.lane < this->num_lanes && migrating.position >= 0 &&
+                          migrating.position < this->length &&
+                          this->laneSites(this->sites, migrating.lane)[migrating.position] == 0;
+#ifdef DEBUG
+        assert(fits);
+#endif
+        if (!fits) {
+            this->dropped_vehicles++;
+            continue;
+        }
+        uint8_t* lane_sites = this->laneSites(this->sites, migrating.lane);
+        lane_sites[migrating.position] = SITE_OCCUPIED | migrating.speed;
+        this->vehicles[migrating.lane].push_back(migrating.vehicle);
+    }
+}
+
+/**
+ * Attempts to spawn a Vehicle at the first site of each Lane from the ArrivalSchedule, as in Lane::attemptSpawn
+ */
+void LatticeEngine::attemptSpawn() {
+    for (int lane = 0; lane < this->num_lanes; lane++) {
+        uint8_t* lane_sites = this->laneSites(this->sites, lane);
+        if (!this->arrivals->hasDueArrival(lane, this->time) || lane_sites[0] != 0) {
+            continue;
+        }
+        this->arrivals->popArrival(lane);
+
+        // Spawn at the maximum speed, or stopped with the slow down probability, with the random stream of the spawns of
+        // this Lane in this step
+        Random::beginStream(lane, this->time, Random::STREAM_SPAWN);
+        int speed = this->inputs.max_speed;
+        if (Random::uniform() < this->inputs.prob_slow_down) {
+            speed = 0;
+        }
+        lane_sites[0] = SITE_OCCUPIED | speed;
+        LatticeVehicle vehicle;
+        vehicle.id = (int64_t) this->time * this->num_lanes + lane;
+        vehicle.distance = 0;
+        vehicle.time_on_road = 0;
+        vehicle.lane_changes = 0;
+        this->vehicles[lane].push_back(vehicle);
+    }
+}
+
+/**
+ * Marks the start of a phase of the step for the telemetry and the hardware counters
+ * @param phase the phase that is starting
+ */
+void LatticeEngine::beginPhase(int phase) {
+    this->telemetry->beginPhase(phase);
+    this->counters->beginPhase(phase);
+}
+
+/**
+ * Executes the steps of the simulation with the rules of a rule set
+ * @tparam RuleSet the rule set of the cellular automaton
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+template <class RuleSet>
+void LatticeEngine::run_steps(int rank, int size) {
+    while (this->time < this->inputs.max_time) {
+        // With deep halos the ghost regions are only exchanged every few steps, and otherwise updated locally
+        this->beginPhase(TelemetryRing::PHASE_GAP_EXCHANGE);
+        if (this->halo_steps == 0) {
+            this->exchangeHalos(rank, size);
+        } else if (this->time % this->halo_steps == 0) {
+            this->exchangeDeepHalos(rank, size);
+        }
+
+        this->beginPhase(TelemetryRing::PHASE_LANE_SWITCH);
+        this->performLaneSwitches<RuleSet>();
+
+        if (this->halo_steps == 0) {
+            this->beginPhase(TelemetryRing::PHASE_GAP_EXCHANGE);
+            this->exchangeHalos(rank, size);
+        }
+
+        this->beginPhase(TelemetryRing::PHASE_LANE_MOVE);
+        int num_moved = this->countOwnedVehicles();
+        long speed_sum = this->performLaneMoves<RuleSet>(rank, size);
+        this->time++;
+        this->observables->post(this->time, num_moved, speed_sum, rank);
+
+        if (this->halo_steps == 0) {
+            this->beginPhase(TelemetryRing::PHASE_BOUNDARY);
+            this->communicateVehicles(rank, size);
+        }
+
+        this->beginPhase(TelemetryRing::PHASE_SPAWN);
+        if (rank == 0) {
+            this->attemptSpawn();
+        }
+
+        int num_vehicles = this->countOwnedVehicles();
+        this->telemetry->endStep(this->time, num_vehicles, rank);
+        this->counters->endStep(num_vehicles);
+        this->vehicle_steps += num_vehicles;
+        this->trip_log->endStep(this->time);
+        this->raster->endStep(this->time);
+        if (this->run_length->endStep(this->time)) {
+            break;
+        }
+    }
+}
+
+/**
+ * Runs the simulation with the lattice engine
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return 0 if successful, nonzero otherwise
+ */
+int LatticeEngine::run(int rank, int size) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    this->time = 0;
+    this->vehicle_steps = 0;
+    this->dropped_vehicles = 0;
+    bool known_rule_set = RuleSets::withRuleSet(this->inputs.rule_set, [&](auto rule_set) {
+        this->run_steps<decltype(rule_set)>(rank, size);
+    });
+    if (!known_rule_set) {
+        if (rank == 0) {
+            std::cout << "error: unknown rule set " << this->inputs.rule_set << "!" << std::endl;
+        }
+        return 1;
+    }
+
+    this->observables->finish(rank);
+    this->telemetry->finish(rank);
+    this->counters->report(this->transport, rank);
+    this->trip_log->flush();
+    this->raster->finish();
+    this->run_length->finish(this->time, rank, this->quiet);
+
+    this->transport->barrier();
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double time_elapsed = (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000000.0;
+    double max_time_elapsed;
+    this->transport->reduce(&time_elapsed, &max_time_elapsed, 1, REDUCE_MAX, 0);
+    int64_t total_dropped_vehicles;
+    this->transport->allReduce(&this->dropped_vehicles, &total_dropped_vehicles, 1, REDUCE_SUM);
+
+    if (rank == 0 && !this->quiet) {
+        const double site_updates = (double) this->num_lanes * this->length * size * this->time;
+        std::cout << "--- Simulation Performance ---" << std::endl;
+        std::cout << "Total computation time (max across all processes): " << max_time_elapsed << " [s]" << std::endl;
+        std::cout << "Average time per iteration: " << max_time_elapsed / this->time << " [s]" << std::endl;
+        std::cout << "Average iterating frequency: " << this->time / max_time_elapsed << " [iter/s]" << std::endl;
+        std::cout << "Site updates per second: " << site_updates / max_time_elapsed << std::endl;
+        std::cout << "Lattice memory per process: "
+                  << (this->sites.size() + this->next_sites.size()) / (1024.0 * 1024.0) << " [MiB]" << std::endl;
+        std::cout << "Vehicles dropped at the segment boundaries (sum across all processes): " << total_dropped_vehicles
+                  << std::endl;
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Gets the mean number of Vehicles owned by this process over the steps of the run
+ * @return the mean number of Vehicles
+ */
+double LatticeEngine::getMeanVehicles() {
+    return (this->time > 0) ? (double) this->vehicle_steps / this->time : 0.0;
+}
+
+/**
+ * Sets whether the run prints its run length and performance reports, like Simulation::setQuiet
+ * @param quiet true to leave out the reports, false otherwise
+ */
+void LatticeEngine::setQuiet(bool quiet) {
+    this->quiet = quiet;
+}
+
+/**
+ * Gets the mean travel time of the Vehicles that left the road after the warm-up period, collective over all the
+ * processes. An adaptive run uses the warm-up that it detected, as in its report.
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return the mean travel time, from the process at the end of the road
+ */
+double LatticeEngine::getMeanTravelTime(int rank, int size) {
+    if (this->run_length->isEnabled()) {
+        return this->run_length->getMeanTravelTime();
+    }
+
+    double mean_travel_time = 0.0;
+    if (rank == size - 1) {
+        mean_travel_time = this->travel_time->getAverage();
+    }
+    this->transport->broadcast(&mean_travel_time, sizeof(double), size - 1);
+    return mean_travel_time;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_LATTICEENGINE_H
+#define CA_TRAFFIC_SIMULATION_LATTICEENGINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Inputs.h"
+#include "Transport.h"
+#include "CDF.h"
+#include "ArrivalSchedule.h"
+#include "Statistic.h"
+#include "Observables.h"
+#include "PerfCounters.h"
+#include "Telemetry.h"
+#include "TripLog.h"
+#include "SpaceTimeRaster.h"
+#include "RunLength.h"
+
+/**
+ * Trip data of a Vehicle in the LatticeEngine, kept in a side table per Lane in the order of the Vehicles along the
+ * Lane, from the end of the segment to its start
+ */
+struct LatticeVehicle {
+    int64_t id;
+    int64_t distance;
+    int32_t time_on_road;
+    int32_t lane_changes;
+};
+
+/**
+ * Class for the engine that keeps the whole state of its segment of the road in the lattice, with one byte per site
+ * holding an occupied flag and the speed of the Vehicle in the site. Vehicles cannot overtake within a Lane, so their
+ * identity and trip data live in a side table per Lane that is in the same order as the occupied sites, and the
+ * k-th occupied site of a Lane belongs to the k-th entry of its side table. Each update is a streaming pass from the
+ * end of the segment to its start that reads the old lattice and side tables and writes new ones. The segments are
+ * divided between the processes as in the Simulation, with ghost sites from the neighboring processes for the gaps.
+ * Closed sites of the Scenario hold a marker without the occupied flag that every gap sees as an obstacle, and the
+ * speed limit of each site is looked up from a flat array in the move pass.
+ *
+ * With deep halos, the ghost regions are deep enough for several steps and come with the trip data of their
+ * Vehicles, so each process also updates the ghost sites, with the same keyed random streams as their owner, and only
+ * exchanges the ghost regions once every that many steps. Vehicles are then owned by the process whose segment they
+ * are in, and no Vehicles are sent between the processes.
+ */
+class LatticeEngine {
+private:
+    Transport* transport;
+    Inputs inputs;
+    int num_lanes;
+    int length;
+    int ghost_back;
+    int ghost_front;
+    int lane_stride;
+    int halo_steps;
+    int compute_back;
+    int compute_front;
+    int first_site;
+    int end_site;
+    int time;
+    long vehicle_steps;
+    int64_t dropped_vehicles;
+    bool quiet;
+    std::vector<uint8_t> sites;
+    std::vector<uint8_t> next_sites;
+    std::vector<uint8_t> closed_sites;
+    std::vector<uint8_t> speed_limits;
+    std::vector<std::vector<LatticeVehicle>> vehicles;
+    std::vector<std::vector<LatticeVehicle>> next_vehicles;
+    std::vector<int> lane_cursors;
+    std::vector<uint8_t> halo_send_back;
+    std::vector<uint8_t> halo_send_front;
+    std::vector<uint8_t> halo_recv_back;
+    std::vector<uint8_t> halo_recv_front;
+    std::vector<char> send_buffer;
+    std::vector<char> recv_buffer;
+    CDF* interarrival_time_cdf;
+    ArrivalSchedule* arrivals;
+    Statistic* travel_time;
+    Observables* observables;
+    Telemetry* telemetry;
+    PerfCounters* counters;
+    TripLog* trip_log;
+    SpaceTimeRaster* raster;
+    RunLength* run_length;
+    uint8_t* laneSites(std::vector<uint8_t>& buffer, int lane);
+    void exchangeHalos(int rank, int size);
+    void packRegion(int first, int count, std::vector<uint8_t>& buffer);
+    void exchangeDeepHalos(int rank, int size);
+    int countOwnedVehicles();
+    template <class RuleSet>
+    void performLaneSwitches();
+    template <class RuleSet>
+    long performLaneMoves(int rank, int size);
+    void communicateVehicles(int rank, int size);
+    void attemptSpawn();
+    void beginPhase(int phase);
+    template <class RuleSet>
+    void run_steps(int rank, int size);
+public:
+    LatticeEngine(Transport* transport, const Inputs& inputs, int rank, int size);
+    ~LatticeEngine();
+    int run(int rank, int size);
+    double getMeanTravelTime(int rank, int size);
+    double getMeanVehicles();
+    void setQuiet(bool quiet);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_LATTICEENGINE_H
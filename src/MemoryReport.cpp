@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+
+#include "MemoryReport.h"
+
+// Number of bytes in a megabyte of the report
+const double MEMORY_MEGABYTE = 1024.0 * 1024.0;
+
+/**
+ * Constructor of the MemoryReport, with every category empty
+ * @param num_sites the number of sites of the rank
+ * @param num_vehicles the number of Vehicles of the rank
+ */
+MemoryReport::MemoryReport(int64_t num_sites, int64_t num_vehicles) {
+    std::fill(this->bytes, this->bytes + MEMORY_NUM_CATEGORIES, 0);
+    this->num_sites = num_sites;
+    this->num_vehicles = num_vehicles;
+}
+
+/**
+ * Adds storage to a category
+ * @param category the category of the storage
+ * @param num_bytes the number of bytes
+ */
+void MemoryReport::add(MemoryCategory category, int64_t num_bytes) {
+    this->bytes[category] += num_bytes;
+}
+
+/**
+ * Gets the peak resident set size of the process. The ranks that run as threads of one process share it.
+ * @return the peak resident set size in bytes, or 0 if it is not available
+ */
+int64_t MemoryReport::getPeakResidentBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports the peak resident set size in kilobytes
+    return (int64_t) usage.ru_maxrss * 1024;
+}
+
+/**
+ * Prints the memory of every rank and the total over the ranks, collective over all the ranks. The sites are charged
+ * the site storage and the Vehicles the Vehicle state.
+ * @param transport the Transport of the rank
+ * @param title the title of the report
+ */
+void MemoryReport::print(Transport* transport, const std::string& title) {
+    const int rank = transport->getRank();
+    const int size = transport->getSize();
+
+    // Gather the entries of all the ranks
+    const int num_values = MEMORY_NUM_CATEGORIES + 3;
+    std::vector<int64_t> entry(num_values, 0);
+    std::vector<int64_t> values((size_t) size * num_values, 0);
+    std::copy(this->bytes, this->bytes + MEMORY_NUM_CATEGORIES, entry.begin());
+    entry[MEMORY_NUM_CATEGORIES] = this->num_sites;
+    entry[MEMORY_NUM_CATEGORIES + 1] = this->num_vehicles;
+    entry[MEMORY_NUM_CATEGORIES + 2] = getPeakResidentBytes();
+    transport->allGather(entry.data(), num_values * sizeof(int64_t), values.data());
+
+    if (rank == 0) {
+        const std::ios_base::fmtflags flags = std::cout.flags();
+        const std::streamsize precision = std::cout.precision();
+
+        // Add up the ranks into the total, where the peak resident set size is the largest of the processes
+        std::vector<int64_t> total(num_values, 0);
+        for (int r = 0; r < size; r++) {
+            for (int i = 0; i < num_values; i++) {
+                const int64_t value = values[(size_t) r * num_values + i];
+                total[i] = (i == num_values - 1) ? std::max(total[i], value) : total[i] + value;
+            }
+        }
+
+        std::cout << "--- Memory (" << title << ") ---" << std::endl;
+        std::cout << std::setw(6) << "rank" << std::setw(11) << "sites" << std::setw(11) << "vehicles"
+                  << std::setw(11) << "stats" << std::setw(11) << "buffers" << std::setw(11) << "total"
+                  << std::setw(11) << "peak rss" << std::setw(10) << "B/site" << std::setw(10) << "B/vehicle"
+                  << std::endl;
+        for (int r = 0; r <= size; r++) {
+            const int64_t* row = (r < size) ? values.data() + (size_t) r * num_values : total.data();
+            int64_t row_total = 0;
+            std::cout << std::fixed << std::setprecision(2);
+            if (r < size) {
+                std::cout << std::setw(6) << r;
+            } else {
+                std::cout << std::setw(6) << "all";
+            }
+            for (int i = 0; i < MEMORY_NUM_CATEGORIES; i++) {
+                std::cout << std::setw(9) << row[i] / MEMORY_MEGABYTE << "MB";
+                row_total += row[i];
+            }
+            std::cout << std::setw(9) << row_total / MEMORY_MEGABYTE << "MB" << std::setw(9)
+                      << row[MEMORY_NUM_CATEGORIES + 2] / MEMORY_MEGABYTE << "MB";
+            const int64_t sites = row[MEMORY_NUM_CATEGORIES];
+            const int64_t vehicles = row[MEMORY_NUM_CATEGORIES + 1];
+            std::cout << std::setw(10) << (sites > 0 ? (double) row[MEMORY_SITES] / sites : 0.0) << std::setw(10)
+                      << (vehicles > 0 ? (double) row[MEMORY_VEHICLES] / vehicles : 0.0) << std::endl;
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_MEMORYREPORT_H
+#define CA_TRAFFIC_SIMULATION_MEMORYREPORT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Transport.h"
+
+// Categories of the memory of a rank
+enum MemoryCategory {
+    MEMORY_SITES,
+    MEMORY_VEHICLES,
+    MEMORY_STATISTICS,
+    MEMORY_BUFFERS,
+    MEMORY_NUM_CATEGORIES
+};
+
+/**
+ * Class for the memory footprint of a rank, in bytes per category. The objects of the simulation add the storage
+ * they hold, which for a vector is its capacity rather than its size, so the report shows what the rank has actually
+ * claimed. Together with the number of sites and Vehicles of the rank, the report gives the bytes per site and per
+ * Vehicle that a job on a longer road or with heavier traffic will need, and the peak resident set size of the
+ * process shows how much is claimed outside the accounted storage.
+ */
+class MemoryReport {
+private:
+    int64_t bytes[MEMORY_NUM_CATEGORIES];
+    int64_t num_sites;
+    int64_t num_vehicles;
+public:
+    MemoryReport(int64_t num_sites, int64_t num_vehicles);
+    void add(MemoryCategory category, int64_t num_bytes);
+    template <class T>
+    void addVector(MemoryCategory category, const std::vector<T>& values);
+    void print(Transport* transport, const std::string& title);
+    static int64_t getPeakResidentBytes();
+};
+
+/**
+ * Adds the storage of a vector to a category
+ * @tparam T the type of the elements of the vector
+ * @param category the category of the storage
+ * @param values the vector
+ */
+template <class T>
+void MemoryReport::addVector(MemoryCategory category, const std::vector<T>& values) {
+    this->add(category, (int64_t) values.capacity() * sizeof(T));
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_MEMORYREPORT_H
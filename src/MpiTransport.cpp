@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+
+#include "MpiTransport.h"
+
+namespace {
+    /**
+     * Gets the MPI operation of a reduction operation
+     * @param op the reduction operation
+     * @return the MPI operation
+     */
+    MPI_Op mpiOp(ReduceOp op) {
+        return (op == REDUCE_MAX) ? MPI_MAX : MPI_SUM;
+    }
+
+    /**
+     * Gets the MPI rank of a rank given to the Transport
+     * @param rank the rank, or TRANSPORT_NO_RANK
+     * @return the rank, or MPI_PROC_NULL
+     */
+    int mpiRank(int rank) {
+        return (rank == TRANSPORT_NO_RANK) ? MPI_PROC_NULL : rank;
+    }
+
+    /**
+     * File written collectively with MPI-IO
+     */
+    class MpiTransportFile : public TransportFile {
+    private:
+        MPI_File file;
+    public:
+        MpiTransportFile(MPI_File file) {
+            this->file = file;
+        }
+
+        ~MpiTransportFile() {
+            MPI_File_close(&this->file);
+        }
+
+        void writeAtAll(int64_t offset, const void* data, int num_bytes) {
+            MPI_File_write_at_all(this->file, (MPI_Offset) offset, data, num_bytes, MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+    };
+}
+
+/**
+ * Constructor for the MpiTransport, which initializes MPI
+ * @param argc pointer to the number of command line arguments
+ * @param argv pointer to the command line arguments
+ */
+MpiTransport::MpiTransport(int* argc, char*** argv) {
+    MPI_Init(argc, argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &this->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &this->size);
+    for (int i = 0; i < MPI_TRANSPORT_MAX_REQUESTS; i++) {
+        this->requests[i] = MPI_REQUEST_NULL;
+    }
+}
+
+/**
+ * Destructor for the MpiTransport, which finalizes MPI
+ */
+MpiTransport::~MpiTransport() {
+    MPI_Finalize();
+}
+
+/**
+ * Finds a request slot that is not in use
+ * @return index of the request slot
+ */
+int MpiTransport::takeRequest() {
+    for (int i = 0; i < MPI_TRANSPORT_MAX_REQUESTS; i++) {
+        if (this->requests[i] == MPI_REQUEST_NULL) {
+            return i;
+        }
+    }
+    std::cout << "error: too many pending nonblocking operations!" << std::endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+    return -1;
+}
+
+int MpiTransport::getRank() const {
+    return this->rank;
+}
+
+int MpiTransport::getSize() const {
+    return this->size;
+}
+
+void MpiTransport::barrier() {
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void MpiTransport::broadcast(void* data, int num_bytes, int root) {
+    MPI_Bcast(data, num_bytes, MPI_BYTE, root, MPI_COMM_WORLD);
+}
+
+void MpiTransport::sendRecv(const void* send_data, int send_bytes, int dest, void* recv_data, int recv_bytes,
+                            int source, int tag) {
+    MPI_Sendrecv(send_data, send_bytes, MPI_BYTE, mpiRank(dest), tag, recv_data, recv_bytes, MPI_BYTE,
+                 mpiRank(source), tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+
+void MpiTransport::reduce(const double* values, double* results, int count, ReduceOp op, int root) {
+    MPI_Reduce(values, results, count, MPI_DOUBLE, mpiOp(op), root, MPI_COMM_WORLD);
+}
+
+void MpiTransport::allReduce(const double* values, double* results, int count, ReduceOp op) {
+    MPI_Allreduce(values, results, count, MPI_DOUBLE, mpiOp(op), MPI_COMM_WORLD);
+}
+
+void MpiTransport::allReduce(const int64_t* values, int64_t* results, int count, ReduceOp op) {
+    MPI_Allreduce(values, results, count, MPI_INT64_T, mpiOp(op), MPI_COMM_WORLD);
+}
+
+void MpiTransport::exclusiveScan(const int64_t* values, int64_t* results, int count) {
+    MPI_Exscan(values, results, count, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    // The result of the prefix sum is undefined on rank 0
+    if (this->rank == 0) {
+        for (int i = 0; i < count; i++) {
+            results[i] = 0;
+        }
+    }
+}
+
+void MpiTransport::allGather(const void* data, int num_bytes, void* results) {
+    MPI_Allgather(data, num_bytes, MPI_BYTE, results, num_bytes, MPI_BYTE, MPI_COMM_WORLD);
+}
+
+int MpiTransport::startReduce(const double* values, double* results, int count, ReduceOp op, int root) {
+    int request = this->takeRequest();
+    MPI_Ireduce(values, results, count, MPI_DOUBLE, mpiOp(op), root, MPI_COMM_WORLD, &this->requests[request]);
+    return request;
+}
+
+int MpiTransport::startAllReduce(const double* values, double* results, int count, ReduceOp op) {
+    int request = this->takeRequest();
+    MPI_Iallreduce(values, results, count, MPI_DOUBLE, mpiOp(op), MPI_COMM_WORLD, &this->requests[request]);
+    return request;
+}
+
+int MpiTransport::startSend(const void* data, int num_bytes, int dest, int tag) {
+    int request = this->takeRequest();
+    MPI_Isend(data, num_bytes, MPI_BYTE, mpiRank(dest), tag, MPI_COMM_WORLD, &this->requests[request]);
+    return request;
+}
+
+void MpiTransport::reserveMessages(int num_bytes, int dest, int tag) {
+    // MPI sends from the buffer of the caller, so there is nothing to reserve
+}
+
+int MpiTransport::startRecv(void* data, int num_bytes, int source, int tag) {
+    int request = this->takeRequest();
+    MPI_Irecv(data, num_bytes, MPI_BYTE, mpiRank(source), tag, MPI_COMM_WORLD, &this->requests[request]);
+    return request;
+}
+
+void MpiTransport::wait(int request) {
+    if (request >= 0 && request < MPI_TRANSPORT_MAX_REQUESTS) {
+        MPI_Wait(&this->requests[request], MPI_STATUS_IGNORE);
+    }
+}
+
+/**
+ * Opens a file for collective writes, discarding the contents of any existing file
+ * @param file_name name of the file
+ * @return the file, nullptr if it could not be opened
+ */
+TransportFile* MpiTransport::openFile(const char* file_name) {
+    MPI_File file;
+    int status = MPI_File_open(MPI_COMM_WORLD, file_name, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    if (status != MPI_SUCCESS) {
+        return nullptr;
+    }
+    MPI_File_set_size(file, 0);
+    return new MpiTransportFile(file);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_MPITRANSPORT_H
+#define CA_TRAFFIC_SIMULATION_MPITRANSPORT_H
+
+#include <mpi.h>
+
+#include "Transport.h"
+
+// Number of nonblocking operations that can be pending at the same time
+const int MPI_TRANSPORT_MAX_REQUESTS = 16;
+
+/**
+ * Transport between MPI processes, with one rank per process of MPI_COMM_WORLD. MPI is initialized by the constructor
+ * and finalized by the destructor.
+ */
+class MpiTransport : public Transport {
+private:
+    int rank;
+    int size;
+    MPI_Request requests[MPI_TRANSPORT_MAX_REQUESTS];
+    int takeRequest();
+public:
+    MpiTransport(int* argc, char*** argv);
+    ~MpiTransport();
+    int getRank() const;
+    int getSize() const;
+    void barrier();
+    void broadcast(void* data, int num_bytes, int root);
+    void sendRecv(const void* send_data, int send_bytes, int dest, void* recv_data, int recv_bytes, int source,
+                  int tag);
+    void reduce(const double* values, double* results, int count, ReduceOp op, int root);
+    void allReduce(const double* values, double* results, int count, ReduceOp op);
+    void allReduce(const int64_t* values, int64_t* results, int count, ReduceOp op);
+    void exclusiveScan(const int64_t* values, int64_t* results, int count);
+    void allGather(const void* data, int num_bytes, void* results);
+    int startReduce(const double* values, double* results, int count, ReduceOp op, int root);
+    int startAllReduce(const double* values, double* results, int count, ReduceOp op);
+    int startSend(const void* data, int num_bytes, int dest, int tag);
+    void reserveMessages(int num_bytes, int dest, int tag);
+    int startRecv(void* data, int num_bytes, int source, int tag);
+    void wait(int request);
+    TransportFile* openFile(const char* file_name);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_MPITRANSPORT_H
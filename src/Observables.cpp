@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+
+#include "Observables.h"
+
+// Number of records written to the observables file between flushes, so that live plots see recent data
+const int OBSERVABLES_FLUSH_INTERVAL = 100;
+
+/**
+ * Constructor for the Observables
+ * @param transport the Transport used to reduce the partial sums
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param rank the rank of the process
+ */
+Observables::Observables(Transport* transport, const Inputs& inputs, int rank) {
+    this->transport = transport;
+    this->interval = inputs.observables_interval;
+    this->num_road_sites = (double) inputs.num_lanes * (double) inputs.length;
+    this->request = -1;
+    this->request_pending = false;
+    this->pending_step = 0;
+    this->num_records = 0;
+
+    // Rank 0 receives the reduced observables and writes them to the output file
+    if (this->isEnabled() && rank == 0) {
+        this->output_file.open("cats-observables.dat", std::fstream::out);
+        if (!this->output_file) {
+            std::cout << "error: failure to open \"cats-observables.dat\" file!" << std::endl;
+            throw std::exception();
+        }
+    }
+}
+
+/**
+ * Destructor for the Observables
+ */
+Observables::~Observables() {
+    if (this->output_file.is_open()) {
+        this->output_file.close();
+    }
+}
+
+/**
+ * Checks whether the observables are computed in the simulation
+ * @return true if the observables are computed, false otherwise
+ */
+bool Observables::isEnabled() {
+    return this->interval > 0;
+}
+
+/**
+ * Completes the reduction of the pending step, if there is one, and writes its observables on rank 0
+ * @param rank the rank of the process
+ */
+void Observables::completePending(int rank) {
+    if (!this->request_pending) {
+        return;
+    }
+
+    this->transport->wait(this->request);
+    this->request_pending = false;
+
+    if (rank == 0) {
+        // Compute the road-wide observables from the reduced sums, with the flow in vehicles per site per step
+        double num_vehicles = this->global_sums[0];
+        double speed_sum = this->global_sums[1];
+        double mean_speed = num_vehicles > 0.0 ? speed_sum / num_vehicles : 0.0;
+        double density = num_vehicles / this->num_road_sites;
+        double flow = speed_sum / this->num_road_sites;
+
+        this->output_file << this->pending_step << "," << (long) num_vehicles << "," << mean_speed << ","
+                          << density << "," << flow << "\n";
+
+        this->num_records++;
+        if (this->num_records % OBSERVABLES_FLUSH_INTERVAL == 0) {
+            this->output_file.flush();
+        }
+    }
+}
+
+/**
+ * Posts the partial sums of the segment of this process for a step. The reduction of the previous step, which has
+ * been in flight during this step, is completed first.
+ * @param step the step that the partial sums belong to
+ * @param num_vehicles number of Vehicles that moved in the segment during the step
+ * @param speed_sum sum of the speeds of the Vehicles that moved in the segment during the step
+ * @param rank the rank of the process
+ */
+void Observables::post(int step, int num_vehicles, long speed_sum, int rank) {
+    if (!this->isEnabled() || step % this->interval != 0) {
+        return;
+    }
+
+    this->completePending(rank);
+
+    this->local_sums[0] = (double) num_vehicles;
+    this->local_sums[1] = (double) speed_sum;
+    this->request = this->transport->startAllReduce(this->local_sums, this->global_sums, NUM_SUMS, REDUCE_SUM);
+    this->request_pending = true;
+    this->pending_step = step;
+}
+
+/**
+ * Completes the last pending reduction and flushes the observables file
+ * @param rank the rank of the process
+ */
+void Observables::finish(int rank) {
+    this->completePending(rank);
+    if (this->output_file.is_open()) {
+        this->output_file.flush();
+    }
+}
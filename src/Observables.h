@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_OBSERVABLES_H
+#define CA_TRAFFIC_SIMULATION_OBSERVABLES_H
+
+#include <fstream>
+
+#include "Inputs.h"
+#include "Transport.h"
+
+/**
+ * Class for the road-wide observables of the simulation (vehicle count, mean speed, density and flow). Each process
+ * supplies the partial sums of its segment every step, and the sums are reduced with a non-blocking collective that
+ * completes while the next step is computed, so the results of a step are delivered on rank 0 one step late.
+ */
+class Observables {
+private:
+    static const int NUM_SUMS = 2;
+    int interval;
+    double num_road_sites;
+    double local_sums[NUM_SUMS];
+    double global_sums[NUM_SUMS];
+    Transport* transport;
+    int request;
+    bool request_pending;
+    int pending_step;
+    int num_records;
+    std::ofstream output_file;
+    void completePending(int rank);
+public:
+    Observables(Transport* transport, const Inputs& inputs, int rank);
+    ~Observables();
+    bool isEnabled();
+    void post(int step, int num_vehicles, long speed_sum, int rank);
+    void finish(int rank);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_OBSERVABLES_H
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <cmath>
+#include <iostream>
+
+#include "PairedComparison.h"
+#include "LatticeEngine.h"
+#include "Random.h"
+#include "Simulation.h"
+#include "Statistic.h"
+
+namespace {
+    /**
+     * Gets the 97.5% quantile of the Student t distribution, for two-sided 95% confidence intervals
+     * @param degrees_of_freedom the degrees of freedom
+     * @return the quantile, or the normal quantile beyond 30 degrees of freedom
+     */
+    double studentTQuantile(int degrees_of_freedom) {
+        static const double QUANTILES[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                             2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                             2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        if (degrees_of_freedom < 1) {
+            return NAN;
+        }
+        return (degrees_of_freedom <= 30) ? QUANTILES[degrees_of_freedom - 1] : 1.96;
+    }
+
+    /**
+     * Gets the half-width of the 95% confidence interval of the mean of a Statistic
+     * @param statistic the Statistic
+     * @return the half-width
+     */
+    double halfWidth(Statistic& statistic) {
+        const int n = statistic.getNumSamples();
+        return studentTQuantile(n - 1) * std::sqrt(statistic.getVariance() / n);
+    }
+}
+
+/**
+ * Constructor for the PairedComparison
+ * @param transport the Transport to the other processes
+ * @param inputs instance of the Inputs class with the inputs of the base variant and the paired comparison
+ * @param seed the seed of the run, the same on all the processes
+ */
+PairedComparison::PairedComparison(Transport* transport, const Inputs& inputs, uint64_t seed) {
+    this->transport = transport;
+    this->inputs = inputs;
+    this->seed = seed;
+}
+
+/**
+ * Gets the inputs of a variant, with the output files of the runs turned off so that the replications do not
+ * overwrite each other, as in Calibration::getCandidateInputs
+ * @param inputs instance of the Inputs class with the inputs of the variant from the configuration file
+ * @return the inputs of the runs of the variant
+ */
+Inputs PairedComparison::getVariantInputs(const Inputs& inputs) {
+    Inputs variant_inputs = inputs;
+    variant_inputs.observables_interval = 0;
+    variant_inputs.telemetry_interval = 0;
+    variant_inputs.write_trip_log = 0;
+    variant_inputs.paired_replications = 0;
+    variant_inputs.raster_width = 0;
+    variant_inputs.raster_height = 0;
+    variant_inputs.probe_fraction = 0.0;
+    variant_inputs.calibration_iterations = 0;
+    variant_inputs.perf_counters = 0;
+    return variant_inputs;
+}
+
+/**
+ * Runs one variant of one replication, quietly
+ * @param variant_inputs instance of the Inputs class with the inputs of the variant
+ * @param replication_seed the seed of the replication
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @param status pointer to hold the status of the run, 0 if successful
+ * @return the mean travel time of the run
+ */
+double PairedComparison::runVariant(const Inputs& variant_inputs, uint64_t replication_seed, int rank, int size,
+                                    int* status) {
+    Random::seed(replication_seed, rank);
+
+    double mean_travel_time;
+    if (variant_inputs.engine == ENGINE_LATTICE) {
+        LatticeEngine* engine_ptr = new LatticeEngine(this->transport, variant_inputs, rank, size);
+        engine_ptr->setQuiet(true);
+        *status = engine_ptr->run(rank, size);
+        mean_travel_time = engine_ptr->getMeanTravelTime(rank, size);
+        delete engine_ptr;
+    } else {
+        Simulation* simulation_ptr = new Simulation(this->transport, variant_inputs, rank, size);
+        simulation_ptr->setQuiet(true);
+        *status = simulation_ptr->run_simulation(rank, size);
+        mean_travel_time = simulation_ptr->getMeanTravelTime(rank, size);
+        delete simulation_ptr;
+    }
+    return mean_travel_time;
+}
+
+/**
+ * Runs the replications of both variants and reports the paired difference of their mean travel times on rank 0
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return 0 if successful, nonzero otherwise
+ */
+int PairedComparison::run(int rank, int size) {
+    if (this->inputs.engine == ENGINE_REPLICAS) {
+        if (rank == 0) {
+            std::cout << "error: paired comparisons need an engine that tracks Vehicles!" << std::endl;
+        }
+        return 1;
+    }
+
+    // The varied variant differs from the base variant only on the varied input line
+    Inputs varied_inputs = this->inputs;
+    int status = varied_inputs.setLineValue(this->inputs.paired_line, this->inputs.paired_value);
+    if (status != 0) {
+        return status;
+    }
+    const Inputs base_inputs = this->getVariantInputs(this->inputs);
+    varied_inputs = this->getVariantInputs(varied_inputs);
+
+    Statistic base_travel_time;
+    Statistic varied_travel_time;
+    Statistic difference;
+    for (int replication = 0; replication < this->inputs.paired_replications; replication++) {
+        // Both variants of a replication run with the same seed
+        const uint64_t replication_seed = Random::mix(this->seed + Random::GOLDEN_GAMMA * (replication + 1));
+
+        double base = this->runVariant(base_inputs, replication_seed, rank, size, &status);
+        if (status != 0) {
+            return status;
+        }
+        double varied = this->runVariant(varied_inputs, replication_seed, rank, size, &status);
+        if (status != 0) {
+            return status;
+        }
+
+        base_travel_time.addValue(base);
+        varied_travel_time.addValue(varied);
+        difference.addValue(varied - base);
+        if (rank == 0) {
+            std::cout << "Replication " << replication + 1 << ": base " << base << " [s], varied " << varied
+                      << " [s], difference " << varied - base << " [s]" << std::endl;
+        }
+    }
+
+    if (rank == 0) {
+        std::cout << "--- Paired Comparison ---" << std::endl;
+        std::cout << "Varied input line " << this->inputs.paired_line << " to " << this->inputs.paired_value
+                  << " with common random numbers over " << this->inputs.paired_replications << " replications"
+                  << std::endl;
+        std::cout << "Mean travel time (base): " << base_travel_time.getAverage() << " +/- "
+                  << halfWidth(base_travel_time) << " [s]" << std::endl;
+        std::cout << "Mean travel time (varied): " << varied_travel_time.getAverage() << " +/- "
+                  << halfWidth(varied_travel_time) << " [s]" << std::endl;
+        std::cout << "Difference (varied - base): " << difference.getAverage() << " +/- " << halfWidth(difference)
+                  << " [s] (95% confidence)" << std::endl;
+
+        // Independent runs would have the sum of the variances of the variants as the variance of the difference
+        std::cout << "Variance reduction from common random numbers: "
+                  << (base_travel_time.getVariance() + varied_travel_time.getVariance()) / difference.getVariance()
+                  << std::endl;
+    }
+
+    // Return with no errors
+    return 0;
+}
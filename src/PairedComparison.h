@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PAIREDCOMPARISON_H
+#define CA_TRAFFIC_SIMULATION_PAIREDCOMPARISON_H
+
+#include <cstdint>
+
+#include "Inputs.h"
+#include "Transport.h"
+
+/**
+ * Class for the paired comparison of two variants of a simulation that differ in one input option. Each replication
+ * runs both variants with the same seed, so with the keyed random streams the spawns, braking and lane change draws
+ * of a Vehicle match between the variants, and the difference of their mean travel times has far less variance than
+ * the difference of two independent runs. The mean difference is reported with a confidence interval over the
+ * replications, along with the variance reduction from the common random numbers. The runs of the variants are quiet
+ * and write no output files, so only the comparison is reported.
+ */
+class PairedComparison {
+private:
+    Transport* transport;
+    Inputs inputs;
+    uint64_t seed;
+    Inputs getVariantInputs(const Inputs& inputs);
+    double runVariant(const Inputs& variant_inputs, uint64_t replication_seed, int rank, int size, int* status);
+public:
+    PairedComparison(Transport* transport, const Inputs& inputs, uint64_t seed);
+    int run(int rank, int size);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_PAIREDCOMPARISON_H
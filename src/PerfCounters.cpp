@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "PerfCounters.h"
+
+namespace {
+#ifdef __linux__
+    // Type and configuration of each event for perf_event_open
+    const uint32_t PERF_EVENT_TYPES[PERF_NUM_EVENTS] = {PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                        PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+    const uint64_t PERF_EVENT_CONFIGS[PERF_NUM_EVENTS] = {
+        PERF_COUNT_SW_TASK_CLOCK,
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+#endif
+
+    // Column headings of the events in the report
+    const char* const PERF_EVENT_HEADINGS[PERF_NUM_EVENTS] = {"ns", "cycles", "instr", "L1D miss", "LLC miss",
+                                                              "br miss"};
+}
+
+/**
+ * Constructor for the PerfCounters, which opens the counters of the calling thread if they are requested. The counters
+ * only count the calling thread, so they are refused if the steps of the process also run on other threads.
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param num_threads number of threads that run the steps of the process, including the calling thread
+ * @param rank the rank of the process
+ */
+PerfCounters::PerfCounters(const Inputs& inputs, int num_threads, int rank) {
+    this->requested = inputs.perf_counters != 0;
+    this->num_open = 0;
+    this->open_errno = 0;
+    this->current_phase = -1;
+    this->vehicle_updates = 0;
+    std::fill(this->fds, this->fds + PERF_NUM_EVENTS, -1);
+    std::fill(this->group_index, this->group_index + PERF_NUM_EVENTS, -1);
+    std::fill(this->phase_start, this->phase_start + PERF_NUM_EVENTS, 0.0);
+    std::fill(&this->totals[0][0], &this->totals[0][0] + TelemetryRing::NUM_PHASES * PERF_NUM_EVENTS, 0.0);
+
+    if (!this->requested) {
+        return;
+    }
+    if (num_threads > 1) {
+        if (rank == 0) {
+            std::cout << "error: the hardware counters only count the thread of a process, run them with one worker!"
+                      << std::endl;
+        }
+        throw std::exception();
+    }
+
+#ifdef __linux__
+    // Open the task clock as the leader of the group and the other events as its members, counting user space only
+    for (int event = 0; event < PERF_NUM_EVENTS; event++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_EVENT_TYPES[event];
+        attr.config = PERF_EVENT_CONFIGS[event];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, this->fds[PERF_TASK_CLOCK], PERF_FLAG_FD_CLOEXEC);
+        if (fd < 0) {
+            if (event == PERF_TASK_CLOCK) {
+                this->open_errno = errno;
+                return;
+            }
+            continue;
+        }
+        this->fds[event] = fd;
+        this->group_index[event] = this->num_open++;
+    }
+#else
+    this->open_errno = ENOSYS;
+#endif
+}
+
+/**
+ * Destructor for the PerfCounters
+ */
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : this->fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+/**
+ * Checks whether the counters are requested in the simulation, whether or not they could be opened
+ * @return true if the counters are requested, false otherwise
+ */
+bool PerfCounters::isEnabled() const {
+    return this->requested;
+}
+
+/**
+ * Reads the counts of all the events of the group, scaled up for the time that the group was not counting if the
+ * kernel had to share the counters with other groups
+ * @param values array to hold the count of each event, zero for the events that are not counted
+ * @return true if successful, false otherwise
+ */
+bool PerfCounters::readGroup(double* values) {
+#ifdef __linux__
+    uint64_t buffer[3 + PERF_NUM_EVENTS];
+    if (::read(this->fds[PERF_TASK_CLOCK], buffer, sizeof(buffer)) < (ssize_t) (3 * sizeof(uint64_t))) {
+        return false;
+    }
+    const double scale = (buffer[2] > 0) ? (double) buffer[1] / (double) buffer[2] : 0.0;
+    for (int event = 0; event < PERF_NUM_EVENTS; event++) {
+        values[event] = (this->group_index[event] >= 0) ? buffer[3 + this->group_index[event]] * scale : 0.0;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Marks the start of a phase of the step, which also ends the phase before it and adds its counts to the totals
+ * @param phase the phase that is starting, or -1 outside of the phases
+ */
+void PerfCounters::beginPhase(int phase) {
+    if (this->fds[PERF_TASK_CLOCK] < 0 || phase == this->current_phase) {
+        return;
+    }
+
+    double now[PERF_NUM_EVENTS];
+    if (!this->readGroup(now)) {
+        return;
+    }
+    if (this->current_phase >= 0) {
+        for (int event = 0; event < PERF_NUM_EVENTS; event++) {
+            this->totals[this->current_phase][event] += now[event] - this->phase_start[event];
+        }
+    }
+    std::copy(now, now + PERF_NUM_EVENTS, this->phase_start);
+    this->current_phase = phase;
+}
+
+/**
+ * Ends a step, adding the Vehicles of the segment to the Vehicle updates that the counts are divided by
+ * @param num_vehicles number of Vehicles on the segment of this process
+ */
+void PerfCounters::endStep(int num_vehicles) {
+    this->beginPhase(-1);
+    this->vehicle_updates += num_vehicles;
+}
+
+/**
+ * Prints the counts of each phase per Vehicle update of every rank with counters and of all of them together,
+ * collective over all the ranks. Ranks without counters are reported with the reason on rank 0.
+ * @param transport the Transport of the rank
+ * @param rank the rank of the process
+ */
+void PerfCounters::report(Transport* transport, int rank) {
+    if (!this->requested) {
+        return;
+    }
+    const int size = transport->getSize();
+
+    // Gather the entries of all the ranks: whether the counters are open, the Vehicle updates, which events are
+    // counted and the totals
+    const int num_values = 2 + PERF_NUM_EVENTS + TelemetryRing::NUM_PHASES * PERF_NUM_EVENTS;
+    std::vector<double> entry(num_values, 0.0);
+    std::vector<double> values((size_t) size * num_values, 0.0);
+    entry[0] = (this->fds[PERF_TASK_CLOCK] >= 0) ? 1.0 : 0.0;
+    entry[1] = (double) this->vehicle_updates;
+    for (int event = 0; event < PERF_NUM_EVENTS; event++) {
+        entry[2 + event] = (this->fds[event] >= 0) ? 1.0 : 0.0;
+    }
+    std::copy(&this->totals[0][0], &this->totals[0][0] + TelemetryRing::NUM_PHASES * PERF_NUM_EVENTS,
+              entry.begin() + 2 + PERF_NUM_EVENTS);
+    transport->allGather(entry.data(), num_values * sizeof(double), values.data());
+
+    if (rank != 0) {
+        return;
+    }
+
+    // Sum the entries of the ranks with counters, counting an event only if every one of them counts it
+    std::vector<double> all(num_values, 0.0);
+    int num_counted = 0;
+    for (int r = 0; r < size; r++) {
+        const double* rank_entry = values.data() + (size_t) r * num_values;
+        if (rank_entry[0] == 0.0) {
+            continue;
+        }
+        for (int i = 0; i < num_values; i++) {
+            all[i] += rank_entry[i];
+        }
+        num_counted++;
+    }
+    for (int event = 0; event < PERF_NUM_EVENTS; event++) {
+        all[2 + event] = (num_counted > 0 && all[2 + event] == num_counted) ? 1.0 : 0.0;
+    }
+
+    std::cout << "--- Hardware Counters (per Vehicle update) ---" << std::endl;
+    if (num_counted < size) {
+        std::cout << "warning: no hardware counters on " << size - num_counted << " of " << size << " processes";
+        if (this->open_errno != 0) {
+            std::cout << " (perf_event_open: " << std::strerror(this->open_errno) << ")";
+        }
+        std::cout << "!" << std::endl;
+    }
+    if (num_counted == 0) {
+        return;
+    }
+
+    // Print a row per phase for each rank with counters and for all of them, with a dash for the events not counted
+    const std::ios_base::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
+    std::cout << std::setw(6) << "rank" << std::setw(10) << "phase";
+    for (const char* heading : PERF_EVENT_HEADINGS) {
+        std::cout << std::setw(10) << heading;
+    }
+    std::cout << std::setw(8) << "IPC" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (int r = 0; r <= size; r++) {
+        const double* row_entry = (r < size) ? values.data() + (size_t) r * num_values : all.data();
+        if (r < size && (row_entry[0] == 0.0 || size == 1)) {
+            continue;
+        }
+        const double updates = std::max(1.0, row_entry[1]);
+        for (int phase = 0; phase < TelemetryRing::NUM_PHASES; phase++) {
+            const double* counts = row_entry + 2 + PERF_NUM_EVENTS + phase * PERF_NUM_EVENTS;
+            std::cout << std::setw(6);
+            if (r < size) {
+                std::cout << r;
+            } else {
+                std::cout << "all";
+            }
+            std::cout << std::setw(10) << TelemetryRing::PHASE_NAMES[phase];
+            for (int event = 0; event < PERF_NUM_EVENTS; event++) {
+                if (row_entry[2 + event] != 0.0) {
+                    std::cout << std::setw(10) << counts[event] / updates;
+                } else {
+                    std::cout << std::setw(10) << "-";
+                }
+            }
+            if (row_entry[2 + PERF_CYCLES] != 0.0 && row_entry[2 + PERF_INSTRUCTIONS] != 0.0
+                && counts[PERF_CYCLES] > 0.0) {
+                std::cout << std::setw(8) << counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES] << std::endl;
+            } else {
+                std::cout << std::setw(8) << "-" << std::endl;
+            }
+        }
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PERFCOUNTERS_H
+#define CA_TRAFFIC_SIMULATION_PERFCOUNTERS_H
+
+#include <cstdint>
+
+#include "Inputs.h"
+#include "TelemetryRing.h"
+#include "Transport.h"
+
+// Events counted for each phase of a step
+enum PerfEvent {
+    PERF_TASK_CLOCK,
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NUM_EVENTS
+};
+
+/**
+ * Class for the hardware performance counters of the thread of a process, read with perf_event_open on Linux at the
+ * start of every phase of a step, which are the phases of the telemetry. The counters have an input of their own and
+ * are read whether or not the telemetry is published. The events are opened as one group led by the task clock, so
+ * they are always counted over the same time, and each event that the processor or the kernel does not offer is left
+ * out on its own. If the counters cannot be opened at all, the simulation carries on without them and says why in the
+ * report.
+ */
+class PerfCounters {
+private:
+    bool requested;
+    int fds[PERF_NUM_EVENTS];
+    int group_index[PERF_NUM_EVENTS];
+    int num_open;
+    int open_errno;
+    int current_phase;
+    double phase_start[PERF_NUM_EVENTS];
+    double totals[TelemetryRing::NUM_PHASES][PERF_NUM_EVENTS];
+    int64_t vehicle_updates;
+    bool readGroup(double* values);
+public:
+    PerfCounters(const Inputs& inputs, int num_threads, int rank);
+    ~PerfCounters();
+    bool isEnabled() const;
+    void beginPhase(int phase);
+    void endStep(int num_vehicles);
+    void report(Transport* transport, int rank);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_PERFCOUNTERS_H
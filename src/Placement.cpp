@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Placement.h"
+
+// Largest NUMA node number that is looked for
+const int PLACEMENT_MAX_NODES = 256;
+
+namespace {
+    // Placement policy and number of ranks of the pinned threads of this process, for the cores of their task workers
+    std::string rank_policy;
+    int num_pinned_ranks = 0;
+
+    /**
+     * Gets the cores that this process is allowed to run on
+     * @return the numbers of the allowed cores in ascending order, empty if they are unknown
+     */
+    std::vector<int> allowedCpus() {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        return cpus;
+    }
+}
+
+/**
+ * Plans the core of each thread from a placement policy: "compact" fills the allowed cores in order, "scatter" deals
+ * the threads out over the NUMA nodes in turn so that every node gets its share of the threads, and a comma separated
+ * list of cores gives the core of each thread directly. Threads wrap around the cores if there are more threads.
+ * @param policy the placement policy
+ * @param num_threads the number of threads
+ * @param cpus pointer to the list to fill with the core of each thread
+ * @return 0 if successful, nonzero otherwise
+ */
+int Placement::planCpus(const std::string& policy, int num_threads, std::vector<int>* cpus) {
+    cpus->clear();
+    std::vector<int> allowed = allowedCpus();
+    if (allowed.empty()) {
+        std::cout << "error: thread pinning is not supported on this system!" << std::endl;
+        return 1;
+    }
+
+    if (policy == "compact") {
+        for (int i = 0; i < num_threads; i++) {
+            cpus->push_back(allowed[i % allowed.size()]);
+        }
+    } else if (policy == "scatter") {
+        // Group the allowed cores by NUMA node, then take the next core of each node in turn
+        std::vector<std::vector<int>> node_cpus;
+        std::vector<int> node_numbers;
+        for (int cpu : allowed) {
+            int node = getNode(cpu);
+            int index = 0;
+            while (index < (int) node_numbers.size() && node_numbers[index] != node) {
+                index++;
+            }
+            if (index == (int) node_numbers.size()) {
+                node_numbers.push_back(node);
+                node_cpus.emplace_back();
+            }
+            node_cpus[index].push_back(cpu);
+        }
+        std::vector<int> next(node_cpus.size(), 0);
+        for (int i = 0; i < num_threads; i++) {
+            const int index = i % node_cpus.size();
+            cpus->push_back(node_cpus[index][next[index]++ % node_cpus[index].size()]);
+        }
+    } else {
+        std::istringstream list(policy);
+        std::string field;
+        while (std::getline(list, field, ',')) {
+            try {
+                cpus->push_back(std::stoi(field));
+            } catch (const std::exception&) {
+                std::cout << "error: unknown placement \"" << policy << "\"!" << std::endl;
+                return 1;
+            }
+        }
+        if (cpus->empty()) {
+            std::cout << "error: unknown placement \"" << policy << "\"!" << std::endl;
+            return 1;
+        }
+        for (int cpu : *cpus) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) == allowed.end()) {
+                std::cout << "error: core " << cpu << " is not available to this process!" << std::endl;
+                return 1;
+            }
+        }
+        for (int i = cpus->size(); i < num_threads; i++) {
+            cpus->push_back((*cpus)[i % cpus->size()]);
+        }
+        cpus->resize(num_threads);
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Sets the placement policy that the ranks running as threads of this process are pinned with, before they start
+ * @param policy the placement policy, empty if the ranks are not pinned
+ * @param num_ranks the number of ranks
+ */
+void Placement::setPolicy(const std::string& policy, int num_ranks) {
+    rank_policy = policy;
+    num_pinned_ranks = num_ranks;
+}
+
+/**
+ * Plans the cores of the task workers of a rank from the placement policy of the ranks. Worker 0 keeps the core of its
+ * rank, and the other workers take the cores of the NUMA node of that core that no rank is pinned to, shared out in
+ * turn among the ranks on the node, so that the workers update the memory that their rank first touched on its own
+ * node. The workers wrap around the cores of the node if there are too few of them.
+ * @param rank the rank of the workers
+ * @param num_workers the number of workers of the rank, including the rank thread
+ * @param cpus pointer to the list to fill with the core of each worker, left empty if the ranks are not pinned
+ * @return 0 if successful, nonzero otherwise
+ */
+int Placement::planWorkerCpus(int rank, int num_workers, std::vector<int>* cpus) {
+    cpus->clear();
+    if (rank_policy.empty() || num_workers <= 1) {
+        return 0;
+    }
+
+    std::vector<int> rank_cpus;
+    if (planCpus(rank_policy, num_pinned_ranks, &rank_cpus) != 0) {
+        return 1;
+    }
+    const int node = getNode(rank_cpus[rank]);
+
+    // Find the cores of the node of the rank, and the ones of them that no rank is pinned to
+    std::vector<int> node_cpus;
+    std::vector<int> free_cpus;
+    for (int cpu : allowedCpus()) {
+        if (getNode(cpu) != node) {
+            continue;
+        }
+        node_cpus.push_back(cpu);
+        if (std::find(rank_cpus.begin(), rank_cpus.end(), cpu) == rank_cpus.end()) {
+            free_cpus.push_back(cpu);
+        }
+    }
+    if (free_cpus.empty()) {
+        free_cpus = node_cpus.empty() ? std::vector<int>(1, rank_cpus[rank]) : node_cpus;
+    }
+
+    // Count the ranks on the node before this one, whose workers take the free cores first
+    int node_rank = 0;
+    for (int r = 0; r < rank; r++) {
+        node_rank += getNode(rank_cpus[r]) == node;
+    }
+
+    cpus->push_back(rank_cpus[rank]);
+    for (int worker = 1; worker < num_workers; worker++) {
+        cpus->push_back(free_cpus[(node_rank * (num_workers - 1) + worker - 1) % free_cpus.size()]);
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Pins the calling thread to a core
+ * @param cpu the number of the core
+ * @return 0 if successful, nonzero otherwise
+ */
+int Placement::pinThread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        return 0;
+    }
+#endif
+    std::cout << "error: failure to pin a thread to core " << cpu << "!" << std::endl;
+    return 1;
+}
+
+/**
+ * Gets the core that the calling thread is running on
+ * @return the number of the core, -1 if it is unknown
+ */
+int Placement::getCpu() {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Gets the NUMA node of a core from the Linux sysfs
+ * @param cpu the number of the core
+ * @return the number of the NUMA node, -1 if it is unknown
+ */
+int Placement::getNode(int cpu) {
+    if (cpu < 0) {
+        return -1;
+    }
+    const std::string cpu_directory = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node";
+    for (int node = 0; node < PLACEMENT_MAX_NODES; node++) {
+        if (access((cpu_directory + std::to_string(node)).c_str(), F_OK) == 0) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Prints the core and NUMA node of every rank, collective over all the ranks
+ * @param transport the Transport of the rank
+ */
+void Placement::report(Transport* transport) {
+    const int rank = transport->getRank();
+    const int size = transport->getSize();
+
+    // Gather the core and NUMA node of all the ranks
+    const int cpu = getCpu();
+    const int64_t local[2] = {cpu, getNode(cpu)};
+    std::vector<int64_t> placement(2 * size, 0);
+    transport->allGather(local, sizeof(local), placement.data());
+
+    if (rank == 0) {
+        std::cout << "--- Placement ---" << std::endl;
+        for (int r = 0; r < size; r++) {
+            std::cout << "rank " << r << ": core ";
+            if (placement[2 * r] >= 0) {
+                std::cout << placement[2 * r];
+            } else {
+                std::cout << "unknown";
+            }
+            std::cout << ", NUMA node ";
+            if (placement[2 * r + 1] >= 0) {
+                std::cout << placement[2 * r + 1];
+            } else {
+                std::cout << "unknown";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
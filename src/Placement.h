@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PLACEMENT_H
+#define CA_TRAFFIC_SIMULATION_PLACEMENT_H
+
+#include <string>
+#include <vector>
+
+#include "Transport.h"
+
+/**
+ * Placement of the ranks on the cores and NUMA nodes of a node. A rank that runs as a thread is pinned to its core
+ * before it creates its engine, so the sites and Vehicles of its segment are first touched, and therefore placed, in
+ * the memory of the NUMA node of the core that updates them. The task workers of a pinned rank are pinned to the
+ * other cores of the NUMA node of the rank, since they would otherwise share the core of the rank.
+ * Pinning uses the Linux affinity calls and does nothing elsewhere.
+ */
+namespace Placement {
+    int planCpus(const std::string& policy, int num_threads, std::vector<int>* cpus);
+    void setPolicy(const std::string& policy, int num_ranks);
+    int planWorkerCpus(int rank, int num_workers, std::vector<int>* cpus);
+    int pinThread(int cpu);
+    int getCpu();
+    int getNode(int cpu);
+    void report(Transport* transport);
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_PLACEMENT_H
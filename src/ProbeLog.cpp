@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include "AllocationCounter.h"
+#include "ProbeLog.h"
+
+namespace {
+    /**
+     * Background thread of the program that drains the rings of the ProbeLogs of all the process threads into their
+     * files. The thread is started by the first ProbeLog and stopped when the program exits.
+     */
+    class ProbeWriter {
+    private:
+        std::mutex mutex;
+        std::vector<ProbeLog*> logs;
+        std::thread thread;
+        bool stop;
+
+        /**
+         * Drains the rings until the program exits, sleeping for a millisecond whenever they are all empty
+         */
+        void run() {
+            while (true) {
+                int64_t num_drained = 0;
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    if (this->stop) {
+                        return;
+                    }
+                    for (ProbeLog* log : this->logs) {
+                        num_drained += log->drain();
+                    }
+                }
+                if (num_drained == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        }
+    public:
+        ProbeWriter() {
+            this->stop = false;
+            this->logs.reserve(64);
+            this->thread = std::thread([this]() { this->run(); });
+        }
+
+        ~ProbeWriter() {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->stop = true;
+            }
+            this->thread.join();
+        }
+
+        /**
+         * Starts draining the ring of a ProbeLog
+         * @param log pointer to the ProbeLog
+         */
+        void attach(ProbeLog* log) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->logs.push_back(log);
+        }
+
+        /**
+         * Drains the rest of the ring of a ProbeLog, whose process thread must have stopped adding records, and stops
+         * draining it
+         * @param log pointer to the ProbeLog
+         */
+        void detach(ProbeLog* log) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            while (log->drain() > 0) {}
+            this->logs.erase(std::remove(this->logs.begin(), this->logs.end(), log), this->logs.end());
+        }
+    };
+
+    /**
+     * Gets the background writer of the program, starting it on the first call
+     * @return the background writer
+     */
+    ProbeWriter& getWriter() {
+        static ProbeWriter writer;
+        return writer;
+    }
+}
+
+/**
+ * Constructor for the ProbeLog, which opens the probe file of the process and attaches the ring to the background
+ * writer if any Vehicles are sampled
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+ProbeLog::ProbeLog(const Inputs& inputs, int rank, int size) : head(0), tail(0), writer_allocations(0) {
+    const int length_per_process = inputs.length / size;
+    this->start_site = (int64_t) rank * length_per_process;
+    this->road_sites = (int64_t) size * length_per_process;
+    this->cached_head = 0;
+    this->num_stalls = 0;
+    this->file = nullptr;
+    this->enabled = inputs.probe_fraction > 0.0;
+    this->producer = std::this_thread::get_id();
+
+    if (!this->enabled) {
+        return;
+    }
+
+    // Open the probe file of the process and discard the records of any previous run
+    const std::string file_name = "cats-probes-" + std::to_string(rank) + ".bin";
+    this->file = std::fopen(file_name.c_str(), "wb");
+    if (this->file == nullptr) {
+        std::cout << "error: failure to open \"" << file_name << "\" file!" << std::endl;
+        throw std::exception();
+    }
+
+    // Allocate the ring up front so that adding records never allocates
+    this->records.resize(CAPACITY);
+    getWriter().attach(this);
+}
+
+/**
+ * Destructor for the ProbeLog
+ */
+ProbeLog::~ProbeLog() {
+    if (this->file != nullptr) {
+        getWriter().detach(this);
+        std::fclose(this->file);
+    }
+}
+
+/**
+ * Checks whether any Vehicles are sampled as probes in the simulation
+ * @return true if the probe records are written, false otherwise
+ */
+bool ProbeLog::isEnabled() const {
+    return this->enabled;
+}
+
+/**
+ * Adds a record to the ring, waiting for the background writer to make room if the ring is full
+ * @param record the record
+ */
+void ProbeLog::push(const ProbeRecord& record) {
+    const uint64_t tail = this->tail.load(std::memory_order_relaxed);
+    if (tail - this->cached_head >= CAPACITY) {
+        this->cached_head = this->head.load(std::memory_order_acquire);
+        if (tail - this->cached_head >= CAPACITY) {
+            this->num_stalls++;
+            do {
+                std::this_thread::yield();
+                this->cached_head = this->head.load(std::memory_order_acquire);
+            } while (tail - this->cached_head >= CAPACITY);
+        }
+    }
+    this->records[tail & (CAPACITY - 1)] = record;
+    this->tail.store(tail + 1, std::memory_order_release);
+}
+
+/**
+ * Writes the records in the ring to the probe file, called by the background writer only
+ * @return the number of records written
+ */
+int64_t ProbeLog::drain() {
+    const uint64_t tail = this->tail.load(std::memory_order_acquire);
+    uint64_t head = this->head.load(std::memory_order_relaxed);
+    const int64_t num_records = tail - head;
+    const long start_allocations = AllocationCounter::getCount();
+
+    // Write the records up to the end of the ring and then the ones that wrapped around to its start
+    while (head != tail) {
+        const uint64_t index = head & (CAPACITY - 1);
+        const uint64_t count = std::min(tail - head, CAPACITY - index);
+        std::fwrite(&this->records[index], sizeof(ProbeRecord), count, this->file);
+        head += count;
+    }
+    this->head.store(head, std::memory_order_release);
+
+    // Add the heap allocations that the writing made in the background writer to the ones of the ring
+    this->writer_allocations.fetch_add(AllocationCounter::getCount() - start_allocations, std::memory_order_relaxed);
+    return num_records;
+}
+
+/**
+ * Gets the number of heap allocations that the background writer made while writing the records of the ring, which
+ * it counts in its own thread, see AllocationCounter
+ * @return number of allocations, always zero if the counting hook is not compiled in
+ */
+long ProbeLog::getAllocations() const {
+    return this->writer_allocations.load(std::memory_order_relaxed);
+}
+
+/**
+ * Writes the records that are left in the ring, closes the probe file and prints the number of records and of the
+ * times a full ring stalled the steps, collective over all the processes
+ * @param transport the Transport to the other processes
+ * @param rank the rank of the process
+ */
+void ProbeLog::finish(Transport* transport, int rank) {
+    if (!this->enabled) {
+        return;
+    }
+
+    // Write the rest of the records and close the file
+    if (this->file != nullptr) {
+        getWriter().detach(this);
+        std::fclose(this->file);
+        this->file = nullptr;
+    }
+
+    // Sum the records and the stalls over all the processes
+    int64_t local_counts[2] = {(int64_t) this->tail.load(std::memory_order_relaxed), this->num_stalls};
+    int64_t total_counts[2];
+    transport->allReduce(local_counts, total_counts, 2, REDUCE_SUM);
+    if (rank == 0) {
+        std::cout << "--- Probe Vehicles ---" << std::endl;
+        std::cout << "Probe records written (sum across all processes): " << total_counts[0] << std::endl;
+        std::cout << "Stalls on a full probe ring (sum across all processes): " << total_counts[1] << std::endl;
+    }
+}
+
+/**
+ * Adds the memory of the ring to a memory report
+ * @param report the memory report
+ */
+void ProbeLog::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_BUFFERS, this->records);
+}
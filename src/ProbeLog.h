@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PROBELOG_H
+#define CA_TRAFFIC_SIMULATION_PROBELOG_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "Inputs.h"
+#include "MemoryReport.h"
+#include "Random.h"
+#include "Transport.h"
+
+/**
+ * Fixed-size binary record of the state of a probe Vehicle after a step, written to the probe file of the process in
+ * the native byte order. The site is counted from the start of the road.
+ *
+ *     offset  size  field
+ *          0     8  id        (int64)
+ *          8     8  site      (int64)
+ *         16     4  step      (int32)
+ *         20     4  lane      (int32)
+ *         24     4  speed     (int32)
+ *         28     4  reserved  (int32)
+ */
+struct ProbeRecord {
+    int64_t id;
+    int64_t site;
+    int32_t step;
+    int32_t lane;
+    int32_t speed;
+    int32_t reserved;
+};
+
+static_assert(sizeof(ProbeRecord) == 32, "ProbeRecord must have the documented 32 byte layout");
+
+/**
+ * Class for the floating-car data of the probe Vehicles, a sampled fraction of the Vehicles whose position, Lane and
+ * speed are recorded after every step. Each process thread adds the records of its segment to a preallocated single
+ * producer, single consumer ring, and one background writer thread per program drains the rings of all the process
+ * threads into a file per process, so the steps never wait for the file system unless a ring fills up. The process
+ * thread that creates the ring is its only producer, so the records are added after the task workers have joined,
+ * which debug builds check.
+ */
+class ProbeLog {
+private:
+    // Number of records in the ring, a power of two
+    static const uint64_t CAPACITY = 1 << 16;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    uint64_t cached_head;
+    int64_t num_stalls;
+    std::vector<ProbeRecord> records;
+    std::FILE* file;
+    int64_t start_site;
+    int64_t road_sites;
+    bool enabled;
+    std::thread::id producer;
+    std::atomic<long> writer_allocations;
+    void push(const ProbeRecord& record);
+public:
+    ProbeLog(const Inputs& inputs, int rank, int size);
+    ~ProbeLog();
+    bool isEnabled() const;
+    static bool isSampled(int64_t id, double fraction);
+    inline void addVehicle(int64_t id, int step, int lane, int position, int speed);
+    int64_t drain();
+    long getAllocations() const;
+    void finish(Transport* transport, int rank);
+    void addMemory(MemoryReport* report) const;
+};
+
+/**
+ * Checks whether a Vehicle is a probe, from a hash of its id and the seed of the run so that the same Vehicles are
+ * sampled in every run with the same seed
+ * @param id unique ID number of the Vehicle
+ * @param fraction the fraction of the Vehicles that are probes
+ * @return true if the Vehicle is a probe, false otherwise
+ */
+inline bool ProbeLog::isSampled(int64_t id, double fraction) {
+    if (fraction <= 0.0) {
+        return false;
+    }
+    const uint64_t hash = Random::mix(Random::mix(Random::run_seed ^ Random::GOLDEN_GAMMA) ^ (uint64_t) id);
+    return (double) (hash >> 11) * (1.0 / 9007199254740992.0) < fraction;
+}
+
+/**
+ * Adds the state of a probe Vehicle after a step to the ring, unless the Vehicle has left the road
+ * @param id unique ID number of the Vehicle
+ * @param step the step that the state is the result of
+ * @param lane the number of the Lane of the Vehicle
+ * @param position the position of the Vehicle, relative to the start of the segment of the process
+ * @param speed the speed of the Vehicle
+ */
+inline void ProbeLog::addVehicle(int64_t id, int step, int lane, int position, int speed) {
+#ifdef DEBUG
+    assert(std::this_thread::get_id() == this->producer);
+#endif
+    const int64_t site = this->start_site + position;
+    if (site >= this->road_sites) {
+        return;
+    }
+    this->push(ProbeRecord{id, site, step, lane, speed, 0});
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_PROBELOG_H
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include "ProfilingTransport.h"
+
+/**
+ * Constructor of the ProfilingTransport
+ * @param transport the Transport that the operations are passed on to
+ */
+ProfilingTransport::ProfilingTransport(Transport* transport) {
+    this->transport = transport;
+    this->wait_time = 0.0;
+    this->num_messages = 0;
+    this->num_bytes_sent = 0;
+    this->num_collectives = 0;
+}
+
+/**
+ * Starts timing a blocking operation
+ */
+void ProfilingTransport::beginWait() {
+    this->wait_start = std::chrono::steady_clock::now();
+}
+
+/**
+ * Stops timing a blocking operation and adds its duration to the wait time
+ */
+void ProfilingTransport::endWait() {
+    this->wait_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->wait_start).count();
+}
+
+/**
+ * Counts a message sent to another rank
+ * @param dest rank the message is sent to, or TRANSPORT_NO_RANK if nothing is sent
+ * @param num_bytes number of bytes in the message
+ */
+void ProfilingTransport::countMessage(int dest, int num_bytes) {
+    if (dest != TRANSPORT_NO_RANK) {
+        this->num_messages++;
+        this->num_bytes_sent += num_bytes;
+    }
+}
+
+/**
+ * Gets the time this rank was blocked in communication
+ * @return the wait time in seconds
+ */
+double ProfilingTransport::getWaitTime() const {
+    return this->wait_time;
+}
+
+/**
+ * Gets the number of messages this rank sent to its neighbours
+ * @return the number of messages
+ */
+int64_t ProfilingTransport::getNumMessages() const {
+    return this->num_messages;
+}
+
+/**
+ * Gets the number of bytes in the messages this rank sent to its neighbours
+ * @return the number of bytes
+ */
+int64_t ProfilingTransport::getNumBytesSent() const {
+    return this->num_bytes_sent;
+}
+
+/**
+ * Gets the number of collective operations this rank took part in
+ * @return the number of collectives
+ */
+int64_t ProfilingTransport::getNumCollectives() const {
+    return this->num_collectives;
+}
+
+int ProfilingTransport::getRank() const {
+    return this->transport->getRank();
+}
+
+int ProfilingTransport::getSize() const {
+    return this->transport->getSize();
+}
+
+void ProfilingTransport::barrier() {
+    this->num_collectives++;
+    this->beginWait();
+    this->transport->barrier();
+    this->endWait();
+}
+
+void ProfilingTransport::broadcast(void* data, int num_bytes, int root) {
+    this->num_collectives++;
+    this->beginWait();
+    this->transport->broadcast(data, num_bytes, root);
+    this->endWait();
+}
+
+void ProfilingTransport::sendRecv(const void* send_data, int send_bytes, int dest, void* recv_data, int recv_bytes,
+                                  int source, int tag) {
+    this->countMessage(dest, send_bytes);
+    this->beginWait();
+    this->transport->sendRecv(send_data, send_bytes, dest, recv_data, recv_bytes, source, tag);
+    this->endWait();
+}
+
+void ProfilingTransport::reduce(const double* values, double* results, int count, ReduceOp op, int root) {
+    this->num_collectives++;
+    this->beginWait();
+    this->transport->reduce(values, results, count, op, root);
+    this->endWait();
+}
+
+void ProfilingTransport::allReduce(const double* values, double* results, int count, ReduceOp op) {
+    this->num_collectives++;
+    this->beginWait();
+    this->transport->allReduce(values, results, count, op);
+    this->endWait();
+}
+
+void ProfilingTransport::allReduce(const int64_t* values, int64_t* results, int count, ReduceOp op) {
+    this->num_collectives++;
+    this->beginWait();
+    this->transport->allReduce(values, results, count, op);
+    this->endWait();
+}
+
+void ProfilingTransport::exclusiveScan(const int64_t* values, int64_t* results, int count) {
+    this->num_collectives++;
+    this->beginWait();
+    this->transport->exclusiveScan(values, results, count);
+    this->endWait();
+}
+
+void ProfilingTransport::allGather(const void* data, int num_bytes, void* results) {
+    this->num_collectives++;
+    this->beginWait();
+    this->transport->allGather(data, num_bytes, results);
+    this->endWait();
+}
+
+int ProfilingTransport::startReduce(const double* values, double* results, int count, ReduceOp op, int root) {
+    this->num_collectives++;
+    this->beginWait();
+    int request = this->transport->startReduce(values, results, count, op, root);
+    this->endWait();
+    return request;
+}
+
+int ProfilingTransport::startAllReduce(const double* values, double* results, int count, ReduceOp op) {
+    this->num_collectives++;
+    this->beginWait();
+    int request = this->transport->startAllReduce(values, results, count, op);
+    this->endWait();
+    return request;
+}
+
+int ProfilingTransport::startSend(const void* data, int num_bytes, int dest, int tag) {
+    this->countMessage(dest, num_bytes);
+    return this->transport->startSend(data, num_bytes, dest, tag);
+}
+
+void ProfilingTransport::reserveMessages(int num_bytes, int dest, int tag) {
+    this->transport->reserveMessages(num_bytes, dest, tag);
+}
+
+int ProfilingTransport::startRecv(void* data, int num_bytes, int source, int tag) {
+    return this->transport->startRecv(data, num_bytes, source, tag);
+}
+
+void ProfilingTransport::wait(int request) {
+    this->beginWait();
+    this->transport->wait(request);
+    this->endWait();
+}
+
+TransportFile* ProfilingTransport::openFile(const char* file_name) {
+    return this->transport->openFile(file_name);
+}
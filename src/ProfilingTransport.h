@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PROFILINGTRANSPORT_H
+#define CA_TRAFFIC_SIMULATION_PROFILINGTRANSPORT_H
+
+#include <chrono>
+
+#include "Transport.h"
+
+/**
+ * Transport that passes every operation on to another Transport while it counts the messages and collectives of its
+ * rank and times how long the rank is blocked in them. The time a rank spends waiting for its neighbours or for a
+ * collective is the part of its run that is not computation, which the scaling study reports per rank.
+ */
+class ProfilingTransport : public Transport {
+private:
+    Transport* transport;
+    double wait_time;
+    int64_t num_messages;
+    int64_t num_bytes_sent;
+    int64_t num_collectives;
+    std::chrono::steady_clock::time_point wait_start;
+    void beginWait();
+    void endWait();
+    void countMessage(int dest, int num_bytes);
+public:
+    ProfilingTransport(Transport* transport);
+    double getWaitTime() const;
+    int64_t getNumMessages() const;
+    int64_t getNumBytesSent() const;
+    int64_t getNumCollectives() const;
+    int getRank() const;
+    int getSize() const;
+    void barrier();
+    void broadcast(void* data, int num_bytes, int root);
+    void sendRecv(const void* send_data, int send_bytes, int dest, void* recv_data, int recv_bytes, int source,
+                  int tag);
+    void reduce(const double* values, double* results, int count, ReduceOp op, int root);
+    void allReduce(const double* values, double* results, int count, ReduceOp op);
+    void allReduce(const int64_t* values, int64_t* results, int count, ReduceOp op);
+    void exclusiveScan(const int64_t* values, int64_t* results, int count);
+    void allGather(const void* data, int num_bytes, void* results);
+    int startReduce(const double* values, double* results, int count, ReduceOp op, int root);
+    int startAllReduce(const double* values, double* results, int count, ReduceOp op);
+    int startSend(const void* data, int num_bytes, int dest, int tag);
+    void reserveMessages(int num_bytes, int dest, int tag);
+    int startRecv(void* data, int num_bytes, int source, int tag);
+    void wait(int request);
+    TransportFile* openFile(const char* file_name);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_PROFILINGTRANSPORT_H
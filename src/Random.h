@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_RANDOM_H
+#define CA_TRAFFIC_SIMULATION_RANDOM_H
+
+#include <cstdint>
+
+/**
+ * Random number generator of the simulation, a SplitMix64 stream per thread. Besides the sequential stream of each
+ * rank, the draws of a Vehicle in a step, or of a spawn in a Lane, come from a stream keyed by the seed of the run, the
+ * Vehicle or Lane, the step and the purpose of the draw. The same decision therefore gets the same random numbers in
+ * two runs with the same seed no matter what else differs between them, which is what makes common random numbers
+ * work for paired comparisons, and the ranks of a run on threads never share or lock a generator.
+ */
+namespace Random {
+    // Purposes of the keyed streams
+    const uint64_t STREAM_SPAWN = 1;
+    const uint64_t STREAM_LANE_CHANGE = 2;
+    const uint64_t STREAM_SPEED = 3;
+    const uint64_t STREAM_ARRIVALS = 4;
+
+    // Increment of the SplitMix64 state, the golden ratio in fixed point
+    const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+    // Seed of the run, the same on every rank, and state of the generator of the calling thread
+    inline thread_local uint64_t run_seed = 0;
+    inline thread_local uint64_t state = GOLDEN_GAMMA;
+
+    /**
+     * Mixes the bits of a value with the SplitMix64 finalizer
+     * @param value the value
+     * @return the mixed value
+     */
+    inline uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+
+    /**
+     * Seeds the generator of the calling thread
+     * @param seed the seed of the run
+     * @param stream the sequential stream of the thread, usually its rank
+     */
+    inline void seed(uint64_t seed, int stream) {
+        run_seed = seed;
+        state = mix(seed + GOLDEN_GAMMA * ((uint64_t) stream + 1));
+    }
+
+    /**
+     * Starts the keyed stream of a decision, which the following draws come from
+     * @param key the Vehicle id, or the Lane number for spawns
+     * @param counter the age of the Vehicle in steps, or the step for spawns
+     * @param purpose the purpose of the draws
+     */
+    inline void beginStream(uint64_t key, uint64_t counter, uint64_t purpose) {
+        state = mix(mix(mix(run_seed + GOLDEN_GAMMA * purpose) ^ key) + counter);
+    }
+
+    /**
+     * Draws the next 64 random bits
+     * @return the random bits
+     */
+    inline uint64_t next() {
+        state += GOLDEN_GAMMA;
+        return mix(state);
+    }
+
+    /**
+     * Draws a uniform random number from the unit interval
+     * @return the random number
+     */
+    inline double uniform() {
+        return (double) (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_RANDOM_H
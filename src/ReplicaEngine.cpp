@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "ReplicaEngine.h"
+#include "Random.h"
+#include "Placement.h"
+#include "RuleSets.h"
+
+// Number of replicas in a group, one per bit of a machine word
+const int REPLICAS_PER_GROUP = 64;
+
+// Number of bits of the slow down probability used to build the random braking masks
+const int RANDOM_MASK_BITS = 16;
+
+namespace {
+    /**
+     * Computes the mask of the replicas in which a bit-sliced speed is less than a constant
+     * @param planes the bit planes of the speed, least significant first
+     * @param num_bits number of bit planes
+     * @param k the constant to compare with
+     * @return mask of the replicas with speed less than k
+     */
+    inline uint64_t lessThan(const uint64_t* planes, int num_bits, int k) {
+        uint64_t less = 0;
+        uint64_t equal = ~0ULL;
+        for (int b = num_bits - 1; b >= 0; b--) {
+            if ((k >> b) & 1) {
+                less |= equal & ~planes[b];
+                equal &= planes[b];
+            } else {
+                equal &= ~planes[b];
+            }
+        }
+        return less;
+    }
+
+    /**
+     * Computes the mask of the replicas in which a bit-sliced speed equals a constant
+     * @param planes the bit planes of the speed, least significant first
+     * @param num_bits number of bit planes
+     * @param k the constant to compare with
+     * @return mask of the replicas with speed equal to k
+     */
+    inline uint64_t equalTo(const uint64_t* planes, int num_bits, int k) {
+        uint64_t equal = ~0ULL;
+        for (int b = 0; b < num_bits; b++) {
+            equal &= ((k >> b) & 1) ? planes[b] : ~planes[b];
+        }
+        return equal;
+    }
+
+    /**
+     * Increments a bit-sliced speed in the replicas of a mask
+     * @param planes the bit planes of the speed, least significant first
+     * @param num_bits number of bit planes
+     * @param mask mask of the replicas to increment in
+     */
+    inline void increment(uint64_t* planes, int num_bits, uint64_t mask) {
+        uint64_t carry = mask;
+        for (int b = 0; b < num_bits && carry != 0; b++) {
+            uint64_t next_carry = planes[b] & carry;
+            planes[b] ^= carry;
+            carry = next_carry;
+        }
+    }
+
+    /**
+     * Decrements a bit-sliced speed in the replicas of a mask
+     * @param planes the bit planes of the speed, least significant first
+     * @param num_bits number of bit planes
+     * @param mask mask of the replicas to decrement in
+     */
+    inline void decrement(uint64_t* planes, int num_bits, uint64_t mask) {
+        uint64_t borrow = mask;
+        for (int b = 0; b < num_bits && borrow != 0; b++) {
+            uint64_t next_borrow = ~planes[b] & borrow;
+            planes[b] ^= borrow;
+            borrow = next_borrow;
+        }
+    }
+
+    /**
+     * Sets a bit-sliced speed to a constant in the replicas of a mask
+     * @param planes the bit planes of the speed, least significant first
+     * @param num_bits number of bit planes
+     * @param mask mask of the replicas to set the speed in
+     * @param k the constant speed
+     */
+    inline void assign(uint64_t* planes, int num_bits, uint64_t mask, int k) {
+        for (int b = 0; b < num_bits; b++) {
+            planes[b] = ((k >> b) & 1) ? (planes[b] | mask) : (planes[b] & ~mask);
+        }
+    }
+}
+
+/**
+ * Constructor for the ReplicaEngine
+ * @param transport the Transport to the other processes
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+ReplicaEngine::ReplicaEngine(Transport* transport, const Inputs& inputs, int rank, int size) {
+    this->transport = transport;
+    if (inputs.use_scenario != 0 || inputs.use_demand_profile != 0) {
+        if (rank == 0) {
+            std::cout << "error: the replica engine does not support scenario or demand profile files!" << std::endl;
+        }
+        throw std::exception();
+    }
+    if (inputs.probe_fraction > 0.0) {
+        if (rank == 0) {
+            std::cout << "error: the replica engine does not support probe Vehicles!" << std::endl;
+        }
+        throw std::exception();
+    }
+    if (inputs.prob_change > 0.0) {
+        if (rank == 0) {
+            std::cout << "error: the replica engine does not support lane changes!" << std::endl;
+        }
+        throw std::exception();
+    }
+    if (inputs.rule_set != RuleSets::NagelSchreckenberg::ID) {
+        if (rank == 0) {
+            std::cout << "error: the replica engine only supports the Nagel-Schreckenberg rule set "
+                      << RuleSets::NagelSchreckenberg::ID << "!" << std::endl;
+        }
+        throw std::exception();
+    }
+    this->inputs = inputs;
+    this->num_lanes = inputs.num_lanes;
+    this->length = inputs.length;
+
+    // Each site stores the occupancy word followed by the speed bit planes
+    this->num_speed_bits = 1;
+    while ((1 << this->num_speed_bits) <= inputs.max_speed) {
+        this->num_speed_bits++;
+    }
+    this->site_stride = 1 + this->num_speed_bits;
+
+    // Divide the groups of replicas between the processes in a round robin
+    this->num_groups = (inputs.num_replicas + REPLICAS_PER_GROUP - 1) / REPLICAS_PER_GROUP;
+    for (int g = rank; g < this->num_groups; g += size) {
+        this->group_ids.push_back(g);
+    }
+
+    // Allocate the state of each Lane of each group, with every site initially empty
+    const int num_local_groups = this->group_ids.size();
+    const size_t lane_words = (size_t) this->length * this->site_stride;
+    this->state.resize(num_local_groups * this->num_lanes, std::vector<uint64_t>(lane_words, 0));
+
+    // Start the workers that run the groups, on the cores planned for them if the ranks are pinned, each with its own
+    // buffer for the next state of a Lane
+    std::vector<int> worker_cpus;
+    if (Placement::planWorkerCpus(rank, inputs.num_workers, &worker_cpus) != 0) {
+        throw std::exception();
+    }
+    this->scheduler = new TaskScheduler(inputs.num_workers, worker_cpus);
+    this->next_state.assign(this->scheduler->getNumWorkers(), std::vector<uint64_t>(lane_words, 0));
+
+    // Initialize the per-replica spawning and measurement counters
+    const int num_local_replicas = num_local_groups * REPLICAS_PER_GROUP;
+    this->steps_to_spawn.assign(num_local_replicas * this->num_lanes, 0);
+    this->num_on_road.assign(num_local_replicas, 0);
+    this->num_exited.assign(num_local_replicas, 0);
+    this->occupancy_sum.assign(num_local_replicas, 0.0);
+
+    // Seed an independent random stream for each group
+    this->rng_state.resize(num_local_groups);
+    const uint64_t seed = Random::next();
+    for (int i = 0; i < num_local_groups; i++) {
+        this->rng_state[i] = seed * 0x9E3779B97F4A7C15ULL + (uint64_t) (this->group_ids[i] + 1) * 0xBF58476D1CE4E5B9ULL;
+        if (this->rng_state[i] == 0) {
+            this->rng_state[i] = 1;
+        }
+    }
+
+    this->interarrival_time_cdf = new CDF();
+    if (this->interarrival_time_cdf->read_cdf("interarrival-cdf.dat") != 0) {
+        throw std::exception();
+    }
+}
+
+/**
+ * Destructor for the ReplicaEngine
+ */
+ReplicaEngine::~ReplicaEngine() {
+    delete this->interarrival_time_cdf;
+    delete this->scheduler;
+}
+
+/**
+ * Draws a random word from the stream of a group with a xorshift64* generator
+ * @param group index of the group on this process
+ * @return the random word
+ */
+uint64_t ReplicaEngine::nextRandom(int group) {
+    uint64_t x = this->rng_state[group];
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    this->rng_state[group] = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Builds a random mask in which each bit is set with the slow down probability, by combining uniform random words
+ * along the binary expansion of the probability
+ * @param group index of the group on this process
+ * @return the random mask
+ */
+uint64_t ReplicaEngine::randomMask(int group) {
+    const uint64_t threshold = (uint64_t) std::llround(this->inputs.prob_slow_down * (1 << RANDOM_MASK_BITS));
+    if (threshold >= (1ULL << RANDOM_MASK_BITS)) {
+        return ~0ULL;
+    }
+    uint64_t mask = 0;
+    for (int b = 0; b < RANDOM_MASK_BITS; b++) {
+        uint64_t word = this->nextRandom(group);
+        mask = ((threshold >> b) & 1) ? (mask | word) : (mask & word);
+    }
+    return mask;
+}
+
+/**
+ * Advances a Lane of a group of replicas by one step with the Nagel-Schreckenberg rules
+ * @param group index of the group on this process
+ * @param lane the number of the Lane
+ * @param measure whether to count the Vehicles that leave the road
+ * @param worker the worker running the group, whose buffer holds the next state
+ */
+void ReplicaEngine::stepLane(int group, int lane, bool measure, int worker) {
+    const int stride = this->site_stride;
+    const int num_bits = this->num_speed_bits;
+    const int max_speed = this->inputs.max_speed;
+    std::vector<uint64_t>& lane_state = this->state[group * this->num_lanes + lane];
+    const uint64_t* sites = lane_state.data();
+    std::vector<uint64_t>& next_lane_state = this->next_state[worker];
+    uint64_t* next_sites = next_lane_state.data();
+    std::fill(next_lane_state.begin(), next_lane_state.end(), 0);
+
+    for (int i = 0; i < this->length; i++) {
+        const uint64_t occupied = sites[(size_t) i * stride];
+        if (occupied == 0) {
+            continue;
+        }
+        uint64_t speed[8];
+        std::copy(sites + (size_t) i * stride + 1, sites + (size_t) i * stride + 1 + num_bits, speed);
+
+        // Accelerate by one up to the maximum speed
+        increment(speed, num_bits, occupied & lessThan(speed, num_bits, max_speed));
+
+        // Slow down to the gap ahead, where the first Vehicle found at distance k limits the speed to k - 1
+        uint64_t free_ahead = occupied;
+        for (int k = 1; k <= max_speed && i + k < this->length && free_ahead != 0; k++) {
+            const uint64_t blocked = free_ahead & sites[(size_t) (i + k) * stride];
+            if (blocked != 0) {
+                assign(speed, num_bits, blocked & ~lessThan(speed, num_bits, k), k - 1);
+                free_ahead &= ~blocked;
+            }
+        }
+
+        // Randomly slow down the moving Vehicles
+        const uint64_t moving = occupied & ~equalTo(speed, num_bits, 0);
+        if (moving != 0) {
+            decrement(speed, num_bits, moving & this->randomMask(group));
+        }
+
+        // Move the Vehicles of each speed to their new sites, or off the end of the road
+        for (int s = 0; s <= max_speed; s++) {
+            uint64_t moved = occupied & equalTo(speed, num_bits, s);
+            if (moved == 0) {
+                continue;
+            }
+            const int target = i + s;
+            if (target >= this->length) {
+                const int replica_base = group * REPLICAS_PER_GROUP;
+                while (moved != 0) {
+                    const int r = __builtin_ctzll(moved);
+                    this->num_on_road[replica_base + r]--;
+                    if (measure) {
+                        this->num_exited[replica_base + r]++;
+                    }
+                    moved &= moved - 1;
+                }
+                continue;
+            }
+            uint64_t* target_site = next_sites + (size_t) target * stride;
+            target_site[0] |= moved;
+            for (int b = 0; b < num_bits; b++) {
+                if ((s >> b) & 1) {
+                    target_site[1 + b] |= moved;
+                }
+            }
+        }
+    }
+
+    // The new state becomes the state of the Lane, and the old state is reused as the buffer of the next update
+    lane_state.swap(next_lane_state);
+}
+
+/**
+ * Attempts to spawn a Vehicle at the first site of a Lane in each replica of a group, with the same interarrival
+ * sampling as Lane::attemptSpawn. The draws come from a stream keyed by the group and the Lane, so they do not depend
+ * on which worker runs the group.
+ * @param group index of the group on this process
+ * @param lane the number of the Lane
+ * @param time the current step
+ */
+void ReplicaEngine::spawn(int group, int lane, int time) {
+    uint64_t* first_site = this->state[group * this->num_lanes + lane].data();
+    Random::beginStream((uint64_t) this->group_ids[group] * this->num_lanes + lane, time, Random::STREAM_SPAWN);
+    for (int r = 0; r < REPLICAS_PER_GROUP; r++) {
+        const int replica = group * REPLICAS_PER_GROUP + r;
+        int& steps = this->steps_to_spawn[replica * this->num_lanes + lane];
+        if (steps != 0) {
+            steps--;
+            continue;
+        }
+        const uint64_t bit = 1ULL << r;
+        if (first_site[0] & bit) {
+            continue;
+        }
+
+        // Spawn at the maximum speed, or stopped with the slow down probability
+        int speed = this->inputs.max_speed;
+        if (Random::uniform() < this->inputs.prob_slow_down) {
+            speed = 0;
+        }
+        first_site[0] |= bit;
+        assign(first_site + 1, this->num_speed_bits, bit, speed);
+        this->num_on_road[replica]++;
+
+        // "Schedule" next Vehicle spawn
+        steps = (int) (this->interarrival_time_cdf->query() / this->inputs.step_size);
+    }
+}
+
+/**
+ * Runs the ensemble and reports the ensemble statistics of the travel time, flow and density
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return 0 if successful, nonzero otherwise
+ */
+int ReplicaEngine::run(int rank, int size) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    const int num_local_groups = this->group_ids.size();
+    const uint64_t run_seed = Random::run_seed;
+    for (int time = 0; time < this->inputs.max_time; time++) {
+        const bool measure = time >= this->inputs.warmup_time;
+
+        // Advance each group as a task, since the groups share no state
+        auto group_body = [&](int begin, int end, int worker) {
+            Random::run_seed = run_seed;
+            for (int g = begin; g < end; g++) {
+                for (int lane = 0; lane < this->num_lanes; lane++) {
+                    this->stepLane(g, lane, measure, worker);
+                }
+                for (int lane = 0; lane < this->num_lanes; lane++) {
+                    this->spawn(g, lane, time);
+                }
+            }
+        };
+        this->scheduler->parallelFor(num_local_groups, 1, group_body);
+
+        // Integrate the number of Vehicles on the road of each replica for the mean density
+        if (measure) {
+            for (int r = 0; r < (int) this->num_on_road.size(); r++) {
+                this->occupancy_sum[r] += this->num_on_road[r];
+            }
+        }
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double time_elapsed = (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000000.0;
+
+    // Compute the statistics of each replica, with the travel time from Little's law
+    const double num_steps = std::max(1, this->inputs.max_time - this->inputs.warmup_time);
+    double sums[7] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (int g = 0; g < num_local_groups; g++) {
+        for (int r = 0; r < REPLICAS_PER_GROUP; r++) {
+            // Skip the padding replicas of the last group
+            if (this->group_ids[g] * REPLICAS_PER_GROUP + r >= this->inputs.num_replicas) {
+                continue;
+            }
+            const int replica = g * REPLICAS_PER_GROUP + r;
+            const double throughput = this->num_exited[replica] / num_steps;
+            const double mean_on_road = this->occupancy_sum[replica] / num_steps;
+            const double travel_time = throughput > 0.0 ? mean_on_road / throughput * this->inputs.step_size : 0.0;
+            const double flow = throughput / this->num_lanes * 3600.0 / this->inputs.step_size;
+            const double density = mean_on_road / ((double) this->num_lanes * this->length);
+            sums[0] += 1.0;
+            sums[1] += travel_time;
+            sums[2] += travel_time * travel_time;
+            sums[3] += flow;
+            sums[4] += flow * flow;
+            sums[5] += density;
+            sums[6] += density * density;
+        }
+    }
+
+    double totals[7];
+    this->transport->reduce(sums, totals, 7, REDUCE_SUM, 0);
+    double max_time_elapsed;
+    this->transport->reduce(&time_elapsed, &max_time_elapsed, 1, REDUCE_MAX, 0);
+
+    if (rank == 0) {
+        const double n = totals[0];
+        const char* names[3] = {"Travel time [s]", "Flow [veh/h/lane]", "Density [veh/site]"};
+        std::cout << "--- Ensemble Statistics (" << (long) n << " replicas, 95% confidence) ---" << std::endl;
+        for (int i = 0; i < 3; i++) {
+            const double mean = totals[1 + 2 * i] / n;
+            const double variance = n > 1.0 ? (totals[2 + 2 * i] - n * mean * mean) / (n - 1.0) : 0.0;
+            const double half_width = 1.96 * std::sqrt(std::max(0.0, variance) / n);
+            std::cout << names[i] << ": " << mean << " +/- " << half_width << std::endl;
+        }
+
+        const double site_updates = (double) this->num_groups * REPLICAS_PER_GROUP * this->num_lanes * this->length
+                                    * this->inputs.max_time;
+        std::cout << "--- Simulation Performance ---" << std::endl;
+        std::cout << "Total computation time (max across all processes): " << max_time_elapsed << " [s]" << std::endl;
+        std::cout << "Replica site updates per second: " << site_updates / max_time_elapsed << std::endl;
+    }
+
+    // Report the utilization of the workers
+    if (this->inputs.num_workers > 1) {
+        this->scheduler->report(this->transport);
+    }
+
+    // Return with no errors
+    return 0;
+}
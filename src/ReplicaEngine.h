@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_REPLICAENGINE_H
+#define CA_TRAFFIC_SIMULATION_REPLICAENGINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Inputs.h"
+#include "Transport.h"
+#include "CDF.h"
+#include "TaskScheduler.h"
+
+/**
+ * Class for the multi-spin coded engine that simulates an ensemble of replicas of the road at once. The replicas are
+ * packed 64 to a group, with one bit per replica in each machine word. Every site of a Lane holds an occupancy word
+ * and one word per bit of the speed, so a handful of bitwise operations advances a site in all 64 replicas of a group
+ * through the acceleration, gap clamping, random braking and movement rules. The replicas use the Lane and parameter
+ * model of the Inputs with the Nagel-Schreckenberg rules, and the Lanes of a replica are independent of each other.
+ * The groups are divided between the processes, which need no communication until the ensemble is reduced, and the
+ * groups of a process are run as tasks on its workers.
+ */
+class ReplicaEngine {
+private:
+    Transport* transport;
+    Inputs inputs;
+    int num_lanes;
+    int length;
+    int num_speed_bits;
+    int site_stride;
+    int num_groups;
+    std::vector<int> group_ids;
+    std::vector<std::vector<uint64_t>> state;
+    std::vector<std::vector<uint64_t>> next_state;
+    std::vector<int> steps_to_spawn;
+    std::vector<long> num_on_road;
+    std::vector<long> num_exited;
+    std::vector<double> occupancy_sum;
+    std::vector<uint64_t> rng_state;
+    CDF* interarrival_time_cdf;
+    TaskScheduler* scheduler;
+    uint64_t nextRandom(int group);
+    uint64_t randomMask(int group);
+    void stepLane(int group, int lane, bool measure, int worker);
+    void spawn(int group, int lane, int time);
+public:
+    ReplicaEngine(Transport* transport, const Inputs& inputs, int rank, int size);
+    ~ReplicaEngine();
+    int run(int rank, int size);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_REPLICAENGINE_H
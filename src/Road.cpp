@@ -6,20 +6,44 @@
 #include "Inputs.h"
 #include <fstream>
 #include <iostream>
-#include <mpi.h>
+
+// Tags of the messages with the gaps at the ends of the segments
+const int TAG_GAP_LAST_TO_END = 6;
+const int TAG_GAP_START_TO_FIRST = 8;
 
 /**
  * Constructor for the Road
+ * @param transport the Transport to the neighbouring processes
  * @param inputs instance of the Inputs class with simulation inputs
  */
-Road::Road(Inputs inputs, int start_site, int end_site, int rank) {
+Road::Road(Transport* transport, const Inputs& inputs, int start_site, int end_site, int rank) {
+    this->transport = transport;
 #ifdef DEBUG
     std::cout << "creating new road with " << inputs.num_lanes << " lanes..." << std::endl;
 #endif
-    // Create the Lane objects for the Road
+    // Read the speed limits, closed sites and initial Vehicles of the road, or map them from the binary file
+    Scenario scenario;
+    if (scenario.read_scenario(inputs, "cats-scenario.txt") != 0 ||
+        scenario.map_scenario(inputs, "cats-scenario.bin") != 0) {
+        throw std::exception();
+    }
+
+    // Allocate the occupancy of the sites of every Lane in whole tiles, and create the Lane objects for the Road
+    const int num_tiles = (end_site - start_site + LANE_TILE_SITES) / LANE_TILE_SITES;
+    this->occupancy.assign((size_t) num_tiles * LANE_TILE_SITES * inputs.num_lanes, 0);
     for (int i = 0; i < inputs.num_lanes; i++) {
-        this->lanes.push_back(new Lane(inputs, i, start_site, end_site, rank));
+        this->lanes.push_back(new Lane(inputs, scenario, this->occupancy.data(), i, start_site, end_site, rank));
     }
+
+    // Allocate the gaps at the ends of the Lanes that are exchanged with the neighboring processes
+    this->gaps_from_start.assign(inputs.num_lanes, 0);
+    this->gaps_from_end.assign(inputs.num_lanes, 0);
+    this->received_gaps_from_start.assign(inputs.num_lanes, -1);
+    this->received_gaps_from_end.assign(inputs.num_lanes, -1);
+    const int num_gap_bytes = inputs.num_lanes * sizeof(int);
+    this->transport->reserveMessages(num_gap_bytes, (rank > 0) ? rank - 1 : TRANSPORT_NO_RANK, TAG_GAP_START_TO_FIRST);
+    this->transport->reserveMessages(num_gap_bytes, (rank < transport->getSize() - 1) ? rank + 1 : TRANSPORT_NO_RANK,
+                                     TAG_GAP_LAST_TO_END);
 #ifdef DEBUG
     if (rank == 0) {
         std::cout << "done creating road" << std::endl;
@@ -31,6 +55,12 @@ Road::Road(Inputs inputs, int start_site, int end_site, int rank) {
     if (status != 0) {
         throw std::exception();
     }
+
+    // Create the schedule of the arrivals at the start of the Lanes with the demand profile
+    this->arrivals = new ArrivalSchedule(inputs, this->interarrival_time_cdf);
+    if (this->arrivals->read_profile(inputs, "cats-demand.txt") != 0) {
+        throw std::exception();
+    }
 }
 
 /**
@@ -41,13 +71,17 @@ Road::~Road() {
     for (int i = 0; i < (int) this->lanes.size(); i++) {
         delete this->lanes[i];
     }
+
+    // Delete the arrival schedule and the interarrival time CDF
+    delete this->arrivals;
+    delete this->interarrival_time_cdf;
 }
 
 /**
  * Getter for the Lanes of the road
- * @return
+ * @return reference to the list of Lanes, valid for the lifetime of the Road
  */
-std::vector<Lane*> Road::getLanes() {
+const std::vector<Lane*>& Road::getLanes() const {
     return this->lanes;
 }
 
@@ -55,12 +89,12 @@ std::vector<Lane*> Road::getLanes() {
  * Attempts to spawn Vehicles on each Lane of the Road
  * @param inputs instance of the Inputs class with the simulation Inputs
  * @param vehicles pointer to the array of Vehicles that exist
- * @param next_id_ptr pointer to the id of the next spawned Vehicle
+ * @param step the current step
  * @return 0 if successful, nonzero otherwise
  */
-int Road::attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr) {
+int Road::attemptSpawn(const Inputs& inputs, std::vector<Vehicle*>* vehicles, int step) {
     for (int i = 0; i < (int) this->lanes.size(); i++) {
-        this->lanes[i]->attemptSpawn(inputs, vehicles, next_id_ptr, this->interarrival_time_cdf);
+        this->lanes[i]->attemptSpawn(inputs, vehicles, step, this->arrivals);
     }
 
     // Return with no errors
@@ -72,50 +106,75 @@ int Road::attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next
  */
 #ifdef DEBUG
 void Road::printRoad(int rank, int size) {
-    MPI_Barrier(MPI_COMM_WORLD);
+    this->transport->barrier();
     for (int i = this->lanes.size() - 1; i >= 0; i--) {
         this->lanes[i]->printLane(rank, size);
-        MPI_Barrier(MPI_COMM_WORLD);
+        this->transport->barrier();
     }
 }
 #endif
 
 /**
- * Calculates the gaps between vehicles in the road
+ * Starts the exchange of the gaps at the ends of the Lanes with the neighboring processes, which completes with
+ * finish_gap_exchange so that the gaps of the Vehicles away from the ends of the segment can be computed meanwhile
  * @param rank the rank of the process
  * @param size the number of processes
- * @param ofstream the output file stream
  */
-void Road::calculate_gaps_from_neighbor_processes(int rank, int size) {
-    // Temporary variables to store received gap values from neighbors
-
-
-    // Iterate through all lanes of the current process
-    for (auto lane : this->lanes) {
-        int gap_last_vehicle_to_end = lane->getGapFromEnd();
-        int gap_start_to_first_vehicle = lane->getGapFromStart();
+void Road::start_gap_exchange(int rank, int size) {
+    for (int i = 0; i < (int) this->lanes.size(); i++) {
+        this->gaps_from_start[i] = this->lanes[i]->getGapFromStart();
+        this->gaps_from_end[i] = this->lanes[i]->getGapFromEnd();
+    }
 
-        int received_gap_start_to_first_vehicle = -1;
-        int received_gap_last_vehicle_to_end = -1;
+    const int prev_rank = (rank > 0) ? rank - 1 : TRANSPORT_NO_RANK;
+    const int next_rank = (rank < size - 1) ? rank + 1 : TRANSPORT_NO_RANK;
+    const int num_bytes = this->lanes.size() * sizeof(int);
 
-        int TAG_GAP_LAST_TO_END = 6;
-        int TAG_GAP_START_TO_FIRST = 8;
+    // Receive the gaps at the start of the next process and at the end of the previous process, while sending the gap
+    // at the start to the previous process and the gap at the end to the next process
+    this->gap_requests[0] = this->transport->startRecv(this->received_gaps_from_start.data(), num_bytes, next_rank,
+                                                       TAG_GAP_START_TO_FIRST);
+    this->gap_requests[1] = this->transport->startRecv(this->received_gaps_from_end.data(), num_bytes, prev_rank,
+                                                       TAG_GAP_LAST_TO_END);
+    this->gap_requests[2] = this->transport->startSend(this->gaps_from_start.data(), num_bytes, prev_rank,
+                                                       TAG_GAP_START_TO_FIRST);
+    this->gap_requests[3] = this->transport->startSend(this->gaps_from_end.data(), num_bytes, next_rank,
+                                                       TAG_GAP_LAST_TO_END);
+}
 
-        if (rank > 0) {  // There is a previous process (rank - 1)
-            MPI_Send(&gap_start_to_first_vehicle, 1, MPI_INT, rank - 1, TAG_GAP_START_TO_FIRST, MPI_COMM_WORLD);
-        }
-        if (rank < size - 1) {  // There is a next process (rank + 1)
-            MPI_Send(&gap_last_vehicle_to_end, 1, MPI_INT, rank + 1, TAG_GAP_LAST_TO_END, MPI_COMM_WORLD);
-        }
+/**
+ * Completes the exchange of the gaps at the ends of the Lanes and gives each Lane the gaps of the neighboring processes
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+void Road::finish_gap_exchange(int rank, int size) {
+    for (int request : this->gap_requests) {
+        this->transport->wait(request);
+    }
 
+    for (int i = 0; i < (int) this->lanes.size(); i++) {
         if (rank > 0) {  // If there is a previous process
-            MPI_Recv(&received_gap_last_vehicle_to_end, 1, MPI_INT, rank - 1, TAG_GAP_LAST_TO_END, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            lane->setGapPrevProcess(received_gap_last_vehicle_to_end);
+            this->lanes[i]->setGapPrevProcess(this->received_gaps_from_end[i]);
         }
         if (rank < size - 1) {  // If there is a next process
-            MPI_Recv(&received_gap_start_to_first_vehicle, 1, MPI_INT, rank + 1, TAG_GAP_START_TO_FIRST, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            lane->setGapNextProcess(received_gap_start_to_first_vehicle);
+            this->lanes[i]->setGapNextProcess(this->received_gaps_from_start[i]);
         }
     }
-    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+/**
+ * Adds the storage of the Road, its Lanes and its arrival schedule to a MemoryReport
+ * @param report the MemoryReport
+ */
+void Road::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_SITES, this->occupancy);
+    report->addVector(MEMORY_SITES, this->lanes);
+    for (const Lane* lane : this->lanes) {
+        lane->addMemory(report);
+    }
+    this->arrivals->addMemory(report);
+    report->addVector(MEMORY_BUFFERS, this->gaps_from_start);
+    report->addVector(MEMORY_BUFFERS, this->gaps_from_end);
+    report->addVector(MEMORY_BUFFERS, this->received_gaps_from_start);
+    report->addVector(MEMORY_BUFFERS, this->received_gaps_from_end);
 }
@@ -5,30 +5,46 @@
 #ifndef CA_TRAFFIC_SIMULATION_ROAD_H
 #define CA_TRAFFIC_SIMULATION_ROAD_H
 
+#include <cstdint>
 #include <vector>
 
 #include "Lane.h"
 #include "Inputs.h"
 #include "CDF.h"
+#include "ArrivalSchedule.h"
+#include "Scenario.h"
+#include "Transport.h"
+#include "MemoryReport.h"
 
 /**
- * Class for the Road in the Simulation. The road has multiple Lanes that each contain Vehicles. Has methods to attempt
- * spawning Vehicles in the Lanes
+ * Class for the Road in the Simulation. The road has multiple Lanes that each contain Vehicles, numbered from the
+ * rightmost Lane, and owns the tiled occupancy of the sites of all its Lanes. Has methods to attempt spawning Vehicles
+ * in the Lanes
  */
 class Road {
 private:
     std::vector<Lane*> lanes;
+    std::vector<uint8_t> occupancy;
     CDF* interarrival_time_cdf;
+    ArrivalSchedule* arrivals;
+    Transport* transport;
+    std::vector<int> gaps_from_start;
+    std::vector<int> gaps_from_end;
+    std::vector<int> received_gaps_from_start;
+    std::vector<int> received_gaps_from_end;
+    int gap_requests[4];
 public:
-    Road(Inputs inputs, int start_site, int end_site, int rank);
+    Road(Transport* transport, const Inputs& inputs, int start_site, int end_site, int rank);
     ~Road();
-    std::vector<Lane*> getLanes();
-    int attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr);
+    const std::vector<Lane*>& getLanes() const;
+    int attemptSpawn(const Inputs& inputs, std::vector<Vehicle*>* vehicles, int step);
+
+    void start_gap_exchange(int rank, int size);
+    void finish_gap_exchange(int rank, int size);
+    void addMemory(MemoryReport* report) const;
 
 #ifdef DEBUG
     void printRoad(int rank, int size);
-
-    void calculate_gaps_from_neighbor_processes(int rank, int size);
 #endif
 };
 
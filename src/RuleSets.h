@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_RULESETS_H
+#define CA_TRAFFIC_SIMULATION_RULESETS_H
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Random.h"
+
+/**
+ * Rule sets of the cellular automaton. Each rule set is a policy type with static methods for the speed update and
+ * the lane change decision of a Vehicle. The step loop of the Simulation and the movement methods of the Vehicle are
+ * templates instantiated for every rule set, so the rules are inlined into the step loop without any virtual calls
+ * or branches on the rule set. To add a rule set, define its type here, give it the next ID, and add it to
+ * withRuleSet and the explicit instantiations at the end of Vehicle.cpp.
+ */
+namespace RuleSets {
+    /**
+     * Draws a uniform random number from the unit interval
+     * @return the random number
+     */
+    inline double uniform() {
+        return Random::uniform();
+    }
+
+    /**
+     * Symmetric lane change rule of Rickert et al. A Vehicle changes lanes if it is blocked in its own lane, the other
+     * lane has room ahead and behind, and a random draw allows it. The gap tests are split from the random draw so
+     * that they can be evaluated for a batch of Vehicles at once, see LaneChangeBatch.
+     */
+    struct SymmetricLaneChange {
+        static bool wantsLaneChange(int gap_forward, int look_forward, int gap_other_forward, int look_other_forward,
+                                    int gap_other_backward, int look_other_backward) {
+            return (gap_forward < look_forward) &
+                   (gap_other_forward > look_other_forward) &
+                   (gap_other_backward > look_other_backward);
+        }
+
+        static bool acceptsLaneChange(double prob_change) {
+            return uniform() <= prob_change;
+        }
+
+        static bool changesLane(int gap_forward, int look_forward, int gap_other_forward, int look_other_forward,
+                                int gap_other_backward, int look_other_backward, double prob_change) {
+            return wantsLaneChange(gap_forward, look_forward, gap_other_forward, look_other_forward,
+                                   gap_other_backward, look_other_backward) &&
+                   acceptsLaneChange(prob_change);
+        }
+    };
+
+    /**
+     * Nagel-Schreckenberg rules: accelerate by one up to the maximum speed, slow down to the gap ahead, and randomly
+     * slow down by one with the slow down probability. A Vehicle faster than the maximum speed, which is lowered by
+     * the speed limit of its site, slows down to it at once.
+     */
+    struct NagelSchreckenberg : SymmetricLaneChange {
+        static const int ID = 0;
+
+        static int updateSpeed(int speed, int max_speed, int gap_forward, double prob_slow_down,
+                               double prob_slow_down_stopped) {
+            speed = std::min(speed + 1, max_speed);
+            speed = std::min(speed, gap_forward);
+            if (speed > 0 && uniform() <= prob_slow_down) {
+                speed--;
+            }
+            return speed;
+        }
+    };
+
+    /**
+     * Velocity-dependent randomization: Nagel-Schreckenberg rules in which a Vehicle that was stopped slows down
+     * randomly with the probability of slowing down from a stop instead
+     */
+    struct VelocityDependentRandomization : SymmetricLaneChange {
+        static const int ID = 1;
+
+        static int updateSpeed(int speed, int max_speed, int gap_forward, double prob_slow_down,
+                               double prob_slow_down_stopped) {
+            double prob = speed == 0 ? prob_slow_down_stopped : prob_slow_down;
+            return NagelSchreckenberg::updateSpeed(speed, max_speed, gap_forward, prob, prob_slow_down_stopped);
+        }
+    };
+
+    /**
+     * Slow-to-start rule of Benjamin, Johnson and Hui: Nagel-Schreckenberg rules in which a Vehicle that was stopped
+     * and has room to start stays stopped for the step with the probability of slowing down from a stop
+     */
+    struct SlowToStart : SymmetricLaneChange {
+        static const int ID = 2;
+
+        static int updateSpeed(int speed, int max_speed, int gap_forward, double prob_slow_down,
+                               double prob_slow_down_stopped) {
+            if (speed == 0 && gap_forward > 0 && uniform() <= prob_slow_down_stopped) {
+                return 0;
+            }
+            return NagelSchreckenberg::updateSpeed(speed, max_speed, gap_forward, prob_slow_down,
+                                                   prob_slow_down_stopped);
+        }
+    };
+
+    /**
+     * Cruise control rule of Nagel and Paczuski: Nagel-Schreckenberg rules in which a Vehicle that is cruising at the
+     * maximum speed with room to keep it does not slow down randomly
+     */
+    struct CruiseControl : SymmetricLaneChange {
+        static const int ID = 3;
+
+        static int updateSpeed(int speed, int max_speed, int gap_forward, double prob_slow_down,
+                               double prob_slow_down_stopped) {
+            if (speed == max_speed && gap_forward >= max_speed) {
+                return max_speed;
+            }
+            return NagelSchreckenberg::updateSpeed(speed, max_speed, gap_forward, prob_slow_down,
+                                                   prob_slow_down_stopped);
+        }
+    };
+
+    /**
+     * Calls a generic visitor with an instance of the rule set that has an ID, so that the visitor can instantiate a
+     * step loop for the rule set once per run
+     * @param id the ID of the rule set
+     * @param visitor callable taking the rule set instance as its argument
+     * @return true if the rule set exists, false otherwise
+     */
+    template <class Visitor>
+    bool withRuleSet(int id, Visitor&& visitor) {
+        switch (id) {
+            case NagelSchreckenberg::ID:
+                visitor(NagelSchreckenberg());
+                return true;
+            case VelocityDependentRandomization::ID:
+                visitor(VelocityDependentRandomization());
+                return true;
+            case SlowToStart::ID:
+                visitor(SlowToStart());
+                return true;
+            case CruiseControl::ID:
+                visitor(CruiseControl());
+                return true;
+            default:
+                return false;
+        }
+    }
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_RULESETS_H
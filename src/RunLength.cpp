@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include "RunLength.h"
+
+// Number of steps averaged into one observation of the travel time and flow series
+const int RUN_LENGTH_OBSERVATION_STEPS = 20;
+
+// Number of observations averaged into one batch by the MSER-5 rule
+const int RUN_LENGTH_MSER_BATCH_SIZE = 5;
+
+// Number of steps in one batch of the series
+const int RUN_LENGTH_BATCH_STEPS = RUN_LENGTH_OBSERVATION_STEPS * RUN_LENGTH_MSER_BATCH_SIZE;
+
+// Number of steps between the stop decisions
+const int RUN_LENGTH_CHECK_INTERVAL = 1000;
+
+// Number of batch means of the confidence interval, and the Student t quantile for its 95% level
+const int RUN_LENGTH_NUM_CI_BATCHES = 20;
+const double RUN_LENGTH_T_QUANTILE = 2.093;
+
+// Minimum number of series batches in each batch mean of the confidence interval
+const int RUN_LENGTH_MIN_BATCHES_PER_CI_BATCH = 2;
+
+namespace {
+    /**
+     * Finds the truncation point of a series of batch means with the MSER rule, which minimizes the squared standard
+     * error of the mean of the batches that are kept. Only the first half of the series is searched.
+     * @param values the batch means
+     * @param num_values number of batch means
+     * @return number of batches to truncate, -1 if the minimum is at the end of the search so the transient may not
+     * be over yet
+     */
+    int mserTruncation(const double* values, int num_values) {
+        if (num_values < 2 * RUN_LENGTH_MSER_BATCH_SIZE) {
+            return -1;
+        }
+
+        // Accumulate the sums of the kept batches from the end of the series backwards
+        const int max_truncation = num_values / 2;
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        double best_statistic = std::numeric_limits<double>::infinity();
+        int best_truncation = -1;
+        for (int d = num_values - 1; d >= 0; d--) {
+            sum += values[d];
+            sum_squares += values[d] * values[d];
+            if (d <= max_truncation) {
+                const double n = num_values - d;
+                const double statistic = (sum_squares - sum * sum / n) / (n * n);
+                if (statistic <= best_statistic) {
+                    best_statistic = statistic;
+                    best_truncation = d;
+                }
+            }
+        }
+
+        return (best_truncation < max_truncation) ? best_truncation : -1;
+    }
+}
+
+/**
+ * Constructor for the RunLength
+ * @param transport the Transport used to agree on the stop decision
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+RunLength::RunLength(Transport* transport, const Inputs& inputs, int rank, int size) {
+    this->transport = transport;
+    this->target_precision = inputs.target_precision;
+    this->step_size = inputs.step_size;
+    this->rank = rank;
+    this->root = size - 1;
+    this->batch_travel_time = 0.0;
+    this->batch_num_trips = 0;
+    this->input_warmup_batches = (inputs.warmup_time + RUN_LENGTH_BATCH_STEPS - 1) / RUN_LENGTH_BATCH_STEPS;
+    this->mean_travel_time = 0.0;
+
+    // Reserve the series for the longest run so that the steps do not allocate
+    if (this->isEnabled() && rank == this->root) {
+        const int max_batches = inputs.max_time / RUN_LENGTH_BATCH_STEPS + 1;
+        this->travel_time_sums.reserve(max_batches);
+        this->trip_counts.reserve(max_batches);
+        this->series.reserve(max_batches);
+        this->series_batches.reserve(max_batches);
+    }
+}
+
+/**
+ * Checks whether the run length is adaptive
+ * @return true if the run stops once the target precision is reached, false if it runs for the maximum time
+ */
+bool RunLength::isEnabled() {
+    return this->target_precision > 0.0;
+}
+
+/**
+ * Adds the travel time of a Vehicle that left the road during the current step
+ * @param travel_time the travel time of the Vehicle
+ */
+void RunLength::addTrip(double travel_time) {
+    this->batch_travel_time += travel_time;
+    this->batch_num_trips++;
+}
+
+/**
+ * Computes the mean travel time of the Vehicles that left the road from a batch of the series on
+ * @param first_batch the first batch of the series that is kept
+ * @return the mean travel time, zero if no Vehicle left the road in the kept batches
+ */
+double RunLength::getBatchesMean(int first_batch) {
+    double total_travel_time = 0.0;
+    long total_trips = 0;
+    for (int j = first_batch; j < (int) this->trip_counts.size(); j++) {
+        total_travel_time += this->travel_time_sums[j];
+        total_trips += this->trip_counts[j];
+    }
+    return (total_trips > 0) ? total_travel_time / total_trips : 0.0;
+}
+
+/**
+ * Detects the end of the initial transient from the flow and travel time series, and estimates the mean travel time
+ * after it with a batch means confidence interval
+ * @param mean pointer to hold the mean travel time, after the warm-up of the inputs if the transient may not be over
+ * @param half_width pointer to hold the half-width of the 95% confidence interval, infinite if there are too few
+ * batches after the transient
+ * @return number of batches in the transient, -1 if the transient may not be over yet
+ */
+int RunLength::detectWarmup(double* mean, double* half_width) {
+    *mean = this->getBatchesMean(this->input_warmup_batches);
+    *half_width = std::numeric_limits<double>::infinity();
+    const int num_batches = this->trip_counts.size();
+
+    // Truncation point of the flow series
+    this->series.clear();
+    for (int j = 0; j < num_batches; j++) {
+        this->series.push_back(this->trip_counts[j] / (double) RUN_LENGTH_BATCH_STEPS);
+    }
+    const int flow_truncation = mserTruncation(this->series.data(), num_batches);
+
+    // Truncation point of the travel time series, which only has values for the batches in which Vehicles left
+    this->series.clear();
+    this->series_batches.clear();
+    for (int j = 0; j < num_batches; j++) {
+        if (this->trip_counts[j] > 0) {
+            this->series.push_back(this->travel_time_sums[j] / this->trip_counts[j]);
+            this->series_batches.push_back(j);
+        }
+    }
+    const int travel_time_truncation = mserTruncation(this->series.data(), this->series.size());
+
+    if (flow_truncation < 0 || travel_time_truncation < 0) {
+        return -1;
+    }
+    const int warmup = std::max(flow_truncation, this->series_batches[travel_time_truncation]);
+
+    // Group the batches after the transient into the batch means of the confidence interval
+    const int num_kept = num_batches - warmup;
+    *mean = this->getBatchesMean(warmup);
+    double batch_means[RUN_LENGTH_NUM_CI_BATCHES];
+    bool all_batches_have_trips = true;
+    for (int g = 0; g < RUN_LENGTH_NUM_CI_BATCHES; g++) {
+        const int begin = warmup + (int) ((long) g * num_kept / RUN_LENGTH_NUM_CI_BATCHES);
+        const int end = warmup + (int) ((long) (g + 1) * num_kept / RUN_LENGTH_NUM_CI_BATCHES);
+        double group_travel_time = 0.0;
+        long group_trips = 0;
+        for (int j = begin; j < end; j++) {
+            group_travel_time += this->travel_time_sums[j];
+            group_trips += this->trip_counts[j];
+        }
+        if (group_trips > 0) {
+            batch_means[g] = group_travel_time / group_trips;
+        } else {
+            all_batches_have_trips = false;
+        }
+    }
+    // Each batch mean must span at least one mean travel time, so that consecutive batch means are nearly independent
+    const double min_batch_steps = std::max((double) RUN_LENGTH_MIN_BATCHES_PER_CI_BATCH * RUN_LENGTH_BATCH_STEPS,
+                                            *mean / this->step_size);
+    if ((double) num_kept * RUN_LENGTH_BATCH_STEPS < RUN_LENGTH_NUM_CI_BATCHES * min_batch_steps ||
+        !all_batches_have_trips) {
+        return warmup;
+    }
+
+    double mean_of_batches = 0.0;
+    for (double batch_mean : batch_means) {
+        mean_of_batches += batch_mean / RUN_LENGTH_NUM_CI_BATCHES;
+    }
+    double variance = 0.0;
+    for (double batch_mean : batch_means) {
+        variance += (batch_mean - mean_of_batches) * (batch_mean - mean_of_batches) / (RUN_LENGTH_NUM_CI_BATCHES - 1);
+    }
+    *half_width = RUN_LENGTH_T_QUANTILE * std::sqrt(variance / RUN_LENGTH_NUM_CI_BATCHES);
+
+    return warmup;
+}
+
+/**
+ * Ends a step, closing the batch of trips at the end of each batch and deciding whether to stop at each check
+ * interval, collective over all the processes at the check intervals
+ * @param step the step that just ended
+ * @return true if all the processes stop after this step, false otherwise
+ */
+bool RunLength::endStep(int step) {
+    if (!this->isEnabled()) {
+        return false;
+    }
+
+    if (this->rank == this->root && step % RUN_LENGTH_BATCH_STEPS == 0) {
+        this->travel_time_sums.push_back(this->batch_travel_time);
+        this->trip_counts.push_back(this->batch_num_trips);
+        this->batch_travel_time = 0.0;
+        this->batch_num_trips = 0;
+    }
+
+    if (step % RUN_LENGTH_CHECK_INTERVAL != 0) {
+        return false;
+    }
+
+    // The end of the road decides and tells the other processes
+    int stop = 0;
+    if (this->rank == this->root) {
+        double mean;
+        double half_width;
+        if (this->detectWarmup(&mean, &half_width) >= 0 && half_width <= this->target_precision * mean) {
+            stop = 1;
+        }
+    }
+    this->transport->broadcast(&stop, sizeof(int), this->root);
+
+    return stop != 0;
+}
+
+/**
+ * Reports the detected warm-up and the mean travel time with its confidence interval on rank 0, collective over all
+ * the processes
+ * @param step the last step of the simulation
+ * @param rank the rank of the process
+ * @param quiet true to only agree on the mean travel time without reporting it, false otherwise
+ */
+void RunLength::finish(int step, int rank, bool quiet) {
+    if (!this->isEnabled()) {
+        return;
+    }
+
+    // Results of the end of the road: warm-up batches, mean travel time and half-width
+    double results[3] = {-1.0, 0.0, 0.0};
+    if (this->rank == this->root) {
+        results[0] = this->detectWarmup(&results[1], &results[2]);
+    }
+    this->transport->broadcast(results, sizeof(results), this->root);
+    this->mean_travel_time = results[1];
+
+    if (rank == 0 && !quiet) {
+        const bool converged = results[0] >= 0 && results[2] <= this->target_precision * results[1];
+        std::cout << "--- Adaptive Run Length ---" << std::endl;
+        if (results[0] >= 0) {
+            std::cout << "Warm-up detected by MSER-5: " << (int) results[0] * RUN_LENGTH_BATCH_STEPS << " [steps]"
+                      << std::endl;
+        } else {
+            std::cout << "Warm-up detected by MSER-5: not yet over" << std::endl;
+        }
+        if (results[0] < 0) {
+            std::cout << "Mean travel time: " << results[1] << " [s] (after the warm-up time of the inputs)"
+                      << std::endl;
+        } else if (std::isfinite(results[2])) {
+            std::cout << "Mean travel time: " << results[1] << " +/- " << results[2] << " [s] (95% confidence, "
+                      << RUN_LENGTH_NUM_CI_BATCHES << " batch means)" << std::endl;
+        } else {
+            std::cout << "Mean travel time: " << results[1] << " [s] (too few batches for a confidence interval)"
+                      << std::endl;
+        }
+        std::cout << "Steps simulated: " << step << " [steps] ("
+                  << (converged ? "reached the target precision" : "stopped at the maximum time") << ")" << std::endl;
+    }
+}
+
+/**
+ * Gets the mean travel time that the run reported, after the detected warm-up, or after the warm-up time of the
+ * inputs if the transient was not over by the end of the run
+ * @return the mean travel time, on every process once the run has finished
+ */
+double RunLength::getMeanTravelTime() const {
+    return this->mean_travel_time;
+}
+
+/**
+ * Adds the storage of the batch series to a MemoryReport
+ * @param report the MemoryReport
+ */
+void RunLength::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_STATISTICS, this->travel_time_sums);
+    report->addVector(MEMORY_STATISTICS, this->trip_counts);
+    report->addVector(MEMORY_STATISTICS, this->series);
+    report->addVector(MEMORY_STATISTICS, this->series_batches);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_RUNLENGTH_H
+#define CA_TRAFFIC_SIMULATION_RUNLENGTH_H
+
+#include <vector>
+
+#include "Inputs.h"
+#include "Transport.h"
+#include "MemoryReport.h"
+
+/**
+ * Class for the adaptive run length of the simulation. The process at the end of the road collects the travel times
+ * and the number of Vehicles that leave the road in batches of steps. The end of the initial transient is detected
+ * with the MSER-5 rule on both the travel time and the flow series, and the simulation stops once the 95% confidence
+ * interval of the mean travel time after the transient, from batch means, is narrower than the target precision.
+ * The mean travel time of an adaptive run is taken after the detected transient instead of the warm-up time of the
+ * inputs, which only serves as the fallback when the transient is not over by the end of the run.
+ * The stop decision is broadcast from the end of the road at a fixed step interval, so the processes agree on it with
+ * one small collective per interval.
+ */
+class RunLength {
+private:
+    Transport* transport;
+    double target_precision;
+    double step_size;
+    int rank;
+    int root;
+    double batch_travel_time;
+    int batch_num_trips;
+    int input_warmup_batches;
+    double mean_travel_time;
+    std::vector<double> travel_time_sums;
+    std::vector<int> trip_counts;
+    std::vector<double> series;
+    std::vector<int> series_batches;
+    double getBatchesMean(int first_batch);
+    int detectWarmup(double* mean, double* half_width);
+public:
+    RunLength(Transport* transport, const Inputs& inputs, int rank, int size);
+    bool isEnabled();
+    void addTrip(double travel_time);
+    bool endStep(int step);
+    void finish(int step, int rank, bool quiet);
+    double getMeanTravelTime() const;
+    void addMemory(MemoryReport* report) const;
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_RUNLENGTH_H
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Placement.h"
+#include "ProfilingTransport.h"
+#include "ScalingStudy.h"
+#include "ThreadTransport.h"
+
+/**
+ * Constructor of the ScalingStudy
+ * @param weak true to grow the length of the road with the number of ranks, false to keep it fixed
+ * @param rank_counts the numbers of ranks to run the simulation with
+ * @param pin_policy placement policy of the threads, empty to leave them unpinned
+ */
+ScalingStudy::ScalingStudy(bool weak, const std::vector<int>& rank_counts, const std::string& pin_policy) {
+    this->weak = weak;
+    this->rank_counts = rank_counts;
+    this->pin_policy = pin_policy;
+}
+
+/**
+ * Runs the simulation at every rank count of the study and reports the results
+ * @param body function that runs the simulation on one rank
+ * @return 0 if successful, nonzero otherwise
+ */
+int ScalingStudy::run(const ScalingBody& body) {
+    // Read the inputs of the scenario once for all the runs
+    if (this->inputs.loadFromFile() != 0) {
+        return 1;
+    }
+    if (this->inputs.paired_replications > 0 || this->inputs.engine == ENGINE_REPLICAS) {
+        std::cout << "error: scaling studies need an engine that divides the road into segments!" << std::endl;
+        return 1;
+    }
+
+    this->lengths.clear();
+    this->samples.clear();
+    for (int num_ranks : this->rank_counts) {
+        // Grow the road with the number of ranks in a weak scaling study
+        Inputs run_inputs = this->inputs;
+        if (this->weak) {
+            run_inputs.length = (int) ((int64_t) this->inputs.length * num_ranks / this->rank_counts[0]);
+        }
+
+        std::vector<int> cpus;
+        if (!this->pin_policy.empty() && Placement::planCpus(this->pin_policy, num_ranks, &cpus) != 0) {
+            return 1;
+        }
+        Placement::setPolicy(this->pin_policy, num_ranks);
+
+        // Run the simulation with every rank timed and counted through a ProfilingTransport
+        std::vector<ScalingSample> run_samples(num_ranks);
+        int status = ThreadTransport::run(num_ranks, cpus, [&](Transport* transport) {
+            ProfilingTransport profiling_transport(transport);
+            ScalingSample& sample = run_samples[transport->getRank()];
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            int rank_status = body(&profiling_transport, &run_inputs, &sample.mean_vehicles);
+            sample.run_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            sample.wait_time = profiling_transport.getWaitTime();
+            sample.num_messages = profiling_transport.getNumMessages();
+            sample.num_bytes_sent = profiling_transport.getNumBytesSent();
+            sample.num_collectives = profiling_transport.getNumCollectives();
+            return rank_status;
+        });
+        if (status != 0) {
+            return status;
+        }
+
+        this->lengths.push_back(run_inputs.length);
+        this->samples.push_back(run_samples);
+    }
+
+    this->printTables();
+    return this->writeSamples("cats-scaling.dat");
+}
+
+/**
+ * Gets the run time of a run, which is the run time of its slowest rank
+ * @param run the index of the run
+ * @return the run time in seconds
+ */
+double ScalingStudy::getRunTime(int run) {
+    double run_time = 0.0;
+    for (const ScalingSample& sample : this->samples[run]) {
+        run_time = std::max(run_time, sample.run_time);
+    }
+    return run_time;
+}
+
+/**
+ * Prints the parallel efficiency and the load imbalance of every run. The speedup and the efficiency are relative to
+ * the first run: in a strong scaling study the ideal run time falls in proportion to the number of ranks, and in a
+ * weak scaling study it stays the same. The imbalance is how much longer the busiest rank computes than the mean.
+ */
+void ScalingStudy::printTables() {
+    const double base_time = this->getRunTime(0);
+    const int base_ranks = this->rank_counts[0];
+
+    std::cout << "--- Scaling Study (" << (this->weak ? "weak" : "strong") << " scaling) ---" << std::endl;
+    std::cout << std::setw(8) << "ranks" << std::setw(12) << "length" << std::setw(12) << "time [s]" << std::setw(10)
+              << "speedup" << std::setw(12) << "efficiency" << std::endl;
+    for (int run = 0; run < (int) this->samples.size(); run++) {
+        const int num_ranks = this->rank_counts[run];
+        const double run_time = this->getRunTime(run);
+        const double speedup = base_time / run_time;
+        const double efficiency = this->weak ? speedup : speedup * base_ranks / num_ranks;
+        std::cout << std::fixed << std::setw(8) << num_ranks << std::setw(12) << this->lengths[run]
+                  << std::setw(12) << std::setprecision(3) << run_time << std::setw(10) << std::setprecision(2)
+                  << speedup << std::setw(11) << std::setprecision(1) << 100.0 * efficiency << "%" << std::endl;
+    }
+
+    std::cout << "--- Load Imbalance ---" << std::endl;
+    std::cout << std::setw(8) << "ranks" << std::setw(22) << "compute mean/max [s]" << std::setw(20)
+              << "wait mean/max [s]" << std::setw(11) << "imbalance" << std::setw(20) << "vehicles mean/max"
+              << std::setw(14) << "msgs/rank" << std::endl;
+    for (int run = 0; run < (int) this->samples.size(); run++) {
+        const int num_ranks = this->rank_counts[run];
+        double compute_sum = 0.0, compute_max = 0.0, wait_sum = 0.0, wait_max = 0.0;
+        double vehicles_sum = 0.0, vehicles_max = 0.0;
+        int64_t messages_sum = 0;
+        for (const ScalingSample& sample : this->samples[run]) {
+            const double compute_time = sample.run_time - sample.wait_time;
+            compute_sum += compute_time;
+            compute_max = std::max(compute_max, compute_time);
+            wait_sum += sample.wait_time;
+            wait_max = std::max(wait_max, sample.wait_time);
+            vehicles_sum += sample.mean_vehicles;
+            vehicles_max = std::max(vehicles_max, sample.mean_vehicles);
+            messages_sum += sample.num_messages;
+        }
+        const double compute_mean = compute_sum / num_ranks;
+        const double imbalance = (compute_mean > 0.0) ? compute_max / compute_mean - 1.0 : 0.0;
+        std::cout << std::fixed << std::setw(8) << num_ranks << std::setprecision(3) << std::setw(11) << compute_mean
+                  << std::setw(11) << compute_max << std::setw(10) << wait_sum / num_ranks << std::setw(10)
+                  << wait_max << std::setprecision(1) << std::setw(10) << 100.0 * imbalance << "%" << std::setw(10)
+                  << vehicles_sum / num_ranks << std::setw(10) << vehicles_max << std::setw(14)
+                  << messages_sum / num_ranks << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+/**
+ * Writes the measurements of every rank of every run to a comma delimited text file, one line per rank with the
+ * number of ranks, the length of the road, the rank, its run, compute and wait times, the number of messages and
+ * bytes it sent, the number of collectives and its mean number of Vehicles
+ * @param file_name path and name of the file to write
+ * @return 0 if successful, nonzero otherwise
+ */
+int ScalingStudy::writeSamples(std::string file_name) {
+    std::ofstream file(file_name);
+    if (!file) {
+        std::cout << "error: failure to open \"" << file_name << "\" file!" << std::endl;
+        return 1;
+    }
+
+    for (int run = 0; run < (int) this->samples.size(); run++) {
+        for (int rank = 0; rank < (int) this->samples[run].size(); rank++) {
+            const ScalingSample& sample = this->samples[run][rank];
+            file << this->rank_counts[run] << "," << this->lengths[run] << "," << rank << "," << sample.run_time << ","
+                 << sample.run_time - sample.wait_time << "," << sample.wait_time << "," << sample.num_messages << ","
+                 << sample.num_bytes_sent << "," << sample.num_collectives << "," << sample.mean_vehicles
+                 << std::endl;
+        }
+    }
+
+    // Close the file
+    file.close();
+
+    // Return with no errors
+    return 0;
+}
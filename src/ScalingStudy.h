@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_SCALINGSTUDY_H
+#define CA_TRAFFIC_SIMULATION_SCALINGSTUDY_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Inputs.h"
+#include "Transport.h"
+
+/**
+ * Measurements of one rank in one run of a scaling study
+ */
+struct ScalingSample {
+    double run_time;
+    double wait_time;
+    int64_t num_messages;
+    int64_t num_bytes_sent;
+    int64_t num_collectives;
+    double mean_vehicles;
+};
+
+// Function that runs the simulation on one rank with the given inputs, storing the mean number of Vehicles of the rank
+typedef std::function<int(Transport*, const Inputs*, double*)> ScalingBody;
+
+/**
+ * Class for a scaling study, which runs the simulation in threads of this process at each of a list of rank counts.
+ * In a strong scaling study the road keeps its length, and in a weak scaling study the length grows with the number
+ * of ranks so that every rank keeps a segment of the same length. Every rank of every run is timed through a
+ * ProfilingTransport, and the parallel efficiency and the load imbalance of the runs are reported as tables.
+ */
+class ScalingStudy {
+private:
+    Inputs inputs;
+    bool weak;
+    std::vector<int> rank_counts;
+    std::string pin_policy;
+    std::vector<int> lengths;
+    std::vector<std::vector<ScalingSample>> samples;
+    double getRunTime(int run);
+    void printTables();
+    int writeSamples(std::string file_name);
+public:
+    ScalingStudy(bool weak, const std::vector<int>& rank_counts, const std::string& pin_policy);
+    int run(const ScalingBody& body);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_SCALINGSTUDY_H
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Scenario.h"
+
+// Magic bytes at the start of the binary scenario file
+const char SCENARIO_FILE_MAGIC[8] = {'C', 'A', 'T', 'S', 'S', 'C', 'E', 'N'};
+
+/**
+ * Constructor of the Scenario, with no zones, no Vehicles and no mapped file
+ */
+Scenario::Scenario() {
+    this->mapping = nullptr;
+    this->mapping_size = 0;
+    this->header = nullptr;
+    this->sites = nullptr;
+}
+
+/**
+ * Destructor of the Scenario, which unmaps the binary scenario file
+ */
+Scenario::~Scenario() {
+    if (this->mapping != nullptr) {
+        munmap(this->mapping, this->mapping_size);
+    }
+}
+
+/**
+ * Reads the zones of the road from a comma delimited text file where each line holds the lane (-1 for every lane),
+ * the first and last site, the speed limit and whether the sites are closed (0 or 1). A line starting with 'v' is
+ * instead a Vehicle on the road at the start of the run, with its lane, site and speed. Empty lines and lines starting
+ * with '#' are skipped. Nothing is read unless the text scenario is enabled in the inputs, but the maximum speed is
+ * always checked, since every engine keeps the speed limits of the sites in bytes whether or not there is a scenario.
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param file_name path and name of the file to read
+ * @return 0 if successful, nonzero otherwise
+ */
+int Scenario::read_scenario(const Inputs& inputs, std::string file_name) {
+    this->zones.clear();
+    this->vehicles.clear();
+    if (inputs.max_speed < 1 || inputs.max_speed > SCENARIO_MAX_SPEED) {
+        std::cout << "error: the maximum speed must be between 1 and " << SCENARIO_MAX_SPEED << "!" << std::endl;
+        return 1;
+    }
+    if (inputs.use_scenario != SCENARIO_TEXT) {
+        return 0;
+    }
+
+    // Open the file containing the zones
+    std::ifstream file(file_name);
+
+    // Check if the scenario file was loaded properly
+    if (!file) {
+        std::cout << "error: failure to open " << file_name << " file!" << std::endl;
+        return 1;
+    }
+
+    // Read each line into a zone
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        if (line[0] == 'v') {
+            ScenarioVehicle vehicle;
+            char comma;
+            std::istringstream fields(line.substr(1));
+            fields >> comma >> vehicle.lane >> comma >> vehicle.site >> comma >> vehicle.speed;
+            if (!fields || vehicle.lane < 0 || vehicle.lane >= inputs.num_lanes || vehicle.site < 0 ||
+                vehicle.site >= inputs.length || vehicle.speed < 0 || vehicle.speed > inputs.max_speed) {
+                std::cout << "error: invalid vehicle on line " << line_number << " of " << file_name << "!"
+                          << std::endl;
+                return 1;
+            }
+            this->vehicles.push_back(vehicle);
+            continue;
+        }
+
+        ScenarioZone zone;
+        char comma;
+        std::istringstream fields(line);
+        fields >> zone.lane >> comma >> zone.first_site >> comma >> zone.last_site >> comma >> zone.max_speed >> comma
+               >> zone.closed;
+        if (!fields || zone.lane < SCENARIO_ALL_LANES || zone.lane >= inputs.num_lanes || zone.first_site < 0 ||
+            zone.last_site < zone.first_site || zone.max_speed < 1) {
+            std::cout << "error: invalid zone on line " << line_number << " of " << file_name << "!" << std::endl;
+            return 1;
+        }
+        zone.max_speed = std::min(zone.max_speed, inputs.max_speed);
+        this->zones.push_back(zone);
+    }
+
+    // Close the file
+    file.close();
+
+    // Check that the Vehicles are on open sites and that no two Vehicles share a site
+    std::vector<ScenarioVehicle> sorted = this->vehicles;
+    std::sort(sorted.begin(), sorted.end(), [](const ScenarioVehicle& a, const ScenarioVehicle& b) {
+        return a.lane < b.lane || (a.lane == b.lane && a.site < b.site);
+    });
+    for (int v = 0; v < (int) sorted.size(); v++) {
+        bool closed = false;
+        for (const ScenarioZone& zone : this->zones) {
+            if ((zone.lane == SCENARIO_ALL_LANES || zone.lane == sorted[v].lane) && zone.first_site <= sorted[v].site
+                && sorted[v].site <= zone.last_site) {
+                closed = zone.closed != 0;
+            }
+        }
+        if (closed || (v > 0 && sorted[v].lane == sorted[v - 1].lane && sorted[v].site == sorted[v - 1].site)) {
+            std::cout << "error: vehicle in lane " << sorted[v].lane << " at site " << sorted[v].site << " of "
+                      << file_name << " is on a closed or taken site!" << std::endl;
+            return 1;
+        }
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Maps the binary scenario file into memory. Only the header is read here, and the sites are paged in when a process
+ * expands its segment, so the startup of a process does not grow with the length of the road. Nothing is mapped
+ * unless the binary scenario is enabled in the inputs.
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param file_name path and name of the file to map
+ * @return 0 if successful, nonzero otherwise
+ */
+int Scenario::map_scenario(const Inputs& inputs, std::string file_name) {
+    if (inputs.use_scenario != SCENARIO_BINARY) {
+        return 0;
+    }
+
+    // Open the file and map it whole
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "error: failure to open " << file_name << " file!" << std::endl;
+        return 1;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t) sizeof(ScenarioFileHeader)) {
+        std::cout << "error: " << file_name << " is not a binary scenario file!" << std::endl;
+        close(fd);
+        return 1;
+    }
+    this->mapping_size = file_stat.st_size;
+    this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (this->mapping == MAP_FAILED) {
+        this->mapping = nullptr;
+        std::cout << "error: failure to map " << file_name << " file!" << std::endl;
+        return 1;
+    }
+    this->header = static_cast<const ScenarioFileHeader*>(this->mapping);
+    this->sites = reinterpret_cast<const ScenarioSite*>(this->header + 1);
+
+    // Check that the file was built for the road and maximum speed of the inputs
+    const size_t expected_size = sizeof(ScenarioFileHeader)
+                                 + (size_t) inputs.num_lanes * inputs.length * sizeof(ScenarioSite);
+    if (std::memcmp(this->header->magic, SCENARIO_FILE_MAGIC, sizeof(SCENARIO_FILE_MAGIC)) != 0 ||
+        this->header->version != SCENARIO_FILE_VERSION || this->header->num_lanes != inputs.num_lanes ||
+        this->header->length != inputs.length || this->header->max_speed != inputs.max_speed ||
+        this->mapping_size != expected_size) {
+        std::cout << "error: " << file_name << " does not match the lanes, length and maximum speed of the inputs!"
+                  << std::endl;
+        return 1;
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Writes the zones and Vehicles read from the text file as a binary scenario file, with the speed limits of every
+ * site already lowered ahead of slower sites
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param file_name path and name of the file to write
+ * @return 0 if successful, nonzero otherwise
+ */
+int Scenario::write_binary(const Inputs& inputs, std::string file_name) const {
+    std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "error: failure to open " << file_name << " file!" << std::endl;
+        return 1;
+    }
+
+    ScenarioFileHeader file_header;
+    std::memcpy(file_header.magic, SCENARIO_FILE_MAGIC, sizeof(SCENARIO_FILE_MAGIC));
+    file_header.version = SCENARIO_FILE_VERSION;
+    file_header.num_lanes = inputs.num_lanes;
+    file_header.length = inputs.length;
+    file_header.max_speed = inputs.max_speed;
+    file_header.num_vehicles = this->vehicles.size();
+    file.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+
+    // Expand each Lane over the whole road and write its sites
+    std::vector<uint8_t> speed_limits(inputs.length);
+    std::vector<uint8_t> closed(inputs.length);
+    std::vector<uint8_t> speeds(inputs.length);
+    std::vector<ScenarioSite> lane_sites(inputs.length);
+    for (int lane = 0; lane < inputs.num_lanes; lane++) {
+        this->fillLane(inputs, lane, 0, inputs.length, speed_limits.data(), closed.data());
+        this->fillInitialSpeeds(inputs, lane, 0, inputs.length, speeds.data());
+        for (int i = 0; i < inputs.length; i++) {
+            lane_sites[i] = ScenarioSite{speed_limits[i], closed[i], speeds[i], 0};
+        }
+        file.write(reinterpret_cast<const char*>(lane_sites.data()), lane_sites.size() * sizeof(ScenarioSite));
+    }
+
+    if (!file) {
+        std::cout << "error: failure to write " << file_name << " file!" << std::endl;
+        return 1;
+    }
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Checks whether any Vehicles are on the road at the start of the run
+ * @return true if the scenario places Vehicles on the road, false otherwise
+ */
+bool Scenario::hasInitialVehicles() const {
+    return (this->header != nullptr) ? this->header->num_vehicles > 0 : !this->vehicles.empty();
+}
+
+/**
+ * Expands the zones of a Lane, or copies the sites of the mapped file, into its per-site arrays for a segment of the
+ * road. The speed limit of a site is the highest speed at which a Vehicle in the site passes no site with a lower
+ * limit, so a Vehicle brakes before it enters a zone instead of inside it. Later zones in the file override earlier
+ * ones.
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param lane the number of the Lane
+ * @param start_site the first site of the segment on the road
+ * @param num_sites the number of sites in the segment
+ * @param speed_limits array of the speed limit of each site of the segment
+ * @param closed array of whether each site of the segment is closed (0 or 1)
+ */
+void Scenario::fillLane(const Inputs& inputs, int lane, int start_site, int num_sites, uint8_t* speed_limits,
+                        uint8_t* closed) const {
+    // Copy the sites of the segment from the mapped file, where the sites off the road have no limit
+    if (this->sites != nullptr) {
+        const ScenarioSite* lane_sites = this->sites + (size_t) lane * inputs.length;
+        for (int i = 0; i < num_sites; i++) {
+            const int site = start_site + i;
+            const bool on_road = site >= 0 && site < inputs.length;
+            speed_limits[i] = on_road ? lane_sites[site].speed_limit : inputs.max_speed;
+            closed[i] = on_road ? lane_sites[site].closed : 0;
+        }
+        return;
+    }
+
+    // Posted limits of the segment and of the sites ahead of it that a Vehicle can reach in one step
+    std::vector<int> posted(num_sites + inputs.max_speed + 1, inputs.max_speed);
+    std::fill(closed, closed + num_sites, 0);
+    for (const ScenarioZone& zone : this->zones) {
+        if (zone.lane != SCENARIO_ALL_LANES && zone.lane != lane) {
+            continue;
+        }
+        int first = std::max(zone.first_site - start_site, 0);
+        int last = std::min(zone.last_site - start_site, (int) posted.size() - 1);
+        for (int i = first; i <= last; i++) {
+            posted[i] = zone.max_speed;
+            if (i < num_sites) {
+                closed[i] = zone.closed != 0;
+            }
+        }
+    }
+
+    // Lower each limit until no site within reach at that speed has a lower posted limit
+    for (int i = 0; i < num_sites; i++) {
+        int limit = posted[i];
+        for (int k = 1; k <= limit; k++) {
+            limit = std::min(limit, posted[i + k]);
+        }
+        speed_limits[i] = limit;
+    }
+}
+
+/**
+ * Expands the Vehicles of a Lane that are on the road at the start of the run into a per-site array for a segment
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param lane the number of the Lane
+ * @param start_site the first site of the segment on the road
+ * @param num_sites the number of sites in the segment
+ * @param speeds array of the initial speed of the Vehicle in each site, or SCENARIO_NO_VEHICLE if it is empty
+ */
+void Scenario::fillInitialSpeeds(const Inputs& inputs, int lane, int start_site, int num_sites, uint8_t* speeds) const {
+    if (this->sites != nullptr) {
+        const ScenarioSite* lane_sites = this->sites + (size_t) lane * inputs.length;
+        for (int i = 0; i < num_sites; i++) {
+            const int site = start_site + i;
+            speeds[i] = (site >= 0 && site < inputs.length) ? lane_sites[site].initial_speed : SCENARIO_NO_VEHICLE;
+        }
+        return;
+    }
+
+    std::fill(speeds, speeds + num_sites, SCENARIO_NO_VEHICLE);
+    for (const ScenarioVehicle& vehicle : this->vehicles) {
+        if (vehicle.lane == lane && vehicle.site >= start_site && vehicle.site < start_site + num_sites) {
+            speeds[vehicle.site - start_site] = vehicle.speed;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_SCENARIO_H
+#define CA_TRAFFIC_SIMULATION_SCENARIO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Inputs.h"
+
+// Lane number of a zone that applies to every Lane of the road
+const int SCENARIO_ALL_LANES = -1;
+
+// Values of the scenario input, for the text file of zones and for the memory-mapped binary file of sites
+const int SCENARIO_TEXT = 1;
+const int SCENARIO_BINARY = 2;
+
+// Initial speed of a site that holds no Vehicle at the start of the run
+const uint8_t SCENARIO_NO_VEHICLE = 255;
+
+// Highest maximum speed that the speed limits and initial speeds of the sites can hold, which are stored in a byte
+const int SCENARIO_MAX_SPEED = SCENARIO_NO_VEHICLE - 1;
+
+// Version of the layout of the binary scenario file
+const int32_t SCENARIO_FILE_VERSION = 1;
+
+/**
+ * Range of sites of the road with a speed limit, or that is closed to traffic
+ */
+struct ScenarioZone {
+    int lane;
+    int first_site;
+    int last_site;
+    int max_speed;
+    int closed;
+};
+
+/**
+ * Vehicle that is on the road at the start of the run
+ */
+struct ScenarioVehicle {
+    int lane;
+    int site;
+    int speed;
+};
+
+/**
+ * Header of the binary scenario file, which is followed by one ScenarioSite per site of the road, Lane after Lane
+ */
+struct ScenarioFileHeader {
+    char magic[8];
+    int32_t version;
+    int32_t num_lanes;
+    int64_t length;
+    int32_t max_speed;
+    int32_t num_vehicles;
+};
+
+static_assert(sizeof(ScenarioFileHeader) == 32, "ScenarioFileHeader must have the documented 32 byte layout");
+
+/**
+ * Attributes of a site in the binary scenario file, with the speed limit already lowered ahead of slower sites
+ */
+struct ScenarioSite {
+    uint8_t speed_limit;
+    uint8_t closed;
+    uint8_t initial_speed;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(ScenarioSite) == 4, "ScenarioSite must have the documented 4 byte layout");
+
+/**
+ * Class for the per-site attributes of the road and the Vehicles on it at the start of the run. The attributes are
+ * either read as a list of zones from a comma delimited text file, which every process reads whole, or mapped from a
+ * binary file that holds every site of the road, of which each process only touches the pages of its own segment.
+ * Either way each process expands only the sites of its own segment into flat per-Lane arrays, so that the update
+ * rules can look the attributes up by site instead of testing for zones.
+ */
+class Scenario {
+private:
+    std::vector<ScenarioZone> zones;
+    std::vector<ScenarioVehicle> vehicles;
+    void* mapping;
+    size_t mapping_size;
+    const ScenarioFileHeader* header;
+    const ScenarioSite* sites;
+public:
+    Scenario();
+    ~Scenario();
+    int read_scenario(const Inputs& inputs, std::string file_name);
+    int map_scenario(const Inputs& inputs, std::string file_name);
+    int write_binary(const Inputs& inputs, std::string file_name) const;
+    bool hasInitialVehicles() const;
+    void fillLane(const Inputs& inputs, int lane, int start_site, int num_sites, uint8_t* speed_limits,
+                  uint8_t* closed) const;
+    void fillInitialSpeeds(const Inputs& inputs, int lane, int start_site, int num_sites, uint8_t* speeds) const;
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_SCENARIO_H
@@ -4,21 +4,34 @@
 
 #include <chrono>
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include "Road.h"
-#include <mpi.h>
 #include "Simulation.h"
 #include <fstream>
 #include <iostream>
 #include <unistd.h>
 
+#include "AllocationCounter.h"
+#include "Random.h"
+#include "Placement.h"
+#include "RuleSets.h"
 #include "Vehicle.h"
 
+// Number of values in the record of a Vehicle that is communicated to the next process, as doubles that hold the 64 bit
+// ids exactly up to 2^53
+const int VEHICLE_RECORD_SIZE = 17;
+
+// Number of Vehicles below which the scheduler does not split the gap updates and moves any further
+const int VEHICLE_TASK_GRAIN = 256;
+
 /**
  * Constructor for the Simulation
+ * @param transport the Transport to the other processes
  * @param inputs
  */
-Simulation::Simulation(Inputs inputs, int rank, int size) {
+Simulation::Simulation(Transport* transport, const Inputs& inputs, int rank, int size) {
+    this->transport = transport;
 
     // Calculate the section of the road for this process
     const int length_per_process = inputs.length / size;
@@ -27,16 +40,79 @@ Simulation::Simulation(Inputs inputs, int rank, int size) {
     this->end_site = (rank + 1) * length_per_process - 1;
 
     // Create the Road object for the simulation
-    this->road_ptr = new Road(inputs, start_site, end_site, rank);
-
-    // Initialize the first Vehicle id
-    this->next_id = 0;
+    this->road_ptr = new Road(transport, inputs, start_site, end_site, rank);
 
     // Obtain the simulation inputs
     this->inputs = inputs;
 
     // Initialize Statistic for travel time
     this->travel_time = new Statistic();
+
+    // Initialize the road-wide observables
+    this->observables = new Observables(transport, inputs, rank);
+
+    // Initialize the live telemetry
+    this->telemetry = new Telemetry(transport, inputs, rank, size);
+
+    // Open the hardware counters of the thread of this process, which counts only its own work
+    this->counters = new PerfCounters(inputs, inputs.num_workers, rank);
+
+    // Initialize the log of the completed trips
+    this->trip_log = new TripLog(transport, inputs);
+
+    // Initialize the space-time raster
+    this->raster = new SpaceTimeRaster(transport, inputs, rank, size);
+
+    // Initialize the trajectories of the probe Vehicles
+    this->probe_log = new ProbeLog(inputs, rank, size);
+
+    // Initialize the adaptive run length
+    this->run_length = new RunLength(transport, inputs, rank, size);
+
+    // Print the reports of the run unless it is told otherwise, and count the trips of every Vehicle
+    this->quiet = false;
+    this->skip_initial_trips = false;
+
+    // Start the workers that update the gaps and move the Vehicles of the segment, on the cores planned for them if
+    // the ranks are pinned
+    std::vector<int> worker_cpus;
+    if (Placement::planWorkerCpus(rank, inputs.num_workers, &worker_cpus) != 0) {
+        throw std::exception();
+    }
+    this->scheduler = new TaskScheduler(inputs.num_workers, worker_cpus);
+
+    // Reserve the storage used during each step up front so that the steps do not allocate. The segment can hold at
+    // most one Vehicle per site, at most max_speed Vehicles per Lane can leave it in a step, and no more Vehicles can
+    // leave the road after the warm-up than were spawned after the warm-up or were on the segment at the warm-up.
+    const int max_vehicles = inputs.num_lanes * length_per_process;
+    const int max_exits_per_step = inputs.num_lanes * inputs.max_speed;
+    this->vehicles.reserve(max_vehicles);
+    this->exited_vehicles.reserve(max_exits_per_step);
+    this->outgoing_vehicles.reserve(max_exits_per_step);
+    this->boundary_vehicles.reserve(max_vehicles);
+    this->lane_change_batch.resize(max_vehicles);
+    this->move_results.resize(max_vehicles);
+    this->send_buffer.reserve(1 + max_exits_per_step * VEHICLE_RECORD_SIZE);
+    this->recv_buffer.resize(1 + max_exits_per_step * VEHICLE_RECORD_SIZE);
+
+    // Fill the Vehicle pool of the thread up to the most Vehicles that the segment holds at once, which are the
+    // Vehicles on its sites and the ones that left it in the last step and are not deleted yet
+    Vehicle::reservePool(max_vehicles + max_exits_per_step);
+    this->transport->reserveMessages(this->send_buffer.capacity() * sizeof(double),
+                                     (rank < size - 1) ? rank + 1 : TRANSPORT_NO_RANK, 0);
+
+    // Collect the Vehicles that the scenario placed on the segment at the start of the run
+    for (Lane* lane : this->road_ptr->getLanes()) {
+        for (int site = 0; site < lane->getSize(); site++) {
+            if (lane->hasVehicleInSite(site)) {
+                this->vehicles.push_back(lane->getVehicleInSite(site));
+            }
+        }
+    }
+    if (rank == size - 1) {
+        this->travel_time->reserve(inputs.num_lanes * std::max(0, inputs.max_time - inputs.warmup_time)
+                                   + max_vehicles);
+    }
 }
 
 /**
@@ -50,171 +126,482 @@ Simulation::~Simulation() {
     for (int i = 0; i < (int) this->vehicles.size(); i++) {
         delete this->vehicles[i];
     }
+
+    // Delete the travel time Statistic, the observables, the telemetry, the counters, the trip log, the raster, the
+    // probe log, the run length and the scheduler
+    delete this->travel_time;
+    delete this->observables;
+    delete this->telemetry;
+    delete this->counters;
+    delete this->trip_log;
+    delete this->raster;
+    delete this->probe_log;
+    delete this->run_length;
+    delete this->scheduler;
 }
 
 /**
- * Executes the simulation in parallel using the specified number of threads
- * @param num_threads number of threads to run the simulation with
- * @return 0 if successful, nonzero otherwise
+ * Executes the steps of the simulation with the rules of a rule set
+ * @tparam RuleSet the rule set of the cellular automaton
+ * @param rank the rank of the process
+ * @param size the number of processes
  */
-int Simulation::run_simulation(int rank, int size) {
-
-    // Obtain the start time
-    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-
-    // Set the simulation time to zero
-    this->time = 0;
-
-    // Declare a vector for vehicles to be removed each step
-    std::vector<int> vehicles_to_remove;
-
+template <class RuleSet>
+void Simulation::run_steps(int rank, int size) {
     while (this->time < this->inputs.max_time) {
 
+        if (this->time == this->inputs.warmup_time) {
+            this->warmup_allocations = this->count_allocations();
+        }
+
 #ifdef DEBUG
-        MPI_Barrier(MPI_COMM_WORLD);
+        this->transport->barrier();
 
         if (rank == 0) {
             std::cout << "road configuration at time " << time << ":" << std::endl;
         }
         this->road_ptr->printRoad(rank, size);
 
-        MPI_Barrier(MPI_COMM_WORLD);
+        this->transport->barrier();
 
         if (rank == 0) {
             std::cout << "performing lane switches..." << std::endl;
         }
 #endif
 
-        this->road_ptr->calculate_gaps_from_neighbor_processes(rank, size);
-
         // Perform the lane switch step for all vehicles
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
-            this->vehicles[n]->updateGaps(this->road_ptr, rank, size);
-#ifdef DEBUG
-            this->vehicles[n]->printGaps();
-#endif
+        this->begin_phase(TelemetryRing::PHASE_LANE_SWITCH);
+        this->update_gaps(rank, size, TelemetryRing::PHASE_LANE_SWITCH);
+
+        // Decide the lane changes in one batch, so that only the Vehicles with room to change draw a random number.
+        // The changes to the left go first, so that two Vehicles changing into the same site from both sides resolve
+        // the same way as in the lattice engine.
+        const int num_candidates = this->lane_change_batch.selectCandidates<RuleSet>(this->vehicles);
+        const int* candidates = this->lane_change_batch.getCandidates();
+        for (int c = 0; c < num_candidates; c++) {
+            if (this->vehicles[candidates[c]]->changesToLeft()) {
+                this->vehicles[candidates[c]]->performLaneSwitch<RuleSet>(this->road_ptr, rank, size);
+            }
         }
-
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
-            this->vehicles[n]->performLaneSwitch(this->road_ptr, rank, size);
+        for (int c = 0; c < num_candidates; c++) {
+            if (!this->vehicles[candidates[c]]->changesToLeft()) {
+                this->vehicles[candidates[c]]->performLaneSwitch<RuleSet>(this->road_ptr, rank, size);
+            }
         }
 
 #ifdef DEBUG
 
-        MPI_Barrier(MPI_COMM_WORLD);
+        this->transport->barrier();
 
         this->road_ptr->printRoad(rank, size);
         if (rank == 0) {
             std::cout << "performing lane movements..." << std::endl;
         }
 
-        MPI_Barrier(MPI_COMM_WORLD);
+        this->transport->barrier();
 
 #endif
 
-        // Recalculate gaps after lane switches
-        this->road_ptr->calculate_gaps_from_neighbor_processes(rank, size);
+        // Recalculate gaps after lane switches, and perform the independent lane updates
+        this->begin_phase(TelemetryRing::PHASE_LANE_MOVE);
+        this->update_gaps(rank, size, TelemetryRing::PHASE_LANE_MOVE);
+
+        // Move the vehicles on the workers. A Vehicle only moves into empty sites behind the old site of the Vehicle
+        // ahead, so the moves in a Lane do not depend on each other.
+        const int num_moved = this->vehicles.size();
+        const uint64_t run_seed = Random::run_seed;
+        auto move_body = [&](int begin, int end, int worker) {
+            Random::run_seed = run_seed;
+            for (int n = begin; n < end; n++) {
+                this->move_results[n] = this->vehicles[n]->performLaneMove<RuleSet>();
+            }
+        };
+        this->scheduler->parallelFor(num_moved, VEHICLE_TASK_GRAIN, move_body);
+
+        // Compact the vehicles that remain on the segment to the front of the list, sum the speeds for the
+        // observables, add the remaining vehicles to the space-time raster and record the probe vehicles that are
+        // still on the road, with the step that the move completes. This pass runs on the process thread after the
+        // workers have joined, since the probe ring has a single producer.
+        long speed_sum = 0;
+        int num_remaining = 0;
+        const bool render = this->raster->isEnabled();
+        for (int n = 0; n < num_moved; n++) {
+            Vehicle* vehicle = this->vehicles[n];
+            speed_sum += vehicle->getSpeed();
+            if (vehicle->isProbe()) {
+                this->probe_log->addVehicle(vehicle->getId(), this->time + 1, vehicle->getLane()->getLaneNumber(),
+                                            vehicle->getPosition(), vehicle->getSpeed());
+            }
+
+            // If the vehicle has exited the segment, set it aside for the boundary handling
+            if (this->move_results[n] == -1) {
+                this->exited_vehicles.push_back(vehicle);
+            } else {
+                this->vehicles[num_remaining++] = vehicle;
+                if (render) {
+                    this->raster->addVehicle(vehicle->getPosition(), vehicle->getSpeed());
+                }
+            }
+        }
+        this->vehicles.resize(num_remaining);
 
-        // Perform the independent lane updates
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
+        // End of iteration steps
+        // Increment time
+        this->time++;
+
+        // Start the reduction of the road-wide observables, which completes during the next step
+        this->observables->post(this->time, num_moved, speed_sum, rank);
+
+        // Hand the vehicles that left the segment over to the next process or remove them from the road
+        this->begin_phase(TelemetryRing::PHASE_BOUNDARY);
+        handle_boundary_vehicles(rank, size);
+
+        // Spawn new Vehicles while the vehicles that left the segments are in flight
+        this->begin_phase(TelemetryRing::PHASE_SPAWN);
+        if (rank == 0 )
+            this->road_ptr->attemptSpawn(this->inputs, &(this->vehicles), this->time);
+
+        // Place the vehicles that entered the segment from the previous process
+        this->begin_phase(TelemetryRing::PHASE_BOUNDARY);
+        finish_communicate_vehicles(rank, size);
+
+        // Start the reduction of the telemetry at the end of each publishing interval
+        this->telemetry->endStep(this->time, this->vehicles.size(), rank);
+        this->counters->endStep(this->vehicles.size());
+        this->vehicle_steps += this->vehicles.size();
+
+        // Write the buffered trip records at the end of each flush interval, and the raster at the end of each row
+        this->trip_log->endStep(this->time);
+        this->raster->endStep(this->time);
+
+        // Stop early once the travel time has converged to the target precision
+        if (this->run_length->endStep(this->time)) {
+            break;
+        }
+    }
+
+}
+
+/**
+ * Marks the start of a phase of the step for the telemetry and the hardware counters
+ * @param phase the phase that is starting
+ */
+void Simulation::begin_phase(int phase) {
+    this->telemetry->beginPhase(phase);
+    this->counters->beginPhase(phase);
+}
+
+/**
+ * Updates the gaps of all the Vehicles while the gaps at the ends of the segment are exchanged with the neighboring
+ * processes. Only the Vehicles whose gaps reach past the end of the segment need the received gaps, so the others are
+ * done before waiting for the exchange, and the few near the ends are updated again once it completes.
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @param phase the telemetry phase that the gap updates belong to
+ */
+void Simulation::update_gaps(int rank, int size, int phase) {
+    this->road_ptr->start_gap_exchange(rank, size);
+
+    // Update the gaps on the workers, since each Vehicle only reads the road and writes its own gaps
+    auto gaps_body = [&](int begin, int end, int worker) {
+        for (int n = begin; n < end; n++) {
             this->vehicles[n]->updateGaps(this->road_ptr, rank, size);
+        }
+    };
+    this->scheduler->parallelFor(this->vehicles.size(), VEHICLE_TASK_GRAIN, gaps_body);
+
+    this->boundary_vehicles.clear();
+    for (Vehicle* vehicle : this->vehicles) {
+        if (vehicle->dependsOnNeighbors()) {
+            this->boundary_vehicles.push_back(vehicle);
+        }
+    }
+
+    this->begin_phase(TelemetryRing::PHASE_GAP_EXCHANGE);
+    this->road_ptr->finish_gap_exchange(rank, size);
+    this->begin_phase(phase);
+
+    for (Vehicle* vehicle : this->boundary_vehicles) {
+        vehicle->updateGaps(this->road_ptr, rank, size);
+    }
 #ifdef DEBUG
-            this->vehicles[n]->printGaps();
+    for (Vehicle* vehicle : this->vehicles) {
+        vehicle->printGaps();
+    }
 #endif
-        }
+}
 
-        // Handle vehicles crossing boundaries
-        handle_boundary_vehicles(rank, size, start_site, end_site);
+/**
+ * Reports the memory of the segment of every process, collective over all the processes. The storage of the steps is
+ * reserved in the constructor, so the report differs between the start and the end of the run only by the Vehicles
+ * on the segment and by the samples of the statistics beyond the reserved ones.
+ * @param title the title of the report
+ * @param num_vehicles the number of Vehicles to charge the Vehicle state to, whose objects are counted as well
+ */
+void Simulation::report_memory(const std::string& title, int64_t num_vehicles) {
+    MemoryReport report((int64_t) this->inputs.num_lanes * (this->end_site - this->start_site + 1), num_vehicles);
+    this->road_ptr->addMemory(&report);
+    report.add(MEMORY_VEHICLES, num_vehicles * (int64_t) sizeof(Vehicle));
+    report.addVector(MEMORY_VEHICLES, this->vehicles);
+    report.addVector(MEMORY_VEHICLES, this->exited_vehicles);
+    report.addVector(MEMORY_VEHICLES, this->boundary_vehicles);
+    report.addVector(MEMORY_VEHICLES, this->move_results);
+    this->lane_change_batch.addMemory(&report);
+    this->travel_time->addMemory(&report);
+    this->run_length->addMemory(&report);
+    this->trip_log->addMemory(&report);
+    this->raster->addMemory(&report);
+    this->probe_log->addMemory(&report);
+    report.addVector(MEMORY_BUFFERS, this->outgoing_vehicles);
+    report.addVector(MEMORY_BUFFERS, this->send_buffer);
+    report.addVector(MEMORY_BUFFERS, this->recv_buffer);
+    report.print(this->transport, title);
+}
 
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
-            int move_result = this->vehicles[n]->performLaneMove();
+/**
+ * Counts the heap allocations made so far for the process, by the process thread itself, by the other workers of its
+ * scheduler and by the background writer of its probe records
+ * @return number of allocations, always zero if the counting hook is not compiled in
+ */
+long Simulation::count_allocations() {
+    return AllocationCounter::getCount() + this->scheduler->getAllocations() + this->probe_log->getAllocations();
+}
 
-            // If the vehicle has exited, mark it for transfer
-            if (move_result == -1) {
+/**
+ * Executes the simulation in parallel using the specified number of threads
+ * @param num_threads number of threads to run the simulation with
+ * @return 0 if successful, nonzero otherwise
+ */
+int Simulation::run_simulation(int rank, int size) {
 
-                vehicles_to_remove.push_back(n); // Mark for removal
-            }
-        }
+    // Obtain the start time
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-        // End of iteration steps
-        // Increment time
-        this->time++;
+    // Set the simulation time to zero
+    this->time = 0;
+    this->vehicle_steps = 0;
+    this->dropped_vehicles = 0;
 
-        // Remove finished vehicles
-        std::sort(vehicles_to_remove.begin(), vehicles_to_remove.end());
-        for (int i = vehicles_to_remove.size() - 1; i >= 0; i--) {
-            // Update travel time statistic if beyond warm-up period
-            if (this->time > this->inputs.warmup_time) {
-                this->travel_time->addValue(this->vehicles[vehicles_to_remove[i]]->getTravelTime(this->inputs));
-            }
+    // Number of heap allocations made before the steady-state steps after the warm-up period
+    this->warmup_allocations = this->count_allocations();
 
-            // Delete the Vehicle
-            delete this->vehicles[vehicles_to_remove[i]];
-            this->vehicles.erase(this->vehicles.begin() + vehicles_to_remove[i]);
+    // Report the memory that the segment needs when every site holds a Vehicle
+    if (!this->quiet) {
+        this->report_memory("projected at full occupancy", (int64_t) this->vehicles.capacity());
+    }
+
+    // Run the steps with the step loop compiled for the rule set of the simulation
+    bool known_rule_set = RuleSets::withRuleSet(this->inputs.rule_set, [&](auto rule_set) {
+        this->run_steps<decltype(rule_set)>(rank, size);
+    });
+    if (!known_rule_set) {
+        if (rank == 0) {
+            std::cout << "error: unknown rule set " << this->inputs.rule_set << "!" << std::endl;
         }
-        vehicles_to_remove.clear();
+        return 1;
+    }
 
-        // Spawn new Vehicles
-        if (rank == 0 )
-            this->road_ptr->attemptSpawn(this->inputs, &(this->vehicles), &(this->next_id));
+    // Count the heap allocations made during the steady-state steps
+    int64_t steady_state_allocations = this->count_allocations() - this->warmup_allocations;
+
+    // Complete the reductions of the observables and the telemetry of the last step, and report the hardware counters
+    this->observables->finish(rank);
+    this->telemetry->finish(rank);
+    this->counters->report(this->transport, rank);
+
+    // Write the trip records that are still buffered and the rows of the raster that are left
+    this->trip_log->flush();
+    this->raster->finish();
+
+    // Write the probe records that are left in the ring
+    this->probe_log->finish(this->transport, rank);
+
+    // Report the detected warm-up and the converged travel time of an adaptive run
+    this->run_length->finish(this->time, rank, this->quiet);
+
+    // Report the utilization of the workers and the memory that the segment holds at the end of the run
+    if (!this->quiet) {
+        if (this->inputs.num_workers > 1) {
+            this->scheduler->report(this->transport);
+        }
+        this->report_memory("actual at the end of the run", (int64_t) this->vehicles.size());
     }
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    this->transport->barrier();
 
     // Calculate the time elapsed for this process
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
     double time_elapsed = (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000000.0;
 
-    // Use MPI_Reduce to find the maximum time_elapsed across all processes
+    // Reduce to find the maximum time_elapsed across all processes
     double max_time_elapsed;
-    MPI_Reduce(&time_elapsed, &max_time_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    this->transport->reduce(&time_elapsed, &max_time_elapsed, 1, REDUCE_MAX, 0);
+
+    // Sum the steady-state allocations over all the processes so that every process agrees on the outcome, and the
+    // Vehicles dropped at the boundaries of the segments
+    int64_t total_steady_state_allocations;
+    this->transport->allReduce(&steady_state_allocations, &total_steady_state_allocations, 1, REDUCE_SUM);
+    int64_t total_dropped_vehicles;
+    this->transport->allReduce(&this->dropped_vehicles, &total_dropped_vehicles, 1, REDUCE_SUM);
 
-    if (rank == 0) {
+    if (rank == 0 && !this->quiet) {
         // Rank 0 will print the overall execution time
         std::cout << "--- Simulation Performance ---" << std::endl;
         std::cout << "Total computation time (max across all processes): " << max_time_elapsed << " [s]" << std::endl;
-        std::cout << "Average time per iteration: " << max_time_elapsed / inputs.max_time << " [s]" << std::endl;
-        std::cout << "Average iterating frequency: " << inputs.max_time / max_time_elapsed << " [iter/s]" << std::endl;
+        std::cout << "Average time per iteration: " << max_time_elapsed / this->time << " [s]" << std::endl;
+        std::cout << "Average iterating frequency: " << this->time / max_time_elapsed << " [iter/s]" << std::endl;
+        if (AllocationCounter::isEnabled()) {
+            std::cout << "Heap allocations after warm-up (sum across all processes): "
+                      << total_steady_state_allocations << std::endl;
+        }
+        std::cout << "Vehicles dropped at the segment boundaries (sum across all processes): " << total_dropped_vehicles
+                  << std::endl;
     }
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    this->transport->barrier();
+
+#ifndef DEBUG
+    // The steps of an optimized build must not allocate once the warm-up is over
+    if (AllocationCounter::isEnabled() && total_steady_state_allocations != 0) {
+        if (rank == 0) {
+            std::cout << "error: the simulation allocated heap memory during steady-state steps!" << std::endl;
+        }
+        return 1;
+    }
+#endif
+
     // Return with no errors
     return 0;
 }
 
 /**
- * Handles vehicles crossing the boundaries of the current segment
+ * Gets the mean number of Vehicles in the segment of this process over the steps of the run
+ * @return the mean number of Vehicles
+ */
+double Simulation::getMeanVehicles() {
+    return (this->time > 0) ? (double) this->vehicle_steps / this->time : 0.0;
+}
+
+/**
+ * Gets the mean travel time of the Vehicles that left the road after the warm-up period, collective over all the
+ * processes. An adaptive run uses the warm-up that it detected, as in its report.
+ * @param rank the rank of the process
+ * @param size the number of processes
+ * @return the mean travel time, from the process at the end of the road
+ */
+double Simulation::getMeanTravelTime(int rank, int size) {
+    if (this->run_length->isEnabled()) {
+        return this->run_length->getMeanTravelTime();
+    }
+
+    double mean_travel_time = 0.0;
+    if (rank == size - 1) {
+        mean_travel_time = this->travel_time->getAverage();
+    }
+    this->transport->broadcast(&mean_travel_time, sizeof(double), size - 1);
+    return mean_travel_time;
+}
+
+/**
+ * Gets the travel times of the Vehicles that left the road after the warm-up period
+ * @return pointer to the Statistic of the travel times, which only the process at the end of the road fills
  */
-void Simulation::handle_boundary_vehicles(int rank, int size, int start_pos, int end_pos) {
-    std::vector<Vehicle *> outgoing_vehicles;
-    for (auto it = vehicles.begin(); it != vehicles.end();) {
-        Vehicle *vehicle = *it;
-        int position = vehicle->getPosition();
+Statistic* Simulation::getTravelTime() {
+    return this->travel_time;
+}
+
+/**
+ * Sets whether the run prints its memory, worker, run length and performance reports. The runs of a calibration or a
+ * paired comparison are quiet, as they run side by side on the ranks or one after the other and would otherwise print
+ * over each other. The heap allocations are counted per
+ * thread, so the steady-state steps of a quiet run are still checked.
+ * @param quiet true to leave out the reports, false otherwise
+ */
+void Simulation::setQuiet(bool quiet) {
+    this->quiet = quiet;
+}
 
-        if (position + (rank * (inputs.length / size)) >= end_pos) {
+/**
+ * Places the Vehicles of a state of the road that the run starts from instead of an empty road, before the run. The
+ * Vehicles get negative ids that no spawn can take, and their trips are left out of the travel time, as they were
+ * partly made before the start of the run.
+ * @param warm_vehicles the Vehicles of the whole road, with the sites counted from the start of the road
+ */
+void Simulation::warm_start(const std::vector<ScenarioVehicle>& warm_vehicles) {
+    this->skip_initial_trips = true;
+    for (const ScenarioVehicle& warm_vehicle : warm_vehicles) {
+        if (warm_vehicle.site < this->start_site || warm_vehicle.site > this->end_site ||
+            warm_vehicle.lane < 0 || warm_vehicle.lane >= (int) this->road_ptr->getLanes().size()) {
+            continue;
+        }
+        Lane* lane = this->road_ptr->getLanes()[warm_vehicle.lane];
+        const int site = warm_vehicle.site - this->start_site;
+        if (lane->isSiteBlocked(site)) {
+            continue;
+        }
+        const int64_t id = -1 - ((int64_t) warm_vehicle.lane * this->inputs.length + warm_vehicle.site);
+        Vehicle* vehicle = new Vehicle(lane, id, site, this->inputs);
+        vehicle->setSpeed(std::min(warm_vehicle.speed, lane->getSpeedLimit(site)));
+        vehicle->setProbe(ProbeLog::isSampled(id, this->inputs.probe_fraction));
+        lane->addVehicle(site, vehicle);
+        this->vehicles.push_back(vehicle);
+    }
+}
 
-            outgoing_vehicles.push_back(vehicle);
+/**
+ * Gets the Vehicles on the segment of this process
+ * @param road_vehicles pointer to the list to add the Vehicles to, with the sites counted from the start of the road
+ */
+void Simulation::get_vehicles(std::vector<ScenarioVehicle>* road_vehicles) const {
+    for (Vehicle* vehicle : this->vehicles) {
+        road_vehicles->push_back(ScenarioVehicle{vehicle->getLane()->getLaneNumber(),
+                                                 this->start_site + vehicle->getPosition(), vehicle->getSpeed()});
+    }
+}
 
-            ++it;
+/**
+ * Handles the vehicles that left the segment of the current process during the last move. Vehicles are handed over
+ * to the next process, or removed from the road if this process holds the end of the road.
+ */
+void Simulation::handle_boundary_vehicles(int rank, int size) {
+    for (Vehicle* vehicle : this->exited_vehicles) {
+        if (rank < size - 1) {
+            this->outgoing_vehicles.push_back(vehicle);
         } else {
-            ++it;
+            // Update travel time statistic if beyond warm-up period, leaving out the Vehicles of a warm start
+            if (this->time > this->inputs.warmup_time && !(this->skip_initial_trips && vehicle->getId() < 0)) {
+                this->travel_time->addValue(vehicle->getTravelTime(this->inputs));
+            }
+
+            // Record the trip of the Vehicle
+            this->trip_log->addTrip(vehicle, this->time);
+            this->run_length->addTrip(vehicle->getTravelTime(this->inputs));
+
+            // Delete the Vehicle
+            delete vehicle;
         }
     }
+    this->exited_vehicles.clear();
 
-    communicate_vehicles(rank, size, outgoing_vehicles);
+    start_communicate_vehicles(rank, size);
 }
 
 
 
 /**
- * Communicates vehicles across boundaries using MPI
+ * Starts sending the vehicles that left the segment to the next process and receiving the vehicles that entered it
+ * from the previous process, as a single message with the number of vehicles followed by their records. At most
+ * max_speed vehicles per Lane cross a boundary in a step, so the receive buffer always fits the message.
  */
-void Simulation::communicate_vehicles(int rank, int size, std::vector<Vehicle *> &outgoing_vehicles) {
+void Simulation::start_communicate_vehicles(int rank, int size) {
 
-    std::vector<double> send_buffer;
-    for (Vehicle *vehicle : outgoing_vehicles) {
+    // Pack the outgoing vehicles, with the position relative to the start of the next segment, and delete them
+    this->send_buffer.clear();
+    send_buffer.push_back(this->outgoing_vehicles.size());
+    for (Vehicle *vehicle : this->outgoing_vehicles) {
         send_buffer.push_back(vehicle->getId());
-        send_buffer.push_back(0);
+        send_buffer.push_back(vehicle->getPosition() - vehicle->getLane()->getSize());
+        send_buffer.push_back(vehicle->getLane()->getLaneNumber());
         send_buffer.push_back(vehicle->getSpeed());
         send_buffer.push_back(vehicle->getMaxSpeed());
         send_buffer.push_back(vehicle->getGapForward());
@@ -226,53 +613,68 @@ void Simulation::communicate_vehicles(int rank, int size, std::vector<Vehicle *>
         send_buffer.push_back(vehicle->getProbSlowDown());
         send_buffer.push_back(vehicle->getProbChange());
         send_buffer.push_back(vehicle->getTimeOnRoad());
+        send_buffer.push_back(vehicle->getLaneChanges());
+        send_buffer.push_back(vehicle->getDistance());
+        send_buffer.push_back(vehicle->isProbe());
+        delete vehicle;
     }
+    this->outgoing_vehicles.clear();
 
-    int send_rank = (rank < size - 1) ? rank + 1 : MPI_PROC_NULL;
-    int recv_rank = (rank > 0) ? rank - 1 : MPI_PROC_NULL;
-
-    int send_size = send_buffer.size();
-    int recv_size = 0;
+    int send_rank = (rank < size - 1) ? rank + 1 : TRANSPORT_NO_RANK;
+    int recv_rank = (rank > 0) ? rank - 1 : TRANSPORT_NO_RANK;
 
-    MPI_Sendrecv(
-        &send_size, 1, MPI_INT, send_rank, 0,
-        &recv_size, 1, MPI_INT, recv_rank, 0,
-        MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    // Send and receive vehicle data, with no vehicles received unless a message arrives
+    this->recv_buffer[0] = 0;
+    this->vehicle_requests[0] = this->transport->startRecv(recv_buffer.data(), recv_buffer.size() * sizeof(double),
+                                                           recv_rank, 0);
+    this->vehicle_requests[1] = this->transport->startSend(send_buffer.data(), send_buffer.size() * sizeof(double),
+                                                           send_rank, 0);
+}
 
-    // Send and receive vehicle data
-    std::vector<double> recv_buffer(recv_size);
-    MPI_Sendrecv(
-        send_buffer.data(), send_size, MPI_DOUBLE, send_rank, 0,
-        recv_buffer.data(), recv_size, MPI_DOUBLE, recv_rank, 0,
-        MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+/**
+ * Completes the exchange of the vehicles with the neighboring processes and places the received vehicles in the
+ * segment
+ */
+void Simulation::finish_communicate_vehicles(int rank, int size) {
+    for (int request : this->vehicle_requests) {
+        this->transport->wait(request);
+    }
 
-    for (int i = 0; i < recv_size; i += 13) {
-        int id = (int)recv_buffer[i];
+    const int recv_size = 1 + (int) this->recv_buffer[0] * VEHICLE_RECORD_SIZE;
+    for (int i = 1; i < recv_size; i += VEHICLE_RECORD_SIZE) {
+        int64_t id = (int64_t)recv_buffer[i];
         int position = (int)recv_buffer[i + 1];
-        int speed = (int)recv_buffer[i + 2];
-        int max_speed = (int)recv_buffer[i + 3];
-        int gap_forward = (int)recv_buffer[i + 4];
-        int gap_other_forward = (int)recv_buffer[i + 5];
-        int gap_other_backward = (int)recv_buffer[i + 6];
-        int look_forward = (int)recv_buffer[i + 7];
-        int look_other_forward = (int)recv_buffer[i + 8];
-        int look_other_backward = (int)recv_buffer[i + 9];
-        double prob_slow_down = recv_buffer[i + 10];
-        double prob_change = recv_buffer[i + 11];
-        int time_on_road = (int)recv_buffer[i + 12];
-
+        int lane_number = (int)recv_buffer[i + 2];
+        int speed = (int)recv_buffer[i + 3];
+        int max_speed = (int)recv_buffer[i + 4];
+        int gap_forward = (int)recv_buffer[i + 5];
+        int gap_other_forward = (int)recv_buffer[i + 6];
+        int gap_other_backward = (int)recv_buffer[i + 7];
+        int look_forward = (int)recv_buffer[i + 8];
+        int look_other_forward = (int)recv_buffer[i + 9];
+        int look_other_backward = (int)recv_buffer[i + 10];
+        double prob_slow_down = recv_buffer[i + 11];
+        double prob_change = recv_buffer[i + 12];
+        int time_on_road = (int)recv_buffer[i + 13];
+        int lane_changes = (int)recv_buffer[i + 14];
+        long distance = (long)recv_buffer[i + 15];
+        bool probe = recv_buffer[i + 16] != 0.0;
+
+        // A Vehicle that does not fit on the segment is a bug of the sender, so debug builds stop on it and the other
+        // builds count it for the report of the run
+        Lane *lane = (lane_number >= 0 && lane_number < (int) this->road_ptr->getLanes().size()) ?
+                     this->road_ptr->getLanes()[lane_number] : nullptr;
         int local_position = position;
-        if (local_position < 0 || local_position >= (this->end_site - this->start_site)) {
-            continue;
-        }
-
-        int lane_number = (local_position < this->road_ptr->getLanes()[0]->getSize()) ? 0 : 1;
-        if (lane_number < 0 || lane_number >= (int) this->road_ptr->getLanes().size()) {
+        const bool fits = lane != nullptr && local_position >= 0 && local_position < lane->getSize() &&
+                          !lane->hasVehicleInSite(local_position);
+#ifdef DEBUG
+        assert(fits);
+#endif
+        if (!fits) {
+            this->dropped_vehicles++;
             continue;
         }
 
-        Lane *lane = this->road_ptr->getLanes()[lane_number];
-
         Vehicle *new_vehicle = new Vehicle(lane, id, local_position, this->inputs);
         new_vehicle->setSpeed(speed);
         new_vehicle->setMaxSpeed(max_speed);
@@ -285,16 +687,11 @@ void Simulation::communicate_vehicles(int rank, int size, std::vector<Vehicle *>
         new_vehicle->setProbSlowDown(prob_slow_down);
         new_vehicle->setProbChange(prob_change);
         new_vehicle->setTimeOnRoad(time_on_road);
+        new_vehicle->setLaneChanges(lane_changes);
+        new_vehicle->setDistance(distance);
+        new_vehicle->setProbe(probe);
 
         lane->addVehicle(local_position, new_vehicle);
         this->vehicles.push_back(new_vehicle);
     }
 }
-
-
-
-
-
-
-
-
@@ -5,31 +5,78 @@
 #ifndef CA_TRAFFIC_SIMULATION_SIMULATION_H
 #define CA_TRAFFIC_SIMULATION_SIMULATION_H
 
+#include <string>
 #include <vector>
 
 #include "Road.h"
+#include "LaneChangeBatch.h"
 #include "Inputs.h"
 #include "Statistic.h"
+#include "Observables.h"
+#include "PerfCounters.h"
+#include "Telemetry.h"
+#include "TripLog.h"
+#include "SpaceTimeRaster.h"
+#include "ProbeLog.h"
+#include "RunLength.h"
+#include "Transport.h"
+#include "TaskScheduler.h"
+#include "MemoryReport.h"
+#include "Scenario.h"
 
 /**
  * Class for the simulation. Has a method for running the simulation.
  */
 class Simulation {
 private:
+    Transport* transport;
     Road* road_ptr;
     int time;
     std::vector<Vehicle*> vehicles;
     Inputs inputs;
-    int next_id;
     Statistic* travel_time;
+    Observables* observables;
+    Telemetry* telemetry;
+    PerfCounters* counters;
+    TripLog* trip_log;
+    SpaceTimeRaster* raster;
+    ProbeLog* probe_log;
+    RunLength* run_length;
     int start_site;
     int end_site;
+    std::vector<Vehicle*> exited_vehicles;
+    std::vector<Vehicle*> outgoing_vehicles;
+    std::vector<Vehicle*> boundary_vehicles;
+    LaneChangeBatch lane_change_batch;
+    TaskScheduler* scheduler;
+    std::vector<int8_t> move_results;
+    std::vector<double> send_buffer;
+    std::vector<double> recv_buffer;
+    int vehicle_requests[2];
+    long warmup_allocations;
+    long vehicle_steps;
+    int64_t dropped_vehicles;
+    bool quiet;
+    bool skip_initial_trips;
+    template <class RuleSet>
+    void run_steps(int rank, int size);
+    void begin_phase(int phase);
+    void update_gaps(int rank, int size, int phase);
+    void report_memory(const std::string& title, int64_t num_vehicles);
+    long count_allocations();
 public:
-    Simulation(Inputs inputs, int rank, int size);
+    Simulation(Transport* transport, const Inputs& inputs, int rank, int size);
     ~Simulation();
     int run_simulation(int rank, int size);
-    void handle_boundary_vehicles(int rank, int size, int start_pos, int end_pos);
-    void communicate_vehicles(int rank, int size, std::vector<Vehicle *> &outgoing_vehicles);
+    double getMeanTravelTime(int rank, int size);
+    double getMeanVehicles();
+    Statistic* getTravelTime();
+    void setQuiet(bool quiet);
+    void warm_start(const std::vector<ScenarioVehicle>& warm_vehicles);
+    void get_vehicles(std::vector<ScenarioVehicle>* road_vehicles) const;
+    void handle_boundary_vehicles(int rank, int size);
+    void start_communicate_vehicles(int rank, int size);
+    void finish_communicate_vehicles(int rank, int size);
 
 };
 
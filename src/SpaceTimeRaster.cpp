@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "SpaceTimeRaster.h"
+
+// Tag of the messages with the sums of a column that straddles two segments
+const int TAG_RASTER_COLUMN = 10;
+
+// Gray level of a bin with no Vehicles
+const uint8_t RASTER_EMPTY = 255;
+
+/**
+ * Constructor for the SpaceTimeRaster, collective over all the processes, which opens the images and writes their
+ * headers
+ * @param transport the Transport used to write the images
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+SpaceTimeRaster::SpaceTimeRaster(Transport* transport, const Inputs& inputs, int rank, int size) {
+    this->transport = transport;
+    this->enabled = inputs.raster_width > 0 && inputs.raster_height > 0;
+    this->rank = rank;
+    this->size = size;
+    this->density_file = nullptr;
+    this->speed_file = nullptr;
+    this->row = 0;
+    this->row_steps = 0;
+    if (!this->enabled) {
+        return;
+    }
+
+    // Divide the road into whole columns of sites and the run into whole rows of steps
+    const int length_per_process = inputs.length / size;
+    this->num_lanes = inputs.num_lanes;
+    this->max_speed = inputs.max_speed;
+    this->road_length = (int64_t) length_per_process * size;
+    this->sites_per_pixel = (int) ((this->road_length + inputs.raster_width - 1) / inputs.raster_width);
+    this->steps_per_row = std::max(1, (inputs.max_time + inputs.raster_height - 1) / inputs.raster_height);
+    this->width = (int) ((this->road_length + this->sites_per_pixel - 1) / this->sites_per_pixel);
+    this->height = (inputs.max_time + this->steps_per_row - 1) / this->steps_per_row;
+    if (this->sites_per_pixel > length_per_process) {
+        if (rank == 0) {
+            std::cout << "error: the space-time raster must be at least as wide as the number of processes!"
+                      << std::endl;
+        }
+        throw std::exception();
+    }
+
+    // Locate the columns of the segment, of which the first may start on the previous segment and the last may end on
+    // the next one
+    this->start_site = rank * length_per_process;
+    const int end_site = this->start_site + length_per_process - 1;
+    this->first_column = this->start_site / this->sites_per_pixel;
+    this->num_columns = end_site / this->sites_per_pixel - this->first_column + 1;
+    this->shares_first_column = this->start_site % this->sites_per_pixel != 0;
+    this->shares_last_column = rank < size - 1 && (end_site + 1) % this->sites_per_pixel != 0;
+    this->occupied.assign(this->num_columns, 0);
+    this->speed_sums.assign(this->num_columns, 0);
+    this->density_row.assign(this->num_columns, RASTER_EMPTY);
+    this->speed_row.assign(this->num_columns, RASTER_EMPTY);
+
+    // Open the images and write their headers from rank 0
+    this->density_file = transport->openFile("cats-spacetime-density.pgm");
+    this->speed_file = transport->openFile("cats-spacetime-speed.pgm");
+    if (this->density_file == nullptr || this->speed_file == nullptr) {
+        std::cout << "error: failure to open \"cats-spacetime-density.pgm\" or \"cats-spacetime-speed.pgm\" file!"
+                  << std::endl;
+        throw std::exception();
+    }
+    const std::string header = "P5\n" + std::to_string(this->width) + " " + std::to_string(this->height) + "\n255\n";
+    this->header_size = header.size();
+    const int header_bytes = (rank == 0) ? (int) header.size() : 0;
+    this->density_file->writeAtAll(0, header.data(), header_bytes);
+    this->speed_file->writeAtAll(0, header.data(), header_bytes);
+
+    // Set up the channel of the shared columns before the steps, so that the exchanges of the steps do not allocate
+    this->exchangeSharedColumn();
+}
+
+/**
+ * Destructor for the SpaceTimeRaster
+ */
+SpaceTimeRaster::~SpaceTimeRaster() {
+    delete this->density_file;
+    delete this->speed_file;
+}
+
+/**
+ * Checks whether the space-time raster is rendered in the simulation
+ * @return true if the raster is rendered, false otherwise
+ */
+bool SpaceTimeRaster::isEnabled() const {
+    return this->enabled;
+}
+
+/**
+ * Sends the sums of the first column to the previous process if the column starts there, and adds the sums of the
+ * next process to the last column if it continues there. The sent column is cleared.
+ */
+void SpaceTimeRaster::exchangeSharedColumn() {
+    const int prev_rank = this->shares_first_column ? this->rank - 1 : TRANSPORT_NO_RANK;
+    const int next_rank = this->shares_last_column ? this->rank + 1 : TRANSPORT_NO_RANK;
+    int64_t send_sums[2] = {this->occupied[0], this->speed_sums[0]};
+    int64_t recv_sums[2] = {0, 0};
+    this->transport->sendRecv(send_sums, sizeof(send_sums), prev_rank, recv_sums, sizeof(recv_sums), next_rank,
+                              TAG_RASTER_COLUMN);
+    if (this->shares_first_column) {
+        this->occupied[0] = 0;
+        this->speed_sums[0] = 0;
+    }
+    if (this->shares_last_column) {
+        this->occupied[this->num_columns - 1] += recv_sums[0];
+        this->speed_sums[this->num_columns - 1] += recv_sums[1];
+    }
+}
+
+/**
+ * Writes the current row of both images, collective over all the processes, and starts the next row. The density of
+ * a bin is the fraction of its site-steps that held a Vehicle, drawn dark when the bin is full, and the mean speed is
+ * drawn bright at the maximum speed and dark when the Vehicles are stopped.
+ */
+void SpaceTimeRaster::writeRow() {
+    this->exchangeSharedColumn();
+
+    const int first_owned = this->shares_first_column ? 1 : 0;
+    for (int c = first_owned; c < this->num_columns; c++) {
+        const int64_t column = this->first_column + c;
+        const int64_t column_sites = std::min(this->road_length, (column + 1) * this->sites_per_pixel)
+                                     - column * this->sites_per_pixel;
+        const double density = (double) this->occupied[c] / ((double) column_sites * this->num_lanes * this->row_steps);
+        this->density_row[c] = (uint8_t) (255.0 * (1.0 - std::min(1.0, density)) + 0.5);
+        this->speed_row[c] = (this->occupied[c] > 0)
+                             ? (uint8_t) (255.0 * this->speed_sums[c] / ((double) this->occupied[c] * this->max_speed)
+                                          + 0.5)
+                             : RASTER_EMPTY;
+    }
+
+    const int64_t offset = this->header_size + (int64_t) this->row * this->width + this->first_column + first_owned;
+    this->density_file->writeAtAll(offset, this->density_row.data() + first_owned, this->num_columns - first_owned);
+    this->speed_file->writeAtAll(offset, this->speed_row.data() + first_owned, this->num_columns - first_owned);
+
+    std::fill(this->occupied.begin(), this->occupied.end(), 0);
+    std::fill(this->speed_sums.begin(), this->speed_sums.end(), 0);
+    this->row++;
+    this->row_steps = 0;
+}
+
+/**
+ * Ends a step of the simulation, writing the current row once it holds all its steps
+ * @param step the number of the step that just ended
+ */
+void SpaceTimeRaster::endStep(int step) {
+    if (!this->enabled) {
+        return;
+    }
+    this->row_steps++;
+    if (step % this->steps_per_row == 0) {
+        this->writeRow();
+    }
+}
+
+/**
+ * Writes the partial row of a run that stopped in the middle of a row, and the rows of a run that stopped early as
+ * empty rows, collective over all the processes
+ */
+void SpaceTimeRaster::finish() {
+    if (!this->enabled) {
+        return;
+    }
+    while (this->row < this->height) {
+        this->row_steps = std::max(this->row_steps, 1);
+        this->writeRow();
+    }
+}
+
+/**
+ * Adds the storage of the column sums and rows to a MemoryReport
+ * @param report the MemoryReport
+ */
+void SpaceTimeRaster::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_BUFFERS, this->occupied);
+    report->addVector(MEMORY_BUFFERS, this->speed_sums);
+    report->addVector(MEMORY_BUFFERS, this->density_row);
+    report->addVector(MEMORY_BUFFERS, this->speed_row);
+}
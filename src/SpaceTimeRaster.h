@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_SPACETIMERASTER_H
+#define CA_TRAFFIC_SIMULATION_SPACETIMERASTER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Inputs.h"
+#include "MemoryReport.h"
+#include "Transport.h"
+
+/**
+ * Class for the space-time diagram of the road, rendered while the simulation runs. The road is divided into pixel
+ * columns of a fixed number of sites and the run into pixel rows of a fixed number of steps, and every step each
+ * process adds its Vehicles to the columns of its segment. At the end of each row the processes write their columns
+ * of the row into two grayscale PGM images with a collective write, one of the density and one of the mean speed of
+ * each bin, so the images are the size of the raster whatever the length of the road. A column that straddles two
+ * segments is written by the process where it starts, which receives the sums of the rest of the column from the next
+ * process.
+ */
+class SpaceTimeRaster {
+private:
+    Transport* transport;
+    bool enabled;
+    int rank;
+    int size;
+    int num_lanes;
+    int max_speed;
+    int64_t road_length;
+    int sites_per_pixel;
+    int steps_per_row;
+    int width;
+    int height;
+    int start_site;
+    int first_column;
+    int num_columns;
+    bool shares_first_column;
+    bool shares_last_column;
+    std::vector<int64_t> occupied;
+    std::vector<int64_t> speed_sums;
+    std::vector<uint8_t> density_row;
+    std::vector<uint8_t> speed_row;
+    int row;
+    int row_steps;
+    int64_t header_size;
+    TransportFile* density_file;
+    TransportFile* speed_file;
+    void exchangeSharedColumn();
+    void writeRow();
+public:
+    SpaceTimeRaster(Transport* transport, const Inputs& inputs, int rank, int size);
+    ~SpaceTimeRaster();
+    bool isEnabled() const;
+    void addVehicle(int site, int speed);
+    void endStep(int step);
+    void finish();
+    void addMemory(MemoryReport* report) const;
+};
+
+/**
+ * Adds a Vehicle of the segment to the bin of its site in the current row
+ * @param site the site of the Vehicle in the segment
+ * @param speed the speed of the Vehicle
+ */
+inline void SpaceTimeRaster::addVehicle(int site, int speed) {
+    const int column = (unsigned int) (this->start_site + site) / (unsigned int) this->sites_per_pixel
+                       - this->first_column;
+    this->occupied[column]++;
+    this->speed_sums[column] += speed;
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_SPACETIMERASTER_H
@@ -2,6 +2,7 @@
  * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
  */
 
+#include <algorithm>
 #include <cmath>
 #include "Statistic.h"
 
@@ -9,6 +10,14 @@ Statistic::Statistic() {}
 
 Statistic::~Statistic() {}
 
+/**
+ * Reserves storage for a number of samples so that adding up to that many samples does not allocate
+ * @param num_samples number of samples to reserve storage for
+ */
+void Statistic::reserve(int num_samples) {
+    this->values.reserve(num_samples);
+}
+
 /**
  * Adds a sample to the statistic
  * @param value value of the sample
@@ -61,4 +70,30 @@ double Statistic::getVariance() {
  */
 int Statistic::getNumSamples() {
     return this->values.size();
-}
\ No newline at end of file
+}
+
+/**
+ * Gets the quantiles of the samples at the midpoints of equal probability intervals, (k + 0.5) / num_quantiles for k
+ * from 0, by linear interpolation between the sorted samples. Sorts the samples in place.
+ * @param num_quantiles number of quantiles
+ * @param quantiles array to hold the quantiles
+ */
+void Statistic::getQuantiles(int num_quantiles, double* quantiles) {
+    std::sort(this->values.begin(), this->values.end());
+    const int num_samples = this->values.size();
+    for (int k = 0; k < num_quantiles; k++) {
+        const double position = (k + 0.5) / num_quantiles * num_samples - 0.5;
+        const int below = std::min(std::max((int) std::floor(position), 0), num_samples - 1);
+        const int above = std::min(below + 1, num_samples - 1);
+        const double fraction = std::min(std::max(position - below, 0.0), 1.0);
+        quantiles[k] = this->values[below] + fraction * (this->values[above] - this->values[below]);
+    }
+}
+
+/**
+ * Adds the storage of the samples to a MemoryReport
+ * @param report the MemoryReport
+ */
+void Statistic::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_STATISTICS, this->values);
+}
@@ -7,6 +7,8 @@
 
 #include <vector>
 
+#include "MemoryReport.h"
+
 /**
  * Class for the statistics of a property of the simulation, like Vehicle travel time on the road. Has methods for
  * adding samples to the statistic, or getting mean and variance
@@ -17,10 +19,13 @@ private:
 public:
     Statistic();
     ~Statistic();
+    void reserve(int num_samples);
     void addValue(double value);
     double getAverage();
     double getVariance();
     int getNumSamples();
+    void getQuantiles(int num_quantiles, double* quantiles);
+    void addMemory(MemoryReport* report) const;
 };
 
 
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "AllocationCounter.h"
+#include "Placement.h"
+#include "TaskScheduler.h"
+
+// Number of times an idle worker checks for a new loop before it goes to sleep
+const int TASK_SPIN_LIMIT = 4096;
+
+namespace {
+    /**
+     * Packs a range of items into a task
+     * @param begin the first item of the range
+     * @param end one past the last item of the range
+     * @return the task
+     */
+    uint64_t packTask(int begin, int end) {
+        return ((uint64_t) (uint32_t) begin << 32) | (uint32_t) end;
+    }
+
+    /**
+     * Unpacks the range of items of a task
+     * @param task the task
+     * @param begin pointer to store the first item of the range in
+     * @param end pointer to store one past the last item of the range in
+     */
+    void unpackTask(uint64_t task, int* begin, int* end) {
+        *begin = (int) (uint32_t) (task >> 32);
+        *end = (int) (uint32_t) task;
+    }
+}
+
+/**
+ * Constructor of the TaskDeque, which starts out empty
+ */
+TaskDeque::TaskDeque() {
+    this->top.store(0, std::memory_order_relaxed);
+    this->bottom.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < TASK_DEQUE_CAPACITY; i++) {
+        this->tasks[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Pushes a task at the bottom of the deque, only called by the worker that owns the deque
+ * @param task the task
+ * @return true if the task was pushed, false if the deque is full
+ */
+bool TaskDeque::push(uint64_t task) {
+    const int64_t b = this->bottom.load(std::memory_order_relaxed);
+    const int64_t t = this->top.load(std::memory_order_acquire);
+    if (b - t >= TASK_DEQUE_CAPACITY) {
+        return false;
+    }
+    this->tasks[b % TASK_DEQUE_CAPACITY].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Takes the task at the bottom of the deque, only called by the worker that owns the deque
+ * @param task pointer to store the task in
+ * @return true if a task was taken, false if the deque is empty
+ */
+bool TaskDeque::take(uint64_t* task) {
+    const int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+    if (t > b) {
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    *task = this->tasks[b % TASK_DEQUE_CAPACITY].load(std::memory_order_relaxed);
+    if (t == b) {
+        // The last task in the deque, which a thief may be stealing at the same time
+        const bool taken = this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                             std::memory_order_relaxed);
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+        return taken;
+    }
+    return true;
+}
+
+/**
+ * Steals the task at the top of the deque, called by the other workers
+ * @param task pointer to store the task in
+ * @return true if a task was stolen, false if the deque is empty or another worker got the task first
+ */
+bool TaskDeque::steal(uint64_t* task) {
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = this->bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return false;
+    }
+    *task = this->tasks[t % TASK_DEQUE_CAPACITY].load(std::memory_order_relaxed);
+    return this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+/**
+ * Constructor of the TaskScheduler, which starts the worker threads other than the calling thread
+ * @param num_workers the number of workers, including the calling thread
+ * @param cpus core of each worker, see Placement::planWorkerCpus, empty to leave the workers on the cores of the
+ * calling thread
+ */
+TaskScheduler::TaskScheduler(int num_workers, const std::vector<int>& cpus) : deques(std::max(1, num_workers)) {
+    this->num_workers = std::max(1, num_workers);
+    this->counters.assign(this->num_workers, TaskWorkerCounters{0, 0, 0, 0.0, Placement::getCpu(), 0});
+    this->generation.store(0);
+    this->remaining_items.store(0);
+    this->active_workers.store(0);
+    this->stopping = false;
+    this->function = nullptr;
+    this->context = nullptr;
+    this->grain = 1;
+    this->loop_time = 0.0;
+    for (int worker = 1; worker < this->num_workers; worker++) {
+        this->threads.emplace_back(&TaskScheduler::workerLoop, this, worker, cpus.empty() ? -1 : cpus[worker]);
+    }
+}
+
+/**
+ * Destructor of the TaskScheduler, which stops and joins the worker threads
+ */
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (std::thread& thread : this->threads) {
+        thread.join();
+    }
+}
+
+/**
+ * Getter for the number of workers
+ * @return the number of workers, including the calling thread
+ */
+int TaskScheduler::getNumWorkers() const {
+    return this->num_workers;
+}
+
+/**
+ * Gets the number of heap allocations made so far by the worker threads other than the calling thread, which count
+ * them in their own threads, see AllocationCounter. The count is up to date once a loop returns.
+ * @return number of allocations, always zero if the counting hook is not compiled in
+ */
+long TaskScheduler::getAllocations() const {
+    long num_allocations = 0;
+    for (int worker = 1; worker < this->num_workers; worker++) {
+        num_allocations += this->counters[worker].num_allocations;
+    }
+    return num_allocations;
+}
+
+/**
+ * Main loop of a worker thread, which joins every loop that is started until the scheduler stops. An idle worker
+ * spins for a while before it sleeps, since the phases of a step start loops in quick succession.
+ * @param worker the number of the worker
+ * @param cpu the core to pin the worker to, -1 to leave it on the cores of the thread that created it
+ */
+void TaskScheduler::workerLoop(int worker, int cpu) {
+    if (cpu >= 0) {
+        Placement::pinThread(cpu);
+    }
+    this->counters[worker].cpu = Placement::getCpu();
+
+    uint64_t seen_generation = 0;
+    while (true) {
+        for (int spin = 0; spin < TASK_SPIN_LIMIT && this->generation.load() == seen_generation; spin++) {
+            std::this_thread::yield();
+        }
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [&]() {
+                return this->stopping || this->generation.load() != seen_generation;
+            });
+            if (this->stopping) {
+                return;
+            }
+            seen_generation = this->generation.load();
+            this->active_workers++;
+        }
+        this->participate(worker);
+        this->active_workers--;
+    }
+}
+
+/**
+ * Works on the current loop until all its items are done, taking tasks from the own deque and stealing from the other
+ * workers when it is empty
+ * @param worker the number of the worker
+ */
+void TaskScheduler::participate(int worker) {
+    TaskDeque& own = this->deques[worker];
+    TaskWorkerCounters& counters = this->counters[worker];
+    while (this->remaining_items.load() > 0) {
+        uint64_t task;
+        bool found = own.take(&task);
+        for (int k = 1; k < this->num_workers && !found; k++) {
+            found = this->deques[(worker + k) % this->num_workers].steal(&task);
+            counters.num_steals += found;
+        }
+        if (!found) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Split off the upper half of the range until the grain size is reached, then run the rest
+        int begin, end;
+        unpackTask(task, &begin, &end);
+        while (end - begin > this->grain) {
+            const int middle = begin + (end - begin) / 2;
+            if (!own.push(packTask(middle, end))) {
+                break;
+            }
+            end = middle;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        this->function(this->context, begin, end, worker);
+        counters.busy_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        counters.num_tasks++;
+        counters.num_items += end - begin;
+        counters.num_allocations = AllocationCounter::getCount();
+        this->remaining_items -= end - begin;
+    }
+}
+
+/**
+ * Runs a loop over a range of items on all the workers
+ * @param function the function that runs the body of the loop for a range of items
+ * @param context the body of the loop
+ * @param count the number of items
+ * @param grain the number of items below which a range is not split any further
+ */
+void TaskScheduler::runRange(RangeFunction function, void* context, int count, int grain) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->function = function;
+        this->context = context;
+        this->grain = std::max(1, grain);
+        this->remaining_items.store(count);
+        this->deques[0].push(packTask(0, count));
+        this->generation++;
+    }
+    this->wake.notify_all();
+
+    // Work on the loop in the calling thread, then wait for the other workers to leave it
+    this->participate(0);
+    while (this->active_workers.load() > 0) {
+        std::this_thread::yield();
+    }
+    this->loop_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Prints the utilization of the workers of every rank, collective over all the ranks. The busy fraction of a worker
+ * is the time it spent running tasks over the time spent in the loops of the scheduler.
+ * @param transport the Transport of the rank
+ */
+void TaskScheduler::report(Transport* transport) {
+    const int rank = transport->getRank();
+    const int size = transport->getSize();
+
+    // Gather the entries of the workers of all the ranks
+    const int num_values = 5;
+    std::vector<double> local((size_t) this->num_workers * num_values, 0.0);
+    std::vector<double> values((size_t) size * local.size(), 0.0);
+    for (int worker = 0; worker < this->num_workers; worker++) {
+        double* entry = local.data() + (size_t) worker * num_values;
+        entry[0] = this->counters[worker].num_tasks;
+        entry[1] = this->counters[worker].num_items;
+        entry[2] = this->counters[worker].num_steals;
+        entry[3] = (this->loop_time > 0.0) ? this->counters[worker].busy_time / this->loop_time : 0.0;
+        entry[4] = this->counters[worker].cpu;
+    }
+    transport->allGather(local.data(), local.size() * sizeof(double), values.data());
+
+    if (rank == 0) {
+        const std::ios_base::fmtflags flags = std::cout.flags();
+        const std::streamsize precision = std::cout.precision();
+        std::cout << "--- Task Scheduler ---" << std::endl;
+        std::cout << std::setw(6) << "rank" << std::setw(8) << "worker" << std::setw(6) << "core" << std::setw(12)
+                  << "tasks" << std::setw(14) << "items" << std::setw(10) << "steals" << std::setw(8) << "busy"
+                  << std::endl;
+        for (int r = 0; r < size; r++) {
+            for (int worker = 0; worker < this->num_workers; worker++) {
+                const double* entry = values.data() + ((size_t) r * this->num_workers + worker) * num_values;
+                const std::string core = (entry[4] >= 0) ? std::to_string((int) entry[4]) : "?";
+                std::cout << std::setw(6) << r << std::setw(8) << worker << std::setw(6) << core << std::setw(12)
+                          << (long) entry[0] << std::setw(14) << (long) entry[1] << std::setw(10) << (long) entry[2] << std::fixed
+                          << std::setprecision(1) << std::setw(7) << 100.0 * entry[3] << "%" << std::endl;
+            }
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_TASKSCHEDULER_H
+#define CA_TRAFFIC_SIMULATION_TASKSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Transport.h"
+
+// Number of tasks that a worker can hold in its deque, which bounds how deeply a range is split
+const int TASK_DEQUE_CAPACITY = 64;
+
+/**
+ * Work-stealing deque of Chase and Lev, with the C11 memory orders of Le et al. The worker that owns the deque pushes
+ * and takes tasks at the bottom, and other workers steal from the top. A task is a range of items packed into a word.
+ */
+class TaskDeque {
+private:
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<uint64_t> tasks[TASK_DEQUE_CAPACITY];
+public:
+    TaskDeque();
+    bool push(uint64_t task);
+    bool take(uint64_t* task);
+    bool steal(uint64_t* task);
+};
+
+/**
+ * Counters of the work done by one worker of a TaskScheduler, on a cache line of its own
+ */
+struct alignas(64) TaskWorkerCounters {
+    int64_t num_tasks;
+    int64_t num_items;
+    int64_t num_steals;
+    double busy_time;
+    int cpu;
+    long num_allocations;
+};
+
+/**
+ * Scheduler that runs loops over uneven items on a pool of worker threads of one rank. A loop starts as one range in
+ * the deque of the calling thread, which is worker 0. A worker splits the range it holds in half until it reaches the
+ * grain size, keeping the lower half and pushing the upper half, so idle workers steal the largest pending ranges and
+ * the load balances itself whether the cost of the items is even or not. The items must be independent of each other.
+ * With one worker the loops run directly in the calling thread. The scheduler does not allocate once it is created.
+ */
+class TaskScheduler {
+private:
+    typedef void (*RangeFunction)(void* context, int begin, int end, int worker);
+    int num_workers;
+    std::vector<std::thread> threads;
+    std::vector<TaskDeque> deques;
+    std::vector<TaskWorkerCounters> counters;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<uint64_t> generation;
+    std::atomic<int64_t> remaining_items;
+    std::atomic<int> active_workers;
+    bool stopping;
+    RangeFunction function;
+    void* context;
+    int grain;
+    double loop_time;
+    void workerLoop(int worker, int cpu);
+    void participate(int worker);
+    void runRange(RangeFunction function, void* context, int count, int grain);
+    template <class Body>
+    static void callBody(void* context, int begin, int end, int worker);
+public:
+    TaskScheduler(int num_workers, const std::vector<int>& cpus);
+    ~TaskScheduler();
+    int getNumWorkers() const;
+    long getAllocations() const;
+    template <class Body>
+    void parallelFor(int count, int grain, Body& body);
+    void report(Transport* transport);
+};
+
+/**
+ * Calls the body of a loop for a range of items
+ * @tparam Body callable taking the first item, the end of the range and the worker
+ */
+template <class Body>
+void TaskScheduler::callBody(void* context, int begin, int end, int worker) {
+    (*static_cast<Body*>(context))(begin, end, worker);
+}
+
+/**
+ * Runs a loop over a number of items on the workers, returning once every item is done
+ * @tparam Body callable taking the first item, the end of the range and the worker, which must be safe to call for
+ * different ranges at the same time
+ * @param count the number of items
+ * @param grain the number of items below which a range is not split any further
+ * @param body the body of the loop
+ */
+template <class Body>
+void TaskScheduler::parallelFor(int count, int grain, Body& body) {
+    if (this->num_workers == 1 || count <= grain) {
+        body(0, count, 0);
+        return;
+    }
+    this->runRange(&TaskScheduler::callBody<Body>, &body, count, grain);
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_TASKSCHEDULER_H
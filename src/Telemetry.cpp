@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "Telemetry.h"
+
+/**
+ * Constructor for the Telemetry. Rank 0 creates the shared memory ring, and if that fails the simulation carries on
+ * without publishing.
+ * @param transport the Transport used to reduce the timings
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param rank the rank of the process
+ * @param size the number of processes
+ */
+Telemetry::Telemetry(Transport* transport, const Inputs& inputs, int rank, int size) {
+    this->transport = transport;
+    this->interval = inputs.telemetry_interval;
+    this->size = size;
+    this->current_phase = -1;
+    this->request_pending = false;
+    this->requests[0] = -1;
+    this->requests[1] = -1;
+    this->pending_step = 0;
+    this->pending_wall_time = 0.0;
+    this->published_step = 0;
+    this->published_wall_time = 0.0;
+    this->ring = nullptr;
+    this->segment_name[0] = '\0';
+    std::fill(this->local_values, this->local_values + NUM_VALUES, 0.0);
+    this->run_start = std::chrono::steady_clock::now();
+
+    if (!this->isEnabled() || rank != 0) {
+        return;
+    }
+
+    // Create the shared memory segment of the ring, named after the process id so that simultaneous runs coexist
+    TelemetryRing::segmentName((long) getpid(), this->segment_name, sizeof(this->segment_name));
+    int fd = shm_open(this->segment_name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(TelemetryRing::Ring)) != 0) {
+        std::cout << "warning: failure to create telemetry segment \"" << this->segment_name << "\"!" << std::endl;
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(this->segment_name);
+        }
+        this->segment_name[0] = '\0';
+        return;
+    }
+    void* ptr = mmap(nullptr, sizeof(TelemetryRing::Ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        std::cout << "warning: failure to map telemetry segment \"" << this->segment_name << "\"!" << std::endl;
+        shm_unlink(this->segment_name);
+        this->segment_name[0] = '\0';
+        return;
+    }
+
+    // Initialize the header, the segment is zero filled so every record starts out empty
+    this->ring = static_cast<TelemetryRing::Ring*>(ptr);
+    this->ring->num_processes = size;
+    this->ring->max_time = inputs.max_time;
+    this->ring->version = TelemetryRing::VERSION;
+    this->ring->magic = TelemetryRing::MAGIC;
+
+    std::cout << "publishing telemetry to \"/dev/shm" << this->segment_name << "\", view it with cats-top"
+              << std::endl;
+}
+
+/**
+ * Destructor for the Telemetry, readers that still have the ring mapped keep their view of it
+ */
+Telemetry::~Telemetry() {
+    if (this->ring != nullptr) {
+        munmap(this->ring, sizeof(TelemetryRing::Ring));
+        shm_unlink(this->segment_name);
+    }
+}
+
+/**
+ * Checks whether the telemetry is collected in the simulation
+ * @return true if the telemetry is collected, false otherwise
+ */
+bool Telemetry::isEnabled() {
+    return this->interval > 0;
+}
+
+/**
+ * Marks the start of a phase of the step, which also ends the phase before it
+ * @param phase the phase that is starting
+ */
+void Telemetry::beginPhase(int phase) {
+    if (!this->isEnabled()) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (this->current_phase >= 0) {
+        this->local_values[this->current_phase] += std::chrono::duration<double>(now - this->phase_start).count();
+    }
+    this->current_phase = phase;
+    this->phase_start = now;
+}
+
+/**
+ * Completes the reductions of the pending interval, if there is one, and publishes it into the ring on rank 0
+ * @param rank the rank of the process
+ */
+void Telemetry::completePending(int rank) {
+    if (!this->request_pending) {
+        return;
+    }
+
+    this->transport->wait(this->requests[0]);
+    this->transport->wait(this->requests[1]);
+    this->request_pending = false;
+
+    if (rank != 0 || this->ring == nullptr) {
+        return;
+    }
+
+    // Write the record into the next slot of the ring, with an odd sequence number while it is being written
+    uint64_t index = this->ring->num_published.load(std::memory_order_relaxed);
+    TelemetryRing::Record& record = this->ring->records[index % TelemetryRing::CAPACITY];
+    record.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Phase times are reported in seconds per step
+    double num_steps = std::max(1, this->pending_step - this->published_step);
+    double elapsed = this->pending_wall_time - this->published_wall_time;
+    record.step = this->pending_step;
+    record.wall_time = this->pending_wall_time;
+    record.steps_per_second = elapsed > 0.0 ? num_steps / elapsed : 0.0;
+    record.num_vehicles = (int64_t) this->sum_values[VALUE_NUM_VEHICLES];
+    for (int i = 0; i < TelemetryRing::NUM_PHASES; i++) {
+        record.phase_time_mean[i] = this->sum_values[i] / this->size / num_steps;
+        record.phase_time_max[i] = this->max_values[i] / num_steps;
+    }
+    double mean_compute_time = this->sum_values[VALUE_COMPUTE_TIME] / this->size;
+    record.imbalance = mean_compute_time > 0.0 ? this->max_values[VALUE_COMPUTE_TIME] / mean_compute_time - 1.0 : 0.0;
+
+    record.sequence.store(2 * index + 2, std::memory_order_release);
+    this->ring->num_published.store(index + 1, std::memory_order_release);
+
+    this->published_step = this->pending_step;
+    this->published_wall_time = this->pending_wall_time;
+}
+
+/**
+ * Ends a step, and at the end of every publishing interval starts the reduction of the telemetry of the interval,
+ * which completes during the next interval
+ * @param step the number of steps completed
+ * @param num_vehicles number of Vehicles on the segment of this process
+ * @param rank the rank of the process
+ */
+void Telemetry::endStep(int step, int num_vehicles, int rank) {
+    if (!this->isEnabled()) {
+        return;
+    }
+
+    this->beginPhase(-1);
+    if (step % this->interval != 0) {
+        return;
+    }
+
+    this->completePending(rank);
+
+    // Compute time excludes the phases that wait on the neighbor processes
+    this->local_values[VALUE_COMPUTE_TIME] = this->local_values[TelemetryRing::PHASE_LANE_SWITCH]
+                                             + this->local_values[TelemetryRing::PHASE_LANE_MOVE]
+                                             + this->local_values[TelemetryRing::PHASE_SPAWN];
+    this->local_values[VALUE_NUM_VEHICLES] = num_vehicles;
+    std::copy(this->local_values, this->local_values + NUM_VALUES, this->send_values);
+    std::fill(this->local_values, this->local_values + NUM_VALUES, 0.0);
+
+    this->requests[0] = this->transport->startReduce(this->send_values, this->sum_values, NUM_VALUES, REDUCE_SUM, 0);
+    this->requests[1] = this->transport->startReduce(this->send_values, this->max_values, NUM_VALUES, REDUCE_MAX, 0);
+    this->request_pending = true;
+    this->pending_step = step;
+    this->pending_wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                            - this->run_start).count();
+}
+
+/**
+ * Publishes the last pending interval and marks the run as finished in the ring
+ * @param rank the rank of the process
+ */
+void Telemetry::finish(int rank) {
+    if (!this->isEnabled()) {
+        return;
+    }
+
+    this->completePending(rank);
+    if (this->ring != nullptr) {
+        this->ring->finished.store(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_TELEMETRY_H
+#define CA_TRAFFIC_SIMULATION_TELEMETRY_H
+
+#include <chrono>
+
+#include "Inputs.h"
+#include "TelemetryRing.h"
+#include "Transport.h"
+
+/**
+ * Class for the live telemetry of the simulation. Every process times the phases of its steps, and every publishing
+ * interval the timings and Vehicle counts are reduced to rank 0 with non-blocking collectives that complete during
+ * the next interval. Rank 0 publishes the results into a shared memory ring that the "cats-top" reader displays.
+ */
+class Telemetry {
+private:
+    static const int VALUE_COMPUTE_TIME = TelemetryRing::NUM_PHASES;
+    static const int VALUE_NUM_VEHICLES = TelemetryRing::NUM_PHASES + 1;
+    static const int NUM_VALUES = TelemetryRing::NUM_PHASES + 2;
+    Transport* transport;
+    int interval;
+    int size;
+    int current_phase;
+    std::chrono::steady_clock::time_point phase_start;
+    std::chrono::steady_clock::time_point run_start;
+    double local_values[NUM_VALUES];
+    double send_values[NUM_VALUES];
+    double sum_values[NUM_VALUES];
+    double max_values[NUM_VALUES];
+    int requests[2];
+    bool request_pending;
+    int pending_step;
+    double pending_wall_time;
+    int published_step;
+    double published_wall_time;
+    TelemetryRing::Ring* ring;
+    char segment_name[64];
+    void completePending(int rank);
+public:
+    Telemetry(Transport* transport, const Inputs& inputs, int rank, int size);
+    ~Telemetry();
+    bool isEnabled();
+    void beginPhase(int phase);
+    void endStep(int step, int num_vehicles, int rank);
+    void finish(int rank);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_TELEMETRY_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_TELEMETRYRING_H
+#define CA_TRAFFIC_SIMULATION_TELEMETRYRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * Layout of the shared memory ring that the simulation publishes its live telemetry into, shared between the
+ * simulation and the "cats-top" reader. There is a single writer and any number of readers. Each record is guarded
+ * by a sequence number that is odd while the writer is updating the record, so readers detect and retry torn reads
+ * and the writer never waits for a reader.
+ */
+namespace TelemetryRing {
+    // Identifier at the start of the shared memory segment, and version of the layout
+    const uint32_t MAGIC = 0x43415453;
+    const uint32_t VERSION = 1;
+
+    // Number of records in the ring
+    const int CAPACITY = 64;
+
+    // Phases of a simulation step that are timed
+    enum Phase {
+        PHASE_GAP_EXCHANGE,
+        PHASE_LANE_SWITCH,
+        PHASE_LANE_MOVE,
+        PHASE_BOUNDARY,
+        PHASE_SPAWN,
+        NUM_PHASES
+    };
+
+    // Short names of the phases for display
+    const char* const PHASE_NAMES[NUM_PHASES] = {"gaps", "switch", "move", "boundary", "spawn"};
+
+    /**
+     * Telemetry of the simulation over one publishing interval
+     */
+    struct Record {
+        std::atomic<uint64_t> sequence;
+        int64_t step;
+        double wall_time;
+        double steps_per_second;
+        int64_t num_vehicles;
+        double phase_time_mean[NUM_PHASES];
+        double phase_time_max[NUM_PHASES];
+        double imbalance;
+    };
+
+    /**
+     * Header of the shared memory segment followed by the records of the ring
+     */
+    struct Ring {
+        uint32_t magic;
+        uint32_t version;
+        int32_t num_processes;
+        int32_t max_time;
+        std::atomic<uint64_t> num_published;
+        std::atomic<uint32_t> finished;
+        Record records[CAPACITY];
+    };
+
+    /**
+     * Builds the name of the shared memory segment of the simulation run by a process
+     * @param pid process id of rank 0 of the simulation
+     * @param name buffer for the name
+     * @param name_size size of the buffer
+     */
+    inline void segmentName(long pid, char* name, int name_size) {
+        std::snprintf(name, name_size, "/cats-telemetry-%ld", pid);
+    }
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_TELEMETRYRING_H
@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Placement.h"
+#include "ThreadTransport.h"
+
+// Number of times a waiting thread polls before it starts yielding the processor to other threads
+const int THREAD_TRANSPORT_SPINS_BEFORE_YIELD = 256;
+
+/**
+ * Single message slot from one rank to a neighbouring rank for one tag. The sender waits until the slot is empty and
+ * the receiver waits until it is full, so the buffer is reused by every message.
+ */
+struct Mailbox {
+    std::atomic<bool> full;
+    int num_bytes;
+    std::vector<char> data;
+
+    Mailbox() : full(false), num_bytes(0) {}
+};
+
+/**
+ * Slot of a pending nonblocking collective, reused once the collective has been waited for. The counters only grow, so
+ * the n-th use of the slot is published by all the ranks once the arrivals reach (n + 1) * size, and read by all of
+ * them once the completions do.
+ */
+struct CollectiveSlot {
+    std::atomic<int64_t> num_arrived;
+    std::atomic<int64_t> num_finished;
+    std::vector<const void*> published;
+
+    CollectiveSlot() : num_arrived(0), num_finished(0) {}
+};
+
+/**
+ * State shared by all the threads of a ThreadTransport
+ */
+struct ThreadGroup {
+    int size;
+    std::atomic<int> barrier_count;
+    std::atomic<int> barrier_generation;
+    std::vector<const void*> published;
+    std::unique_ptr<Mailbox[]> mailboxes;
+    std::unique_ptr<CollectiveSlot[]> collectives;
+    int file_descriptor;
+
+    ThreadGroup(int size) : size(size), barrier_count(0), barrier_generation(0), published(size, nullptr),
+                            mailboxes(new Mailbox[(size_t) size * 2 * TRANSPORT_NUM_TAGS]),
+                            collectives(new CollectiveSlot[THREAD_TRANSPORT_MAX_COLLECTIVES]), file_descriptor(-1) {
+        for (int i = 0; i < THREAD_TRANSPORT_MAX_COLLECTIVES; i++) {
+            this->collectives[i].published.assign(size, nullptr);
+        }
+    }
+
+    /**
+     * Gets the mailbox of the messages from one rank to a neighbouring rank
+     * @param dest the rank receiving the messages
+     * @param source the rank sending the messages
+     * @param tag tag of the messages
+     * @return the mailbox
+     */
+    Mailbox& mailbox(int dest, int source, int tag) {
+        if (std::abs(dest - source) != 1 || tag < 0 || tag >= TRANSPORT_NUM_TAGS) {
+            std::cout << "error: unsupported message from rank " << source << " to rank " << dest << " with tag "
+                      << tag << "!" << std::endl;
+            std::abort();
+        }
+        const int direction = (source < dest) ? 0 : 1;
+        return this->mailboxes[((size_t) dest * 2 + direction) * TRANSPORT_NUM_TAGS + tag];
+    }
+};
+
+namespace {
+    /**
+     * Waits until a condition holds, polling at first and then yielding the processor between polls
+     * @tparam Condition type of the condition
+     * @param condition function that returns true once the wait is over
+     */
+    template <class Condition>
+    inline void waitUntil(Condition condition) {
+        for (int spins = 0; !condition(); spins++) {
+            if (spins >= THREAD_TRANSPORT_SPINS_BEFORE_YIELD) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * Combines a value into a partial result of a reduction
+     * @tparam T type of the values
+     * @param result the partial result
+     * @param value the value to combine
+     * @param op the reduction operation
+     */
+    template <class T>
+    inline void combine(T& result, T value, ReduceOp op) {
+        result = (op == REDUCE_MAX) ? std::max(result, value) : result + value;
+    }
+
+    /**
+     * Reduces the arrays of all the ranks
+     * @tparam T type of the values
+     * @param all pointers to the arrays of all the ranks
+     * @param size the number of ranks
+     * @param results array to hold the results
+     * @param count number of values in each array
+     * @param op the reduction operation
+     */
+    template <class T>
+    void reduceArrays(const void* const* all, int size, T* results, int count, ReduceOp op) {
+        for (int i = 0; i < count; i++) {
+            T result = static_cast<const T*>(all[0])[i];
+            for (int k = 1; k < size; k++) {
+                combine(result, static_cast<const T*>(all[k])[i], op);
+            }
+            results[i] = result;
+        }
+    }
+
+    /**
+     * File written with positioned writes by all the threads through a shared file descriptor
+     */
+    class ThreadTransportFile : public TransportFile {
+    private:
+        Transport* transport;
+        int file_descriptor;
+    public:
+        ThreadTransportFile(Transport* transport, int file_descriptor) {
+            this->transport = transport;
+            this->file_descriptor = file_descriptor;
+        }
+
+        ~ThreadTransportFile() {
+            this->transport->barrier();
+            if (this->transport->getRank() == 0) {
+                close(this->file_descriptor);
+            }
+        }
+
+        void writeAtAll(int64_t offset, const void* data, int num_bytes) {
+            const char* bytes = static_cast<const char*>(data);
+            while (num_bytes > 0) {
+                ssize_t num_written = pwrite(this->file_descriptor, bytes, num_bytes, (off_t) offset);
+                if (num_written <= 0) {
+                    break;
+                }
+                bytes += num_written;
+                offset += num_written;
+                num_bytes -= (int) num_written;
+            }
+            this->transport->barrier();
+        }
+    };
+}
+
+/**
+ * Constructor for the ThreadTransport of one thread
+ * @param group state shared by all the threads
+ * @param rank the rank of the thread
+ */
+ThreadTransport::ThreadTransport(ThreadGroup* group, int rank) {
+    this->group = group;
+    this->rank = rank;
+    this->size = group->size;
+    for (int i = 0; i < THREAD_TRANSPORT_MAX_REQUESTS; i++) {
+        this->pending_receives[i].source = TRANSPORT_NO_RANK;
+    }
+    for (int i = 0; i < THREAD_TRANSPORT_MAX_COLLECTIVES; i++) {
+        this->pending_collectives[i].active = false;
+        this->collective_uses[i] = 0;
+    }
+}
+
+/**
+ * Runs a function in a number of threads, each with its own rank. Rank 0 runs in the calling thread. Each thread is pinned to
+ * its core before the function runs, so that the memory the function allocates is placed on the NUMA node of the core.
+ * @param num_threads number of threads
+ * @param cpus core of each thread, empty to leave the threads unpinned
+ * @param body function to run, given the Transport of its thread, returning 0 if successful
+ * @return 0 if every thread was successful, nonzero otherwise
+ */
+int ThreadTransport::run(int num_threads, const std::vector<int>& cpus, const std::function<int(Transport*)>& body) {
+    ThreadGroup group(num_threads);
+    std::vector<int> statuses(num_threads, 0);
+
+    std::vector<std::thread> threads;
+    for (int rank = 1; rank < num_threads; rank++) {
+        threads.emplace_back([&group, &statuses, &cpus, &body, rank]() {
+            if (!cpus.empty()) {
+                Placement::pinThread(cpus[rank]);
+            }
+            ThreadTransport transport(&group, rank);
+            statuses[rank] = body(&transport);
+        });
+    }
+    {
+        if (!cpus.empty()) {
+            Placement::pinThread(cpus[0]);
+        }
+        ThreadTransport transport(&group, 0);
+        statuses[0] = body(&transport);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int status : statuses) {
+        if (status != 0) {
+            return status;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Publishes a pointer to the data of this rank and waits until all ranks have published theirs. The caller must call
+ * barrier once it is done reading the data of the other ranks.
+ * @param data pointer to the data of this rank
+ * @return pointers to the data of all the ranks
+ */
+const void* const* ThreadTransport::gather(const void* data) {
+    this->group->published[this->rank] = data;
+    this->barrier();
+    return this->group->published.data();
+}
+
+int ThreadTransport::getRank() const {
+    return this->rank;
+}
+
+int ThreadTransport::getSize() const {
+    return this->size;
+}
+
+void ThreadTransport::barrier() {
+    const int generation = this->group->barrier_generation.load(std::memory_order_acquire);
+    if (this->group->barrier_count.fetch_add(1, std::memory_order_acq_rel) == this->size - 1) {
+        // The last thread to arrive releases the others
+        this->group->barrier_count.store(0, std::memory_order_relaxed);
+        this->group->barrier_generation.fetch_add(1, std::memory_order_release);
+    } else {
+        waitUntil([&]() {
+            return this->group->barrier_generation.load(std::memory_order_acquire) != generation;
+        });
+    }
+}
+
+void ThreadTransport::broadcast(void* data, int num_bytes, int root) {
+    const void* const* all = this->gather(data);
+    if (this->rank != root && num_bytes > 0) {
+        std::memcpy(data, all[root], num_bytes);
+    }
+    this->barrier();
+}
+
+void ThreadTransport::sendRecv(const void* send_data, int send_bytes, int dest, void* recv_data, int recv_bytes,
+                               int source, int tag) {
+    if (dest != TRANSPORT_NO_RANK) {
+        Mailbox& mailbox = this->group->mailbox(dest, this->rank, tag);
+        waitUntil([&]() { return !mailbox.full.load(std::memory_order_acquire); });
+        if ((int) mailbox.data.size() < send_bytes) {
+            mailbox.data.resize(2 * send_bytes);
+        }
+        if (send_bytes > 0) {
+            std::memcpy(mailbox.data.data(), send_data, send_bytes);
+        }
+        mailbox.num_bytes = send_bytes;
+        mailbox.full.store(true, std::memory_order_release);
+    }
+
+    if (source != TRANSPORT_NO_RANK) {
+        Mailbox& mailbox = this->group->mailbox(this->rank, source, tag);
+        waitUntil([&]() { return mailbox.full.load(std::memory_order_acquire); });
+        const int num_bytes = std::min(mailbox.num_bytes, recv_bytes);
+        if (num_bytes > 0) {
+            std::memcpy(recv_data, mailbox.data.data(), num_bytes);
+        }
+        mailbox.full.store(false, std::memory_order_release);
+    }
+}
+
+void ThreadTransport::reduce(const double* values, double* results, int count, ReduceOp op, int root) {
+    const void* const* all = this->gather(values);
+    if (this->rank == root) {
+        reduceArrays(all, this->size, results, count, op);
+    }
+    this->barrier();
+}
+
+void ThreadTransport::allReduce(const double* values, double* results, int count, ReduceOp op) {
+    const void* const* all = this->gather(values);
+    reduceArrays(all, this->size, results, count, op);
+    this->barrier();
+}
+
+void ThreadTransport::allReduce(const int64_t* values, int64_t* results, int count, ReduceOp op) {
+    const void* const* all = this->gather(values);
+    reduceArrays(all, this->size, results, count, op);
+    this->barrier();
+}
+
+void ThreadTransport::exclusiveScan(const int64_t* values, int64_t* results, int count) {
+    const void* const* all = this->gather(values);
+    for (int i = 0; i < count; i++) {
+        int64_t result = 0;
+        for (int k = 0; k < this->rank; k++) {
+            result += static_cast<const int64_t*>(all[k])[i];
+        }
+        results[i] = result;
+    }
+    this->barrier();
+}
+
+void ThreadTransport::allGather(const void* data, int num_bytes, void* results) {
+    const void* const* all = this->gather(data);
+    if (num_bytes > 0) {
+        for (int k = 0; k < this->size; k++) {
+            std::memcpy(static_cast<char*>(results) + (size_t) k * num_bytes, all[k], num_bytes);
+        }
+    }
+    this->barrier();
+}
+
+/**
+ * Publishes the values of this rank in the first free slot of the nonblocking collectives without waiting for the
+ * other ranks. The ranks start and wait for the collectives in the same order, so they agree on the slot of each one.
+ * @param values array of the values of this rank, left alone until the wait
+ * @param results array to hold the results
+ * @param count number of values
+ * @param op the reduction operation
+ * @param root the rank that receives the results, TRANSPORT_NO_RANK for all the ranks
+ * @return the request of the collective
+ */
+int ThreadTransport::startCollective(const double* values, double* results, int count, ReduceOp op, int root) {
+    int slot = 0;
+    while (slot < THREAD_TRANSPORT_MAX_COLLECTIVES && this->pending_collectives[slot].active) {
+        slot++;
+    }
+    if (slot == THREAD_TRANSPORT_MAX_COLLECTIVES) {
+        std::cout << "error: too many pending nonblocking operations!" << std::endl;
+        std::abort();
+    }
+    PendingCollective& collective = this->pending_collectives[slot];
+    collective.results = results;
+    collective.count = count;
+    collective.op = op;
+    collective.root = root;
+    collective.use = this->collective_uses[slot]++;
+    collective.active = true;
+
+    // The previous use of the slot was read by all the ranks before this rank finished waiting for it
+    CollectiveSlot& shared = this->group->collectives[slot];
+    shared.published[this->rank] = values;
+    shared.num_arrived.fetch_add(1, std::memory_order_acq_rel);
+    return THREAD_TRANSPORT_MAX_REQUESTS + slot;
+}
+
+/**
+ * Completes a nonblocking collective once all the ranks have published their values, and waits until all of them
+ * have read the values of this rank so that its buffer can be reused
+ * @param collective the pending collective
+ * @param slot the slot of the collective
+ */
+void ThreadTransport::finishCollective(PendingCollective& collective, int slot) {
+    CollectiveSlot& shared = this->group->collectives[slot];
+    const int64_t all_ranks = (collective.use + 1) * this->size;
+    waitUntil([&]() { return shared.num_arrived.load(std::memory_order_acquire) >= all_ranks; });
+    if (collective.root == TRANSPORT_NO_RANK || collective.root == this->rank) {
+        reduceArrays(shared.published.data(), this->size, collective.results, collective.count, collective.op);
+    }
+    shared.num_finished.fetch_add(1, std::memory_order_acq_rel);
+    waitUntil([&]() { return shared.num_finished.load(std::memory_order_acquire) >= all_ranks; });
+    collective.active = false;
+}
+
+int ThreadTransport::startReduce(const double* values, double* results, int count, ReduceOp op, int root) {
+    return this->startCollective(values, results, count, op, root);
+}
+
+int ThreadTransport::startAllReduce(const double* values, double* results, int count, ReduceOp op) {
+    return this->startCollective(values, results, count, op, TRANSPORT_NO_RANK);
+}
+
+int ThreadTransport::startSend(const void* data, int num_bytes, int dest, int tag) {
+    this->sendRecv(data, num_bytes, dest, nullptr, 0, TRANSPORT_NO_RANK, tag);
+    return -1;
+}
+
+void ThreadTransport::reserveMessages(int num_bytes, int dest, int tag) {
+    if (dest == TRANSPORT_NO_RANK) {
+        return;
+    }
+    Mailbox& mailbox = this->group->mailbox(dest, this->rank, tag);
+    waitUntil([&]() { return !mailbox.full.load(std::memory_order_acquire); });
+    if ((int) mailbox.data.size() < num_bytes) {
+        mailbox.data.resize(num_bytes);
+    }
+}
+
+int ThreadTransport::startRecv(void* data, int num_bytes, int source, int tag) {
+    if (source == TRANSPORT_NO_RANK) {
+        return -1;
+    }
+    for (int i = 0; i < THREAD_TRANSPORT_MAX_REQUESTS; i++) {
+        PendingReceive& receive = this->pending_receives[i];
+        if (receive.source == TRANSPORT_NO_RANK) {
+            receive.data = data;
+            receive.num_bytes = num_bytes;
+            receive.source = source;
+            receive.tag = tag;
+            return i;
+        }
+    }
+    std::cout << "error: too many pending nonblocking operations!" << std::endl;
+    std::abort();
+}
+
+void ThreadTransport::wait(int request) {
+    if (request >= THREAD_TRANSPORT_MAX_REQUESTS && request < THREAD_TRANSPORT_MAX_REQUESTS +
+                                                                THREAD_TRANSPORT_MAX_COLLECTIVES) {
+        const int slot = request - THREAD_TRANSPORT_MAX_REQUESTS;
+        this->finishCollective(this->pending_collectives[slot], slot);
+        return;
+    }
+    if (request < 0 || request >= THREAD_TRANSPORT_MAX_REQUESTS) {
+        return;
+    }
+    PendingReceive& receive = this->pending_receives[request];
+    this->sendRecv(nullptr, 0, TRANSPORT_NO_RANK, receive.data, receive.num_bytes, receive.source, receive.tag);
+    receive.source = TRANSPORT_NO_RANK;
+}
+
+/**
+ * Opens a file for collective writes, discarding the contents of any existing file
+ * @param file_name name of the file
+ * @return the file, nullptr if it could not be opened
+ */
+TransportFile* ThreadTransport::openFile(const char* file_name) {
+    if (this->rank == 0) {
+        this->group->file_descriptor = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    this->barrier();
+    const int file_descriptor = this->group->file_descriptor;
+    this->barrier();
+
+    if (file_descriptor < 0) {
+        return nullptr;
+    }
+    return new ThreadTransportFile(this, file_descriptor);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_THREADTRANSPORT_H
+#define CA_TRAFFIC_SIMULATION_THREADTRANSPORT_H
+
+#include <functional>
+#include <vector>
+
+#include "Transport.h"
+
+// State shared by all the threads of a ThreadTransport
+struct ThreadGroup;
+
+// Number of nonblocking receives that can be pending at the same time
+const int THREAD_TRANSPORT_MAX_REQUESTS = 16;
+
+// Number of nonblocking collectives that can be pending at the same time
+const int THREAD_TRANSPORT_MAX_COLLECTIVES = 4;
+
+/**
+ * Receive that was started but not yet completed by a wait
+ */
+struct PendingReceive {
+    void* data;
+    int num_bytes;
+    int source;
+    int tag;
+};
+
+/**
+ * Reduction that was started but not yet completed by a wait
+ */
+struct PendingCollective {
+    double* results;
+    int count;
+    ReduceOp op;
+    int root;
+    int64_t use;
+    bool active;
+};
+
+/**
+ * Transport between threads of a single process, with one rank per thread. Messages are copied through mailboxes in
+ * shared memory and collectives are combined directly from the buffers of the other threads between two barriers,
+ * so a run on a single node needs neither MPI nor mpirun. Messages can only be sent between neighbouring ranks, which
+ * is all that the decomposition of the road into segments needs. The nonblocking sends complete immediately, and a
+ * nonblocking receive takes the message out of its mailbox when it is waited for. A nonblocking reduction publishes
+ * its values in one of a fixed number of collective slots when it starts, and is combined when it is waited for, so
+ * the work between the start and the wait overlaps with the other threads catching up. A mailbox only grows when a
+ * message does not fit, so the engines reserve the mailboxes of their largest messages up front.
+ */
+class ThreadTransport : public Transport {
+private:
+    ThreadGroup* group;
+    int rank;
+    int size;
+    PendingReceive pending_receives[THREAD_TRANSPORT_MAX_REQUESTS];
+    PendingCollective pending_collectives[THREAD_TRANSPORT_MAX_COLLECTIVES];
+    int64_t collective_uses[THREAD_TRANSPORT_MAX_COLLECTIVES];
+    const void* const* gather(const void* data);
+    int startCollective(const double* values, double* results, int count, ReduceOp op, int root);
+    void finishCollective(PendingCollective& collective, int slot);
+public:
+    ThreadTransport(ThreadGroup* group, int rank);
+    static int run(int num_threads, const std::vector<int>& cpus, const std::function<int(Transport*)>& body);
+    int getRank() const;
+    int getSize() const;
+    void barrier();
+    void broadcast(void* data, int num_bytes, int root);
+    void sendRecv(const void* send_data, int send_bytes, int dest, void* recv_data, int recv_bytes, int source,
+                  int tag);
+    void reduce(const double* values, double* results, int count, ReduceOp op, int root);
+    void allReduce(const double* values, double* results, int count, ReduceOp op);
+    void allReduce(const int64_t* values, int64_t* results, int count, ReduceOp op);
+    void exclusiveScan(const int64_t* values, int64_t* results, int count);
+    void allGather(const void* data, int num_bytes, void* results);
+    int startReduce(const double* values, double* results, int count, ReduceOp op, int root);
+    int startAllReduce(const double* values, double* results, int count, ReduceOp op);
+    int startSend(const void* data, int num_bytes, int dest, int tag);
+    void reserveMessages(int num_bytes, int dest, int tag);
+    int startRecv(void* data, int num_bytes, int source, int tag);
+    void wait(int request);
+    TransportFile* openFile(const char* file_name);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_THREADTRANSPORT_H
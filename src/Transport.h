@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_TRANSPORT_H
+#define CA_TRAFFIC_SIMULATION_TRANSPORT_H
+
+#include <cstdint>
+
+// Rank given as the source or destination of a message that should not be sent or received, like MPI_PROC_NULL
+const int TRANSPORT_NO_RANK = -1;
+
+// Number of message tags that can be in use between two ranks at the same time
+const int TRANSPORT_NUM_TAGS = 16;
+
+// Reduction operations of the collective operations
+enum ReduceOp {
+    REDUCE_SUM,
+    REDUCE_MAX
+};
+
+/**
+ * File written collectively by all the ranks, with each rank writing its own part of the file at an offset
+ */
+class TransportFile {
+public:
+    virtual ~TransportFile() {}
+    virtual void writeAtAll(int64_t offset, const void* data, int num_bytes) = 0;
+};
+
+/**
+ * Communication between the ranks that simulate the segments of the road. The engines only talk to each other through
+ * this interface, so the same simulation can run as MPI processes on many nodes or as threads sharing the memory of a
+ * single process. Messages are raw bytes between neighbouring ranks, matched by source and tag in the order they are
+ * sent. Collective operations, and the waits of the nonblocking ones, must be called by all ranks in the same order.
+ * A gather collects the same number of bytes from every rank into one array on every rank, in the order of the ranks.
+ * Nonblocking operations return a request that is completed with wait, and their buffers must be left alone until
+ * then. A rank can reserve room for the largest messages it will send to a neighbour with a tag, so that sending them
+ * during the steps does not allocate.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+    virtual int getRank() const = 0;
+    virtual int getSize() const = 0;
+    virtual void barrier() = 0;
+    virtual void broadcast(void* data, int num_bytes, int root) = 0;
+    virtual void sendRecv(const void* send_data, int send_bytes, int dest, void* recv_data, int recv_bytes,
+                          int source, int tag) = 0;
+    virtual void reduce(const double* values, double* results, int count, ReduceOp op, int root) = 0;
+    virtual void allReduce(const double* values, double* results, int count, ReduceOp op) = 0;
+    virtual void allReduce(const int64_t* values, int64_t* results, int count, ReduceOp op) = 0;
+    virtual void exclusiveScan(const int64_t* values, int64_t* results, int count) = 0;
+    virtual void allGather(const void* data, int num_bytes, void* results) = 0;
+    virtual int startReduce(const double* values, double* results, int count, ReduceOp op, int root) = 0;
+    virtual int startAllReduce(const double* values, double* results, int count, ReduceOp op) = 0;
+    virtual int startSend(const void* data, int num_bytes, int dest, int tag) = 0;
+    virtual void reserveMessages(int num_bytes, int dest, int tag) = 0;
+    virtual int startRecv(void* data, int num_bytes, int source, int tag) = 0;
+    virtual void wait(int request) = 0;
+    virtual TransportFile* openFile(const char* file_name) = 0;
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_TRANSPORT_H
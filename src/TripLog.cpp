@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+
+#include "TripLog.h"
+#include "Vehicle.h"
+#include "Lane.h"
+
+// Number of steps between the collective writes of the buffered trip records
+const int TRIP_LOG_FLUSH_INTERVAL = 1024;
+
+/**
+ * Constructor for the TripLog, collective over all the processes
+ * @param transport the Transport used to write the file
+ * @param inputs instance of the Inputs class with the simulation inputs
+ */
+TripLog::TripLog(Transport* transport, const Inputs& inputs) {
+    this->transport = transport;
+    this->enabled = inputs.write_trip_log != 0;
+    this->flush_interval = TRIP_LOG_FLUSH_INTERVAL;
+    this->num_records_written = 0;
+    this->file = nullptr;
+
+    if (!this->enabled) {
+        return;
+    }
+
+    // At most max_speed Vehicles per Lane can leave a segment in a step, so the buffer never fills between flushes
+    this->records.reserve(this->flush_interval * inputs.num_lanes * inputs.max_speed);
+
+    // Open the trip log file and discard the records of any previous run
+    this->file = this->transport->openFile("cats-trips.bin");
+    if (this->file == nullptr) {
+        std::cout << "error: failure to open \"cats-trips.bin\" file!" << std::endl;
+        throw std::exception();
+    }
+}
+
+/**
+ * Destructor for the TripLog
+ */
+TripLog::~TripLog() {
+    delete this->file;
+}
+
+/**
+ * Checks whether the trip log is written in the simulation
+ * @return true if the trip log is written, false otherwise
+ */
+bool TripLog::isEnabled() {
+    return this->enabled;
+}
+
+/**
+ * Adds the record of the trip of a Vehicle that left the road to the buffer
+ * @param vehicle pointer to the Vehicle that left the road
+ * @param exit_step the step in which the Vehicle left the road
+ */
+void TripLog::addTrip(Vehicle* vehicle, int exit_step) {
+    this->addTrip(vehicle->getId(), exit_step, vehicle->getTimeOnRoad(), vehicle->getLaneChanges(),
+                  vehicle->getLane()->getLaneNumber(), vehicle->getDistance());
+}
+
+/**
+ * Adds the record of a trip that left the road to the buffer
+ * @param id unique ID number of the Vehicle
+ * @param exit_step the step in which the Vehicle left the road
+ * @param time_on_road number of steps the Vehicle spent on the road
+ * @param lane_changes number of lane changes of the Vehicle
+ * @param exit_lane the number of the Lane the Vehicle left from
+ * @param distance number of sites the Vehicle travelled
+ */
+void TripLog::addTrip(int64_t id, int exit_step, int time_on_road, int lane_changes, int exit_lane, long distance) {
+    if (!this->enabled) {
+        return;
+    }
+
+    TripRecord record;
+    record.id = id;
+    record.entry_step = exit_step - time_on_road;
+    record.exit_step = exit_step;
+    record.lane_changes = lane_changes;
+    record.exit_lane = exit_lane;
+    record.mean_speed = time_on_road > 0 ? (double) distance / (double) time_on_road : 0.0;
+    this->records.push_back(record);
+}
+
+/**
+ * Ends a step, writing the buffered records at the end of every flush interval
+ * @param step the number of steps completed
+ */
+void TripLog::endStep(int step) {
+    if (this->enabled && step % this->flush_interval == 0) {
+        this->flush();
+    }
+}
+
+/**
+ * Writes the buffered records of all the processes to the trip log file, collective over all the processes
+ */
+void TripLog::flush() {
+    if (!this->enabled) {
+        return;
+    }
+
+    // Compute the offset of the records of this process from the record counts of the processes before it
+    int64_t num_local_records = this->records.size();
+    int64_t num_records_before = 0;
+    int64_t num_records_total = 0;
+    this->transport->exclusiveScan(&num_local_records, &num_records_before, 1);
+    this->transport->allReduce(&num_local_records, &num_records_total, 1, REDUCE_SUM);
+
+    int64_t offset = (this->num_records_written + num_records_before) * (int64_t) sizeof(TripRecord);
+    this->file->writeAtAll(offset, this->records.data(), (int) (num_local_records * sizeof(TripRecord)));
+
+    this->num_records_written += num_records_total;
+    this->records.clear();
+}
+
+/**
+ * Adds the storage of the buffered trip records to a MemoryReport
+ * @param report the MemoryReport
+ */
+void TripLog::addMemory(MemoryReport* report) const {
+    report->addVector(MEMORY_BUFFERS, this->records);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_TRIPLOG_H
+#define CA_TRAFFIC_SIMULATION_TRIPLOG_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Inputs.h"
+#include "Transport.h"
+#include "MemoryReport.h"
+
+// Forward Declarations
+class Vehicle;
+
+/**
+ * Fixed-size binary record of a completed trip, written to the trip log file in the native byte order. Steps are
+ * counted from the start of the simulation, and the mean speed is in sites per step.
+ *
+ *     offset  size  field
+ *          0     8  id            (int64)
+ *          8     4  entry_step    (int32)
+ *         12     4  exit_step     (int32)
+ *         16     4  lane_changes  (int32)
+ *         20     4  exit_lane     (int32)
+ *         24     8  mean_speed    (float64)
+ */
+struct TripRecord {
+    int64_t id;
+    int32_t entry_step;
+    int32_t exit_step;
+    int32_t lane_changes;
+    int32_t exit_lane;
+    double mean_speed;
+};
+
+static_assert(sizeof(TripRecord) == 32, "TripRecord must have the documented 32 byte layout");
+
+/**
+ * Class for the log of the trips of the Vehicles that left the road. Each process buffers the records of its trips,
+ * and at fixed step intervals all processes write their buffers to the shared file with a collective write at
+ * offsets computed from a prefix sum of the record counts, so the records never pass through rank 0.
+ */
+class TripLog {
+private:
+    int flush_interval;
+    std::vector<TripRecord> records;
+    Transport* transport;
+    TransportFile* file;
+    int64_t num_records_written;
+    bool enabled;
+public:
+    TripLog(Transport* transport, const Inputs& inputs);
+    ~TripLog();
+    bool isEnabled();
+    void addTrip(Vehicle* vehicle, int exit_step);
+    void addTrip(int64_t id, int exit_step, int time_on_road, int lane_changes, int exit_lane, long distance);
+    void endStep(int step);
+    void flush();
+    void addMemory(MemoryReport* report) const;
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_TRIPLOG_H
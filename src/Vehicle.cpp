@@ -2,15 +2,50 @@
  * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
  */
 
+#include <algorithm>
 #include <cstdlib>
 #include <iomanip>
 #include <fstream>
 #include <iostream>
-#include <mpi.h>
 #include "Statistic.h"
 #include "Vehicle.h"
 #include "Lane.h"
 #include "Road.h"
+#include "Random.h"
+#include "RuleSets.h"
+
+namespace {
+    /**
+     * Block of memory of a Vehicle that is not in use, kept in a singly linked free list so that the memory can be
+     * reused by the next Vehicle that is created without going back to the heap
+     */
+    struct FreeVehicleBlock {
+        FreeVehicleBlock* next;
+    };
+
+    // Number of Vehicle memory blocks allocated from the heap at once when the free list runs out
+    const int VEHICLE_POOL_CHUNK_SIZE = 1024;
+
+    // Head of the free list of Vehicle memory blocks, one per thread so that ranks running as threads never share it
+    thread_local FreeVehicleBlock* free_vehicle_blocks = nullptr;
+
+    // Number of Vehicle memory blocks that the pool of the thread holds, whether they are free or in use
+    thread_local int vehicle_pool_capacity = 0;
+
+    /**
+     * Allocates a chunk of Vehicle memory blocks from the heap and adds them to the free list of the thread
+     * @param num_blocks number of blocks in the chunk
+     */
+    void addVehicleChunk(int num_blocks) {
+        char* chunk = static_cast<char*>(::operator new(sizeof(Vehicle) * num_blocks));
+        for (int i = num_blocks - 1; i >= 0; i--) {
+            FreeVehicleBlock* block = reinterpret_cast<FreeVehicleBlock*>(chunk + i * sizeof(Vehicle));
+            block->next = free_vehicle_blocks;
+            free_vehicle_blocks = block;
+        }
+        vehicle_pool_capacity += num_blocks;
+    }
+}
 
 /**
  * Constructor for the Vehicle
@@ -19,7 +54,7 @@
  * @param initial_position initial site number of the Vehicle in the Lane
  * @param inputs instance of the Inputs class with the simulation inputs
  */
-Vehicle::Vehicle(Lane* lane_ptr, int id, int initial_position, Inputs inputs) {
+Vehicle::Vehicle(Lane* lane_ptr, int64_t id, int initial_position, const Inputs& inputs) {
     // Set the ID number of the Vehicle
     this->id = id;
 
@@ -44,29 +79,90 @@ Vehicle::Vehicle(Lane* lane_ptr, int id, int initial_position, Inputs inputs) {
     // Set the other lane look backward distance of the Vehicle
     this->look_other_backward = inputs.look_other_backward;
 
-    // Set the slow down probability of the Vehicle
+    // Set the slow down probabilities of the Vehicle
     this->prob_slow_down = inputs.prob_slow_down;
+    this->prob_slow_down_stopped = inputs.prob_slow_down_stopped;
 
     // Set the lane change probability of the Vehicle
     this->prob_change = inputs.prob_change;
 
     // Initialize the time spend on the Road
     this->time_on_road = 0;
+
+    // Initialize the trip record of the Vehicle
+    this->lane_changes = 0;
+    this->distance = 0;
+    this->depends_on_neighbors = false;
+    this->probe = false;
+    this->other_lane_ptr = nullptr;
 }
 
 Vehicle::~Vehicle() {}
 
 /**
- * Update the perceived gaps between the Vehicle and the surrounding Vehicles in the Road
+ * Allocates the memory for a Vehicle, reusing the memory of a previously deleted Vehicle if there is one so that
+ * spawning and migrating Vehicles does not allocate once the simulation has reached a steady state
+ * @param size size of the memory block in bytes
+ * @return pointer to the memory block
+ */
+void* Vehicle::operator new(std::size_t size) {
+    if (size != sizeof(Vehicle)) {
+        return ::operator new(size);
+    }
+
+    // Refill the free list with a chunk of blocks if it is empty, the chunks stay in the pool until the program exits
+    if (free_vehicle_blocks == nullptr) {
+        addVehicleChunk(VEHICLE_POOL_CHUNK_SIZE);
+    }
+
+    FreeVehicleBlock* block = free_vehicle_blocks;
+    free_vehicle_blocks = block->next;
+    return block;
+}
+
+/**
+ * Releases the memory of a deleted Vehicle into the free list for reuse by the next Vehicle that is created
+ * @param ptr pointer to the memory block
+ * @param size size of the memory block in bytes
+ */
+void Vehicle::operator delete(void* ptr, std::size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (size != sizeof(Vehicle)) {
+        ::operator delete(ptr);
+        return;
+    }
+    FreeVehicleBlock* block = static_cast<FreeVehicleBlock*>(ptr);
+    block->next = free_vehicle_blocks;
+    free_vehicle_blocks = block;
+}
+
+/**
+ * Grows the pool of Vehicle memory blocks of the calling thread so that it holds at least a number of Vehicles at once,
+ * so that the pool does not have to grow during the steps
+ * @param num_vehicles number of Vehicles that the pool must hold
+ */
+void Vehicle::reservePool(int num_vehicles) {
+    if (num_vehicles > vehicle_pool_capacity) {
+        addVehicleChunk(num_vehicles - vehicle_pool_capacity);
+    }
+}
+
+/**
+ * Update the perceived gaps between the Vehicle and the surrounding Vehicles in the Road, noting whether any of the
+ * gaps reached past the end of the segment into the gaps received from a neighboring process
  * @param road_ptr pointer to the Road that the Vehicle is in
  * @return 0 if successful, nonzero otherwise
  */
 int Vehicle::updateGaps(Road* road_ptr, int rank, int size) {
+    this->depends_on_neighbors = false;
+
     // Locate the preceding Vehicle and update the forward gap
     this->gap_forward = this->lane_ptr->getSize() - 1;
     bool found_vehicle_ahead = false;
     for (int i = this->position + 1; i < this->lane_ptr->getSize(); i++) {
-        if (this->lane_ptr->hasVehicleInSite(i)) {
+        if (this->lane_ptr->isSiteBlocked(i)) {
             this->gap_forward = i - this->position - 1;
             found_vehicle_ahead = true;
             break;
@@ -78,44 +174,64 @@ int Vehicle::updateGaps(Road* road_ptr, int rank, int size) {
             this->gap_forward = this->lane_ptr->getSize() - this->position - 1;
         }
         this->gap_forward += this->lane_ptr->getGapNextProcess();
+        this->depends_on_neighbors |= rank < size - 1;
     }
 
     // Update vehicle look forward distances
     this->look_forward = this->speed + 1;
     this->look_other_forward = this->look_forward;
 
-    // Determine the other lane of interest
-    Lane* other_lane_ptr;
-    if (this->lane_ptr->getLaneNumber() == 0) {
-        other_lane_ptr = road_ptr->getLanes()[1];
-    } else {
-        other_lane_ptr = road_ptr->getLanes()[0];
+    // Determine the other lane of interest, which is the Lane to the left if the Vehicle has room to move there and
+    // otherwise the Lane to the right, so that a Vehicle with room on both sides passes on the left
+    const std::vector<Lane*>& lanes = road_ptr->getLanes();
+    const int lane_num = this->lane_ptr->getLaneNumber();
+    this->other_lane_ptr = nullptr;
+    this->gap_other_forward = -1;
+    this->gap_other_backward = -1;
+    if (lane_num + 1 < (int) lanes.size()) {
+        this->updateOtherLaneGaps(lanes[lane_num + 1], rank, size);
+    }
+    if (lane_num > 0 && (this->other_lane_ptr == nullptr || this->gap_other_forward <= this->look_other_forward ||
+                         this->gap_other_backward <= this->look_other_backward)) {
+        this->updateOtherLaneGaps(lanes[lane_num - 1], rank, size);
     }
 
+    // Return with zero errors
+    return 0;
+}
+
+/**
+ * Updates the forward and backward gaps of the Vehicle in a neighbouring Lane and makes it the Lane that the Vehicle
+ * would change to
+ * @param other_lane_ptr pointer to the neighbouring Lane
+ */
+void Vehicle::updateOtherLaneGaps(Lane* other_lane_ptr, int rank, int size) {
+    this->other_lane_ptr = other_lane_ptr;
+
     // Update the forward gap in the other lane
     this->gap_other_forward = this->lane_ptr->getSize() - 1;
-    found_vehicle_ahead = false;
+    bool found_vehicle_ahead = false;
     for (int i = this->position; i < this->lane_ptr->getSize(); i++) {
-        if (other_lane_ptr->hasVehicleInSite(i)) {
+        if (other_lane_ptr->isSiteBlocked(i)) {
             this->gap_other_forward = i - this->position - 1;
             found_vehicle_ahead = true;
             break;
         }
     }
 
-
     if (!found_vehicle_ahead) {
-        if (rank > 0 && rank < size - 1) {
+        if (rank < size - 1) {
             this->gap_other_forward = other_lane_ptr->getSize() - this->position - 1;
         }
         this->gap_other_forward += other_lane_ptr->getGapNextProcess();
+        this->depends_on_neighbors |= rank < size - 1;
     }
 
     // Update the backward gap in the other lane
     this->gap_other_backward = this->lane_ptr->getSize() - 1;
     bool found_vehicle_behind = false;
     for (int i = this->position; i >= 0; i--) {
-        if (other_lane_ptr->hasVehicleInSite(i)) {
+        if (other_lane_ptr->isSiteBlocked(i)) {
             this->gap_other_backward = this->position - i - 1;
             found_vehicle_behind = true;
             break;
@@ -123,35 +239,58 @@ int Vehicle::updateGaps(Road* road_ptr, int rank, int size) {
     }
 
     if (!found_vehicle_behind) {
-        if (rank > 0 && rank < size - 1) {
+        if (rank > 0) {
             this->gap_other_backward = this->position;
         }
         this->gap_other_backward += other_lane_ptr->getGapPrevProcess();
+        this->depends_on_neighbors |= rank > 0;
     }
+}
 
-    // Return with zero errors
-    return 0;
+/**
+ * Checks whether the Lane that the Vehicle would change to is to the left of its own Lane
+ * @return true if the Vehicle would change to the left, false if to the right or if it has no neighbouring Lane
+ */
+bool Vehicle::changesToLeft() const {
+    return this->other_lane_ptr != nullptr &&
+           this->other_lane_ptr->getLaneNumber() > this->lane_ptr->getLaneNumber();
 }
 
 /**
- * Moved the Vehicle to the other Lane in the Road
+ * Stores the gaps and look distances of the Vehicle into the arrays of a LaneChangeBatch
+ * @param index the index of the Vehicle in the arrays
+ */
+void Vehicle::storeLaneChangeInputs(int index, int* gap_forward, int* look_forward, int* gap_other_forward,
+                                    int* look_other_forward, int* gap_other_backward,
+                                    int* look_other_backward) const {
+    gap_forward[index] = this->gap_forward;
+    look_forward[index] = this->look_forward;
+    gap_other_forward[index] = this->gap_other_forward;
+    look_other_forward[index] = this->look_other_forward;
+    gap_other_backward[index] = this->gap_other_backward;
+    look_other_backward[index] = this->look_other_backward;
+}
+
+/**
+ * Moved the Vehicle to the other Lane in the Road if the random draw of the lane change rule of the rule set allows
+ * it. Only called for the Vehicles whose gaps pass the gap tests of the rule, see LaneChangeBatch, and for the
+ * Vehicles changing to the left before those changing to the right. A Vehicle changing to the right stays in its Lane
+ * if a Vehicle from the Lane beyond has just changed to the left into the same site.
+ * @tparam RuleSet the rule set of the cellular automaton
  * @param road_ptr pointer to the Road in which the Vehicle is on
  * @return 0 if successful, nonzero otherwise
  */
+template <class RuleSet>
 int Vehicle::performLaneSwitch(Road* road_ptr, int rank, int size) {
-    // Evaluate if the Vehicle will change lanes and then perform the lane change
-    if (this->gap_forward < this->look_forward &&
-        this->gap_other_forward > this->look_other_forward &&
-        this->gap_other_backward > this->look_other_backward &&
-        ((double) rand()) / ((double) RAND_MAX) <= this->prob_change ) {
-
-        // Determine the lane that the Vehicle is switching to
-        Lane* other_lane_ptr;
-        if (this->lane_ptr->getLaneNumber() == 0) {
-            other_lane_ptr = road_ptr->getLanes()[1];
-        } else {
-            other_lane_ptr = road_ptr->getLanes()[0];
-        }
+    Lane* other_lane_ptr = this->other_lane_ptr;
+    if (other_lane_ptr->isSiteBlocked(this->position)) {
+        return 0;
+    }
+
+    // Evaluate if the Vehicle will change lanes, with the random stream of this Vehicle at its current age, and then
+    // perform the lane change
+    Random::beginStream(this->id, this->time_on_road, Random::STREAM_LANE_CHANGE);
+    if (RuleSet::acceptsLaneChange(this->prob_change)) {
 
 #ifdef DEBUG
         std::cout << "vehicle " << this->id << " switched lane " << this->lane_ptr->getLaneNumber() << " -> "
@@ -166,6 +305,9 @@ int Vehicle::performLaneSwitch(Road* road_ptr, int rank, int size) {
 
         // Set the pointer to the Lane in the Vehicle to the new lane
         this->lane_ptr = other_lane_ptr;
+
+        // Count the lane change for the trip record
+        this->lane_changes++;
     }
 
     // Return with zero errors
@@ -173,38 +315,35 @@ int Vehicle::performLaneSwitch(Road* road_ptr, int rank, int size) {
 }
 
 /**
- * Moves the Vehicle to the next site in the current Lane during the time-step based on the speed of the Vehicle
+ * Moves the Vehicle to the next site in the current Lane during the time-step based on the speed of the Vehicle,
+ * which is updated with the speed update rules of the rule set
+ * @tparam RuleSet the rule set of the cellular automaton
  * @return 0 if successful, nonzero otherwise
  */
+template <class RuleSet>
 int Vehicle::performLaneMove() {
     // Increment the time on road counter
     this->time_on_road++;
 
-    // Update Vehicle speed based on vehicle speed update rules
-    if (this->speed != this->max_speed) {
-        this->speed++;
+    // Update Vehicle speed based on vehicle speed update rules, up to the speed limit of the site
 #ifdef DEBUG
-        std::cout << "vehicle " << this->id << " increased speed " << this->speed - 1 << " -> " << this->speed
-                  << std::endl;
+    int old_speed = this->speed;
 #endif
-    }
-
-    this->speed = std::min(this->speed, this->gap_forward);
+    const int max_speed = std::min(this->max_speed, this->lane_ptr->getSpeedLimit(this->position));
+    Random::beginStream(this->id, this->time_on_road, Random::STREAM_SPEED);
+    this->speed = RuleSet::updateSpeed(this->speed, max_speed, this->gap_forward, this->prob_slow_down,
+                                       this->prob_slow_down_stopped);
 #ifdef DEBUG
+    if (this->speed != old_speed) {
+        std::cout << "vehicle " << this->id << " changed speed " << old_speed << " -> " << this->speed << std::endl;
+    }
     if (this->speed == 0) {
         std::cout << "vehicle " << this->id << " stopped behind preceding vehicle" << std::endl;
     }
 #endif
 
-    if (this->speed > 0) {
-        if (((double)rand()) / ((double)RAND_MAX) <= this->prob_slow_down) {
-            this->speed--;
-#ifdef DEBUG
-            std::cout << "vehicle " << this->id << " decreased speed " << this->speed + 1 << " -> " << this->speed
-                      << std::endl;
-#endif
-        }
-    }
+    // Add the distance covered in the step to the trip record
+    this->distance += this->speed;
 
     if (this->speed > 0) {
         // Compute the new position of the vehicle
@@ -249,7 +388,7 @@ int Vehicle::performLaneMove() {
  * Getter method for the ID number of the Vehicle
  * @return
  */
-int Vehicle::getId() {
+int64_t Vehicle::getId() {
     return this->id;
 }
 
@@ -258,10 +397,26 @@ int Vehicle::getId() {
  * @param inputs
  * @return
  */
-double Vehicle::getTravelTime(Inputs inputs) {
+double Vehicle::getTravelTime(const Inputs& inputs) {
     return inputs.step_size * this->time_on_road;
 }
 
+/**
+ * Getter method for the Lane that the Vehicle is in
+ * @return pointer to the Lane of the Vehicle
+ */
+Lane* Vehicle::getLane() const {
+    return this->lane_ptr;
+}
+
+/**
+ * Checks whether the gaps from the last update used the gaps received from a neighboring process
+ * @return whether or not the gaps depend on the neighboring processes
+ */
+bool Vehicle::dependsOnNeighbors() const {
+    return this->depends_on_neighbors;
+}
+
 int Vehicle::getPosition() const {
     return this->position;
 }
@@ -277,6 +432,8 @@ int Vehicle::getLookOtherBackward() const { return this->look_other_backward; }
 double Vehicle::getProbSlowDown() const { return this->prob_slow_down; }
 double Vehicle::getProbChange() const { return this->prob_change; }
 int Vehicle::getTimeOnRoad() const { return this->time_on_road; }
+int Vehicle::getLaneChanges() const { return this->lane_changes; }
+long Vehicle::getDistance() const { return this->distance; }
 
 void Vehicle::setMaxSpeed(int max_speed) { this->max_speed = max_speed; }
 void Vehicle::setGapForward(int gap) { this->gap_forward = gap; }
@@ -288,6 +445,9 @@ void Vehicle::setLookOtherBackward(int look) { this->look_other_backward = look;
 void Vehicle::setProbSlowDown(double prob) { this->prob_slow_down = prob; }
 void Vehicle::setProbChange(double prob) { this->prob_change = prob; }
 void Vehicle::setTimeOnRoad(int time) { this->time_on_road = time; }
+void Vehicle::setLaneChanges(int lane_changes) { this->lane_changes = lane_changes; }
+void Vehicle::setDistance(long distance) { this->distance = distance; }
+void Vehicle::setProbe(bool probe) { this->probe = probe; }
 
 
 /**
@@ -309,4 +469,14 @@ void Vehicle::printGaps() {
     std::cout << "vehicle " << std::setw(2) << this->id << " gaps, >:" << this->gap_forward << " ^>:"
         << this->gap_other_forward << " ^<:" << this->gap_other_backward << std::endl;
 }
-#endif
\ No newline at end of file
+#endif
+
+// Instantiate the movement methods of the Vehicle for every rule set
+template int Vehicle::performLaneSwitch<RuleSets::NagelSchreckenberg>(Road* road_ptr, int rank, int size);
+template int Vehicle::performLaneSwitch<RuleSets::VelocityDependentRandomization>(Road* road_ptr, int rank, int size);
+template int Vehicle::performLaneSwitch<RuleSets::SlowToStart>(Road* road_ptr, int rank, int size);
+template int Vehicle::performLaneSwitch<RuleSets::CruiseControl>(Road* road_ptr, int rank, int size);
+template int Vehicle::performLaneMove<RuleSets::NagelSchreckenberg>();
+template int Vehicle::performLaneMove<RuleSets::VelocityDependentRandomization>();
+template int Vehicle::performLaneMove<RuleSets::SlowToStart>();
+template int Vehicle::performLaneMove<RuleSets::CruiseControl>();
@@ -5,6 +5,9 @@
 #ifndef CA_TRAFFIC_SIMULATION_VEHICLE_H
 #define CA_TRAFFIC_SIMULATION_VEHICLE_H
 
+#include <cstddef>
+#include <cstdint>
+
 #include "Inputs.h"
 #include "Road.h"
 #include "Statistic.h"
@@ -19,7 +22,8 @@ class Lane;
 class Vehicle {
 private:
     Lane* lane_ptr;
-    int id;
+    Lane* other_lane_ptr;
+    int64_t id;
     int position;
     int speed;
     int max_speed;
@@ -30,17 +34,33 @@ private:
     int look_other_forward;
     int look_other_backward;
     double prob_slow_down;
+    double prob_slow_down_stopped;
     double prob_change;
     int time_on_road;
+    int lane_changes;
+    long distance;
+    bool depends_on_neighbors;
+    bool probe;
+    void updateOtherLaneGaps(Lane* other_lane_ptr, int rank, int size);
 
 public:
-    Vehicle(Lane* lane_ptr, int id, int initial_position, Inputs inputs);
+    Vehicle(Lane* lane_ptr, int64_t id, int initial_position, const Inputs& inputs);
     ~Vehicle();
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+    static void reservePool(int num_vehicles);
     int updateGaps(Road* road_ptr, int rank, int size);
+    bool dependsOnNeighbors() const;
+    bool changesToLeft() const;
+    void storeLaneChangeInputs(int index, int* gap_forward, int* look_forward, int* gap_other_forward,
+                               int* look_other_forward, int* gap_other_backward, int* look_other_backward) const;
+    template <class RuleSet>
     int performLaneSwitch(Road* road_ptr, int rank, int size);
+    template <class RuleSet>
     int performLaneMove();
-    int getId();
-    double getTravelTime(Inputs inputs);
+    int64_t getId();
+    double getTravelTime(const Inputs& inputs);
+    Lane* getLane() const;
     int setSpeed(int speed);
     int getPosition() const;
     int getSpeed() const;
@@ -54,6 +74,9 @@ public:
     double getProbSlowDown() const;
     double getProbChange() const;
     int getTimeOnRoad() const;
+    int getLaneChanges() const;
+    long getDistance() const;
+    inline bool isProbe() const;
 
     void setMaxSpeed(int max_speed);
     void setGapForward(int gap);
@@ -65,6 +88,9 @@ public:
     void setProbSlowDown(double prob);
     void setProbChange(double prob);
     void setTimeOnRoad(int time);
+    void setLaneChanges(int lane_changes);
+    void setDistance(long distance);
+    void setProbe(bool probe);
 
 
 #ifdef DEBUG
@@ -72,5 +98,12 @@ public:
 #endif
 };
 
+/**
+ * Checks whether the Vehicle is a probe whose state is recorded after every step, inline so that the Vehicles that are
+ * not probes only pay for a branch
+ * @return true if the Vehicle is a probe, false otherwise
+ */
+inline bool Vehicle::isProbe() const { return this->probe; }
+
 
 #endif //CA_TRAFFIC_SIMULATION_VEHICLE_H
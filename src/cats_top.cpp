@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "TelemetryRing.h"
+
+/**
+ * Finds the most recently created telemetry segment in the shared memory directory
+ * @return name of the segment, empty if there is none
+ */
+std::string findNewestSegment() {
+    std::string newest_name;
+    time_t newest_time = 0;
+
+    DIR* dir = opendir("/dev/shm");
+    if (dir == nullptr) {
+        return newest_name;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (std::strncmp(entry->d_name, "cats-telemetry-", 15) != 0) {
+            continue;
+        }
+        struct stat info;
+        std::string path = std::string("/dev/shm/") + entry->d_name;
+        if (stat(path.c_str(), &info) == 0 && info.st_mtime >= newest_time) {
+            newest_time = info.st_mtime;
+            newest_name = std::string("/") + entry->d_name;
+        }
+    }
+    closedir(dir);
+
+    return newest_name;
+}
+
+/**
+ * Copies a record out of the ring, retrying while the simulation is writing it
+ * @param ring the ring to read from
+ * @param index index of the published record to read
+ * @param copy the record to copy into
+ * @return true if the record was read, false if it has already been overwritten
+ */
+bool readRecord(const TelemetryRing::Ring* ring, uint64_t index, TelemetryRing::Record* copy) {
+    const TelemetryRing::Record& record = ring->records[index % TelemetryRing::CAPACITY];
+    while (true) {
+        uint64_t sequence_before = record.sequence.load(std::memory_order_acquire);
+        if (sequence_before > 2 * index + 2) {
+            return false;
+        }
+        copy->step = record.step;
+        copy->wall_time = record.wall_time;
+        copy->steps_per_second = record.steps_per_second;
+        copy->num_vehicles = record.num_vehicles;
+        std::memcpy(copy->phase_time_mean, record.phase_time_mean, sizeof(record.phase_time_mean));
+        std::memcpy(copy->phase_time_max, record.phase_time_max, sizeof(record.phase_time_max));
+        copy->imbalance = record.imbalance;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (record.sequence.load(std::memory_order_relaxed) == sequence_before && sequence_before == 2 * index + 2) {
+            return true;
+        }
+        usleep(1000);
+    }
+}
+
+/**
+ * Prints a record of the ring as a line of the display
+ * @param ring the ring that the record belongs to
+ * @param record the record to print
+ */
+void printRecord(const TelemetryRing::Ring* ring, const TelemetryRing::Record& record) {
+    std::cout << std::setw(10) << record.step << std::setw(7) << std::fixed << std::setprecision(1)
+              << 100.0 * record.step / ring->max_time << "%" << std::setw(10) << std::setprecision(1)
+              << record.steps_per_second << std::setw(10) << record.num_vehicles;
+    for (int i = 0; i < TelemetryRing::NUM_PHASES; i++) {
+        std::cout << std::setw(10) << std::setprecision(1) << 1.0e6 * record.phase_time_max[i];
+    }
+    std::cout << std::setw(9) << std::setprecision(1) << 100.0 * record.imbalance << "%" << std::endl;
+}
+
+/**
+ * Main point of execution of the telemetry reader, which follows the live telemetry of a running simulation
+ * @param argc number of command line arguments
+ * @param argv command line arguments, optionally the process id of rank 0 of the simulation to follow
+ * @return 0 if successful, nonzero otherwise
+ */
+int main(int argc, char** argv) {
+    // Determine the shared memory segment to read, the newest one unless a process id is given
+    std::string segment_name;
+    if (argc > 1) {
+        char name[64];
+        TelemetryRing::segmentName(std::atol(argv[1]), name, sizeof(name));
+        segment_name = name;
+    } else {
+        segment_name = findNewestSegment();
+    }
+    if (segment_name.empty()) {
+        std::cout << "error: no running simulation is publishing telemetry!" << std::endl;
+        return 1;
+    }
+
+    // Map the ring read-only, so that the reader can never disturb the simulation
+    int fd = shm_open(segment_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        std::cout << "error: failure to open telemetry segment \"" << segment_name << "\"!" << std::endl;
+        return 1;
+    }
+    void* ptr = mmap(nullptr, sizeof(TelemetryRing::Ring), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        std::cout << "error: failure to map telemetry segment \"" << segment_name << "\"!" << std::endl;
+        return 1;
+    }
+    const TelemetryRing::Ring* ring = static_cast<const TelemetryRing::Ring*>(ptr);
+    if (ring->magic != TelemetryRing::MAGIC || ring->version != TelemetryRing::VERSION) {
+        std::cout << "error: \"" << segment_name << "\" is not a compatible telemetry segment!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "following " << segment_name << " (" << ring->num_processes << " processes, "
+              << ring->max_time << " steps), phase times are max across processes in [us/step]" << std::endl;
+    std::cout << std::setw(10) << "step" << std::setw(8) << "done" << std::setw(10) << "steps/s" << std::setw(10)
+              << "vehicles";
+    for (int i = 0; i < TelemetryRing::NUM_PHASES; i++) {
+        std::cout << std::setw(10) << TelemetryRing::PHASE_NAMES[i];
+    }
+    std::cout << std::setw(10) << "imbalance" << std::endl;
+
+    // Print every record as it is published, skipping ahead if the reader has fallen behind the ring
+    uint64_t next_index = 0;
+    while (true) {
+        bool finished = ring->finished.load(std::memory_order_acquire) != 0;
+        uint64_t num_published = ring->num_published.load(std::memory_order_acquire);
+        if (num_published > next_index + TelemetryRing::CAPACITY) {
+            next_index = num_published - TelemetryRing::CAPACITY;
+        }
+        for (; next_index < num_published; next_index++) {
+            TelemetryRing::Record record;
+            if (readRecord(ring, next_index, &record)) {
+                printRecord(ring, record);
+            }
+        }
+        if (finished) {
+            std::cout << "simulation finished" << std::endl;
+            break;
+        }
+        usleep(250000);
+    }
+
+    munmap(ptr, sizeof(TelemetryRing::Ring));
+
+    // Return with no errors
+    return 0;
+}
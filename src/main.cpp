@@ -2,60 +2,234 @@
  * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
  */
 
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <fstream>
 #include <iostream>
-#include <mpi.h>
+#include <sstream>
+#include <string>
 #include <unistd.h>
+#include <vector>
 
 #include "Inputs.h"
+#include "Random.h"
 #include "Simulation.h"
+#include "ReplicaEngine.h"
+#include "LatticeEngine.h"
+#include "Calibration.h"
+#include "PairedComparison.h"
+#include "Placement.h"
+#include "Scenario.h"
+#include "ScalingStudy.h"
+#include "Transport.h"
+#include "ThreadTransport.h"
+#ifdef CATS_WITH_MPI
+#include "MpiTransport.h"
+#endif
+
+namespace {
+    // Seed of the random streams given on the command line, which makes the runs reproducible
+    bool fixed_seed = false;
+    uint64_t command_line_seed = 0;
+}
 
 /**
- * Main point of execution of the program
- * @param argc number of command line arguments
- * @param argv command line arguments
+ * Runs the simulation on one rank
+ * @param transport the Transport of the rank
+ * @param study_inputs inputs shared by all the ranks of a scaling study run, nullptr to read them from the input file
+ * @param mean_vehicles pointer to store the mean number of Vehicles of the rank in, nullptr if it is not needed
  * @return 0 if successful, nonzero otherwise
  */
-int main(int argc, char** argv) {
-
-    // Initialize MPI
-    int rank, size;
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+int run_rank(Transport* transport, const Inputs* study_inputs, double* mean_vehicles) {
+    int rank = transport->getRank();
+    int size = transport->getSize();
 
     if ( rank == 0 ) {
         std::cout << "================================================" << std::endl;
         std::cout << "||    CELLULAR AUTOMATA TRAFFIC SIMULATION    ||" << std::endl;
         std::cout << "================================================" << std::endl;
     }
+
+    // Report the cores and NUMA nodes that the ranks run on
+    Placement::report(transport);
+
+    // Seed a different random stream for each rank, from the clock unless the seed is given on the command line
+    uint64_t seed = command_line_seed;
 #ifndef DEBUG
-    srand(time(NULL));
+    if (rank == 0 && !fixed_seed) {
+        seed = (uint64_t) time(NULL);
+    }
+    transport->broadcast(&seed, sizeof(seed), 0);
 #endif
+    Random::seed(seed, rank);
 
     // Create an Inputs object to contain the simulation parameters
     Inputs inputs = Inputs();
-    if (rank == 0) {
-        if (inputs.loadFromFile() != 0) {
-            MPI_Finalize();
+    if (study_inputs != nullptr) {
+        inputs = *study_inputs;
+    } else {
+        int load_status = 0;
+        if (rank == 0) {
+            load_status = inputs.loadFromFile();
+        }
+
+        // Broadcast the inputs to all processes
+        transport->broadcast(&load_status, sizeof(int), 0);
+        if (load_status != 0) {
             return 1;
         }
+        transport->broadcast(&inputs, sizeof(Inputs), 0);
     }
 
-    // Broadcast the inputs to all processes
-    MPI_Bcast(&inputs, sizeof(Inputs), MPI_BYTE, 0, MPI_COMM_WORLD);
-
-    // Create a Simulation object for the current simulation only in the master process
-    Simulation* simulation_ptr = new Simulation(inputs, rank, size);
+    int status;
+    if (inputs.calibration_iterations > 0) {
+        // Calibrate the parameters of the Vehicles against the target travel times
+        Calibration* calibration_ptr = new Calibration(transport, inputs, seed);
+        status = calibration_ptr->run(rank, size);
+        delete calibration_ptr;
+    } else if (inputs.paired_replications > 0) {
+        // Compare two variants of the simulation with common random numbers
+        PairedComparison* comparison_ptr = new PairedComparison(transport, inputs, seed);
+        status = comparison_ptr->run(rank, size);
+        delete comparison_ptr;
+    } else if (inputs.engine == ENGINE_REPLICAS) {
+        // Run the ensemble of replicas with the multi-spin coded engine
+        ReplicaEngine* engine_ptr = new ReplicaEngine(transport, inputs, rank, size);
+        status = engine_ptr->run(rank, size);
+        delete engine_ptr;
+    } else if (inputs.engine == ENGINE_LATTICE) {
+        // Run the simulation with the lattice-resident engine
+        LatticeEngine* engine_ptr = new LatticeEngine(transport, inputs, rank, size);
+        status = engine_ptr->run(rank, size);
+        if (mean_vehicles != nullptr) {
+            *mean_vehicles = engine_ptr->getMeanVehicles();
+        }
+        delete engine_ptr;
+    } else {
+        // Create a Simulation object for the current simulation only in the master process
+        Simulation* simulation_ptr = new Simulation(transport, inputs, rank, size);
 
-    // Run the Simulation
-    simulation_ptr->run_simulation(rank, size);
+        // Run the Simulation
+        status = simulation_ptr->run_simulation(rank, size);
+        if (mean_vehicles != nullptr) {
+            *mean_vehicles = simulation_ptr->getMeanVehicles();
+        }
 
-    // Delete the Simulation object only in the master process
-    delete simulation_ptr;
+        // Delete the Simulation object only in the master process
+        delete simulation_ptr;
+    }
 
-    MPI_Finalize();
+    // Return with the status of the Simulation
+    return status;
+}
 
-    // Return with no errors
+/**
+ * Compiles the text scenario file into the binary scenario file for the road of the input file
+ * @return 0 if successful, nonzero otherwise
+ */
+int compile_scenario() {
+    Inputs inputs = Inputs();
+    if (inputs.loadFromFile() != 0) {
+        return 1;
+    }
+    inputs.use_scenario = SCENARIO_TEXT;
+    Scenario scenario;
+    if (scenario.read_scenario(inputs, "cats-scenario.txt") != 0 ||
+        scenario.write_binary(inputs, "cats-scenario.bin") != 0) {
+        return 1;
+    }
+    std::cout << "wrote cats-scenario.bin for " << inputs.num_lanes << " lanes of " << inputs.length << " sites"
+              << std::endl;
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * Main point of execution of the program. With "--threads N" the simulation runs on N threads of this process,
+ * otherwise it runs on the MPI processes it was launched with, or on a single thread if built without MPI. With
+ * "--pin compact", "--pin scatter" or "--pin LIST" the threads are pinned to cores, see Placement::planCpus. With
+ * "--strong-scaling LIST" or "--weak-scaling LIST" the simulation is run in threads at each of a comma separated list
+ * of rank counts, see ScalingStudy. With "--compile-scenario" the text scenario file is compiled into the binary one.
+ * With "--seed N" the random streams are seeded with N instead of the clock, so that runs can be repeated.
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @return 0 if successful, nonzero otherwise
+ */
+int main(int argc, char** argv) {
+
+    // Parse the number of threads, their placement, the scaling study and the seed from the command line
+    int num_threads = 0;
+    std::string pin_policy;
+    std::vector<int> scaling_ranks;
+    bool weak_scaling = false;
+    bool compile = false;
+    for (int i = 1; i < argc; i++) {
+        if ((std::strcmp(argv[i], "--threads") == 0 || std::strcmp(argv[i], "-t") == 0) && i + 1 < argc) {
+            num_threads = std::stoi(argv[++i]);
+            if (num_threads < 1) {
+                std::cout << "error: the number of threads must be positive!" << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--pin") == 0 && i + 1 < argc) {
+            pin_policy = argv[++i];
+        } else if ((std::strcmp(argv[i], "--strong-scaling") == 0 || std::strcmp(argv[i], "--weak-scaling") == 0)
+                   && i + 1 < argc) {
+            weak_scaling = std::strcmp(argv[i], "--weak-scaling") == 0;
+            std::istringstream list(argv[++i]);
+            std::string field;
+            while (std::getline(list, field, ',')) {
+                scaling_ranks.push_back(std::atoi(field.c_str()));
+                if (scaling_ranks.back() < 1) {
+                    std::cout << "error: the numbers of ranks of a scaling study must be positive!" << std::endl;
+                    return 1;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--compile-scenario") == 0) {
+            compile = true;
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            fixed_seed = true;
+            command_line_seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
+    // Compile the scenario without running the simulation
+    if (compile) {
+        return compile_scenario();
+    }
+
+    // Run a scaling study in threads of this process
+    if (!scaling_ranks.empty()) {
+        ScalingStudy study(weak_scaling, scaling_ranks, pin_policy);
+        return study.run(run_rank);
+    }
+
+    // Plan the core of each thread
+    std::vector<int> cpus;
+    if (!pin_policy.empty()) {
+        if (num_threads == 0) {
+            std::cout << "error: --pin requires --threads, use the binding options of mpirun for processes!"
+                      << std::endl;
+            return 1;
+        }
+        if (Placement::planCpus(pin_policy, num_threads, &cpus) != 0) {
+            return 1;
+        }
+        Placement::setPolicy(pin_policy, num_threads);
+    }
+
+    if (num_threads > 0) {
+        return ThreadTransport::run(num_threads, cpus, [](Transport* transport) {
+            return run_rank(transport, nullptr, nullptr);
+        });
+    }
+
+#ifdef CATS_WITH_MPI
+    // Initialize MPI, which is finalized when the transport goes out of scope
+    MpiTransport transport(&argc, &argv);
+    return run_rank(&transport, nullptr, nullptr);
+#else
+    return ThreadTransport::run(1, std::vector<int>(), [](Transport* transport) {
+        return run_rank(transport, nullptr, nullptr);
+    });
+#endif
+}
@@ -0,0 +1,27 @@
+# Runs the simulation in two directories and fails unless both runs write the same trip records, in any order.
+# Called with cmake -DCATS=<program> -DFIRST_DIR=<directory> -DFIRST_ARGS=<arguments> -DSECOND_DIR=<directory>
+# -DSECOND_ARGS=<arguments> -P compare_trips.cmake, with the arguments as lists separated by semicolons.
+
+# Pattern of the 32 bytes of a trip record, in the hexadecimal dump of the trip file
+set(record_pattern "")
+foreach (i RANGE 1 64)
+    string(APPEND record_pattern "[0-9a-f]")
+endforeach ()
+
+foreach (run FIRST SECOND)
+    execute_process(COMMAND ${CATS} ${${run}_ARGS} WORKING_DIRECTORY ${${run}_DIR} RESULT_VARIABLE status
+                    OUTPUT_QUIET)
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "run in ${${run}_DIR} with ${${run}_ARGS} failed with status ${status}")
+    endif ()
+    file(READ ${${run}_DIR}/cats-trips.bin trips HEX)
+    string(REGEX MATCHALL "${record_pattern}" ${run}_records "${trips}")
+    list(SORT ${run}_records)
+    list(LENGTH ${run}_records ${run}_count)
+endforeach ()
+
+if (NOT FIRST_records STREQUAL SECOND_records)
+    message(FATAL_ERROR "the runs wrote different trips: ${FIRST_count} in ${FIRST_DIR} with ${FIRST_ARGS} and "
+                        "${SECOND_count} in ${SECOND_DIR} with ${SECOND_ARGS}")
+endif ()
+message(STATUS "both runs wrote the same ${FIRST_count} trips")
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "../src/AllocationCounter.h"
+#include "../src/TaskScheduler.h"
+
+/**
+ * Checks that the heap allocations made in the body of a loop by the workers of a TaskScheduler other than the calling
+ * thread are counted. Worker 0 holds on to its first range until another worker has run a range and allocated in it.
+ * @return 0 if the allocations of the other workers are counted, nonzero otherwise
+ */
+int main() {
+    if (!AllocationCounter::isEnabled()) {
+        std::cout << "error: the allocation counter is not compiled in!" << std::endl;
+        return 1;
+    }
+
+    TaskScheduler scheduler(2, std::vector<int>());
+    std::atomic<bool> allocated(false);
+    auto body = [&](int begin, int end, int worker) {
+        if (worker != 0) {
+            // Call the operator directly, since the compiler may leave out the allocation of a new expression
+            ::operator delete(::operator new(16));
+            allocated.store(true);
+            return;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (!allocated.load() && std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+            std::this_thread::yield();
+        }
+    };
+    scheduler.parallelFor(64, 1, body);
+
+    if (!allocated.load()) {
+        std::cout << "error: no other worker ran a range of the loop!" << std::endl;
+        return 1;
+    }
+    if (scheduler.getAllocations() == 0) {
+        std::cout << "error: the allocations of the workers were not counted!" << std::endl;
+        return 1;
+    }
+    std::cout << "Heap allocations of the other workers: " << scheduler.getAllocations() << std::endl;
+    return 0;
+}